@@ -0,0 +1,130 @@
+#include "auto_tuner.h"
+
+#include <algorithm>
+
+const uint32_t AutoTuner::kRejectBits;
+
+AutoTuner::AutoTuner(const TunerConfig& config)
+: m_config(config),
+  m_cancel(false),
+  m_running(nullptr) {
+}
+
+void AutoTuner::cancel() {
+    m_cancel = true;
+    std::lock_guard<std::mutex> lock(m_runningMutex);
+    if (m_running) m_running->cancel();
+}
+
+bool AutoTuner::test(CpufreqBackend& cpufreq, long freqKHz, double seconds, TuneCandidate& candidate) {
+    candidate.freqKHz = freqKHz;
+    candidate.stable = false;
+
+    if (!cpufreq.setLimits(freqKHz, freqKHz)) {
+        candidate.reason = "cpufreq rejected the clock";
+        return false;
+    }
+
+    Benchmark benchmark(seconds, 0, m_config.sysfsRoot, m_config.mailboxPath);
+    {
+        std::lock_guard<std::mutex> lock(m_runningMutex);
+        if (m_cancel) return false;
+        m_running = &benchmark;
+    }
+    candidate.result = benchmark.run();
+    {
+        std::lock_guard<std::mutex> lock(m_runningMutex);
+        m_running = nullptr;
+    }
+
+    const BenchmarkResult& result = candidate.result;
+    if (!result.valid) {
+        candidate.reason = "cancelled";
+    } else if (!result.verified()) {
+        candidate.reason = "wrong results";
+    } else if (result.throttleBits & 0x1) {
+        candidate.reason = "under-voltage";
+    } else if (result.throttleBits & 0x4) {
+        candidate.reason = "throttled";
+    } else if (result.throttleBits & 0x8) {
+        candidate.reason = "soft temperature limit";
+    } else if (result.peakTempMilliC >= m_config.tempLimitMilliC) {
+        candidate.reason = "temperature limit";
+    } else if (result.minFreqKHz != 0 && result.minFreqKHz < freqKHz) {
+        // The firmware lowered the clock without reporting it
+        candidate.reason = "clock not held";
+    } else {
+        candidate.stable = true;
+    }
+    return candidate.stable;
+}
+
+TuneResult AutoTuner::run(const ProgressCallback& progress) {
+    TuneResult tune;
+    m_cancel = false;
+
+    CpufreqBackend cpufreq(m_config.sysfsRoot);
+    if (cpufreq.policyCount() == 0) return tune;
+
+    // Candidate clocks: the OPP table, or fixed steps between the bounds
+    long lowest = m_config.minFreqKHz;
+    long highest = m_config.maxFreqKHz;
+    const CpufreqPolicy& policy = cpufreq.policy(0);
+    if (lowest <= 0) lowest = policy.cpuinfoMinKHz;
+    if (highest <= 0) highest = policy.cpuinfoMaxKHz;
+
+    std::vector<long> clocks;
+    for (long f : cpufreq.frequencies()) {
+        if (f >= lowest && f <= highest) clocks.push_back(f);
+    }
+    if (clocks.empty() && m_config.stepKHz > 0) {
+        for (long f = lowest; f <= highest; f += m_config.stepKHz) clocks.push_back(f);
+    }
+    if (clocks.empty()) return tune;
+
+    // Remember the current settings so the search leaves no trace
+    std::string savedGovernor;
+    long savedMin = 0;
+    long savedMax = 0;
+    bool saved = cpufreq.readGovernor(0, savedGovernor) && cpufreq.readLimits(0, savedMin, savedMax);
+
+    if (cpufreq.setGovernor("performance")) {
+        auto record = [&](const TuneCandidate& candidate) {
+            tune.candidates.push_back(candidate);
+            if (progress) progress(candidate);
+        };
+
+        // Highest index known stable and lowest index known unstable
+        int lo = -1;
+        int hi = static_cast<int>(clocks.size());
+        while (hi - lo > 1 && !m_cancel) {
+            int mid = lo + (hi - lo) / 2;
+            TuneCandidate candidate;
+            bool stable = test(cpufreq, clocks[mid], m_config.secondsPerKernel, candidate);
+            if (m_cancel) break;
+            record(candidate);
+            if (stable) lo = mid;
+            else hi = mid;
+        }
+
+        // Confirm with a longer run, stepping down on failure
+        for (int i = lo; i >= 0 && !m_cancel; i--) {
+            TuneCandidate candidate;
+            bool stable = test(cpufreq, clocks[i], m_config.confirmSeconds, candidate);
+            if (m_cancel) break;
+            record(candidate);
+            if (stable) {
+                tune.found = true;
+                tune.freqKHz = clocks[i];
+                tune.best = candidate.result;
+                break;
+            }
+        }
+    }
+
+    if (saved) {
+        cpufreq.setLimits(savedMin, savedMax);
+        cpufreq.setGovernor(savedGovernor);
+    }
+    return tune;
+}
@@ -0,0 +1,83 @@
+#ifndef OVERPI_AUTO_TUNER_H
+#define OVERPI_AUTO_TUNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpufreq_backend.h"
+
+// Search bounds and per-candidate workload
+struct TunerConfig {
+    long minFreqKHz;           // lowest candidate, 0 for the lowest OPP
+    long maxFreqKHz;           // highest candidate, 0 for cpuinfo_max_freq
+    long stepKHz;              // candidate spacing when no OPP table exists
+    double secondsPerKernel;   // benchmark length for each candidate
+    double confirmSeconds;     // longer run for the winner
+    long tempLimitMilliC;      // candidates reaching this are rejected
+    std::string sysfsRoot;
+    std::string mailboxPath;
+
+    TunerConfig()
+    : minFreqKHz(0), maxFreqKHz(0), stepKHz(100000),
+      secondsPerKernel(2.0), confirmSeconds(6.0), tempLimitMilliC(80000),
+      sysfsRoot("/sys"), mailboxPath("/dev/vcio") {}
+};
+
+// One tested clock
+struct TuneCandidate {
+    long freqKHz;
+    bool stable;
+    std::string reason;        // why it was rejected, empty if stable
+    BenchmarkResult result;
+};
+
+struct TuneResult {
+    bool found;
+    long freqKHz;              // fastest clock that passed confirmation
+    BenchmarkResult best;
+    std::vector<TuneCandidate> candidates;   // in test order
+
+    TuneResult() : found(false), freqKHz(0) {}
+};
+
+// Searches for the fastest CPU clock this board runs stably. Each
+// candidate is pinned hot through cpufreq and loaded with the verified
+// benchmark; it is rejected on wrong results, on under-voltage, throttling
+// or soft temperature limit bits (0x1, 0x4, 0x8), or when the temperature
+// reaches the limit. Stability is assumed to be monotonic in the clock, so
+// the candidates are binary searched and the winner is confirmed with a
+// longer run, stepping down until one passes. The original governor and
+// limits are restored afterwards.
+class AutoTuner {
+public:
+    typedef std::function<void(const TuneCandidate&)> ProgressCallback;
+
+    // get_throttled bits that reject a candidate
+    static const uint32_t kRejectBits = 0x1 | 0x4 | 0x8;
+
+    explicit AutoTuner(const TunerConfig& config = TunerConfig());
+
+    // Blocks for the whole search; progress is called after each candidate
+    TuneResult run(const ProgressCallback& progress = ProgressCallback());
+
+    // Ask a running search to stop after the current benchmark
+    void cancel();
+
+private:
+    AutoTuner(const AutoTuner&) = delete;
+    AutoTuner& operator=(const AutoTuner&) = delete;
+
+    bool test(CpufreqBackend& cpufreq, long freqKHz, double seconds, TuneCandidate& candidate);
+
+    TunerConfig m_config;
+    std::atomic<bool> m_cancel;
+    std::mutex m_runningMutex;
+    Benchmark* m_running;
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "snapshot_collector.h"
+
+namespace {
+enum Kernel {
+    KERNEL_HASH = 0,
+    KERNEL_FPU = 1,
+    KERNEL_STREAM = 2,
+    KERNEL_COUNT = 3
+};
+
+// hash: known answers for the first eight seeds
+const int kHashRounds = 1 << 16;
+const uint64_t kHashSeedStep = 0x9E3779B97F4A7C15ULL;
+const uint64_t kHashAnswers[8] = {
+    0x134c629dc0644451ULL,
+    0xf86b3e9ba1f0ae3eULL,
+    0x55e8b895127d3c50ULL,
+    0x67704a581ff46f5aULL,
+    0x1fab6ed2356b4d30ULL,
+    0x85a8a328c273fa2eULL,
+    0x90f6532e834870b7ULL,
+    0x9889978428623821ULL
+};
+
+// fpu: integer-valued operands keep every partial sum exact in float,
+// so the answer does not depend on summation order or SIMD width
+const int kDotLength = 4096;
+const int kDotShifts = 64;
+const int64_t kDotAnswer = 3145150;
+
+// stream: three arrays of 4 MiB per thread
+const size_t kStreamElems = 512 * 1024;
+
+const int kSampleIntervalMs = 200;
+
+uint64_t hashUnit(uint64_t seed) {
+    uint64_t x = seed;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < kHashRounds; i++) {
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        uint64_t v = x * 0x2545F4914F6CDD1DULL;
+        h = (h ^ v) * 0x100000001b3ULL;
+        h = (h << 31) | (h >> 33);
+    }
+    return h;
+}
+
+float dot(const float* a, const float* b, int n) {
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    return vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1) + vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3);
+#else
+    // Eight independent accumulators; compilers vectorise this on x86
+    float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < n; i += 8) {
+        for (int k = 0; k < 8; k++) acc[k] += a[i + k] * b[i + k];
+    }
+    return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+#endif
+}
+
+struct WorkerStats {
+    uint64_t units;
+    uint64_t errors;
+};
+
+void hashWorker(int id, const std::atomic<bool>& stop, WorkerStats& stats) {
+    uint64_t k = static_cast<uint64_t>(id);
+    while (!stop.load(std::memory_order_relaxed)) {
+        int seed = static_cast<int>(k++ % 8);
+        if (hashUnit(kHashSeedStep * (seed + 1)) != kHashAnswers[seed]) stats.errors++;
+        stats.units++;
+    }
+}
+
+void fpuWorker(const std::atomic<bool>& stop, WorkerStats& stats) {
+    std::vector<float> a(kDotLength);
+    std::vector<float> b(kDotLength + kDotShifts);
+    for (int i = 0; i < kDotLength; i++) a[i] = static_cast<float>(i % 7 + 1);
+    for (int i = 0; i < kDotLength + kDotShifts; i++) b[i] = static_cast<float>(i % 5 + 1);
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        // Reload through volatile so the work cannot be hoisted out of the loop
+        const float* volatile pa = a.data();
+        const float* volatile pb = b.data();
+        int64_t total = 0;
+        for (int r = 0; r < kDotShifts; r++) {
+            total += static_cast<int64_t>(dot(pa, pb + r, kDotLength));
+        }
+        if (total != kDotAnswer) stats.errors++;
+        stats.units++;
+    }
+}
+
+void streamWorker(const std::atomic<bool>& stop, WorkerStats& stats) {
+    // First touch happens on the worker so pages are local to its core
+    std::vector<double> a(kStreamElems), b(kStreamElems), c(kStreamElems);
+    for (size_t i = 0; i < kStreamElems; i++) {
+        b[i] = static_cast<double>(i & 1023);
+        c[i] = static_cast<double>(i % 7);
+    }
+
+    uint64_t unit = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        const int scalar = 1 + static_cast<int>(unit & 3);
+        const double s = scalar;
+        double* pa = a.data();
+        const double* pb = b.data();
+        const double* pc = c.data();
+        for (size_t i = 0; i < kStreamElems; i++) pa[i] = pb[i] + s * pc[i];
+
+        // Check one element per cache line against the integer formula
+        bool ok = true;
+        for (size_t i = unit & 7; i < kStreamElems; i += 8) {
+            int64_t expected = static_cast<int64_t>(i & 1023) + scalar * static_cast<int64_t>(i % 7);
+            if (pa[i] != static_cast<double>(expected)) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) stats.errors++;
+        stats.units++;
+        unit++;
+    }
+}
+}
+
+bool BenchmarkResult::verified() const {
+    if (kernels.empty()) return false;
+    for (const auto& kernel : kernels) {
+        if (kernel.errors != 0 || kernel.workUnits == 0) return false;
+    }
+    return true;
+}
+
+Benchmark::Benchmark(double secondsPerKernel, int threads, const std::string& sysfsRoot, const std::string& mailboxPath)
+: m_secondsPerKernel(secondsPerKernel),
+  m_threads(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+  m_sysfsRoot(sysfsRoot),
+  m_mailboxPath(mailboxPath),
+  m_cancel(false) {
+}
+
+BenchmarkResult Benchmark::run() {
+    BenchmarkResult result;
+    result.threads = m_threads;
+    result.minFreqKHz = 0;
+
+    FrequencyAccumulator freq = {0, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (int kernel = 0; kernel < KERNEL_COUNT && !m_cancel; kernel++) {
+        result.kernels.push_back(runKernel(kernel, result, freq));
+    }
+    if (freq.samples > 0) result.avgFreqKHz = static_cast<long>(freq.sumKHz / freq.samples);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.valid = !m_cancel && result.kernels.size() == KERNEL_COUNT;
+    return result;
+}
+
+KernelResult Benchmark::runKernel(int kernel, BenchmarkResult& result, FrequencyAccumulator& freq) {
+    std::atomic<bool> stop(false);
+    std::vector<WorkerStats> stats(m_threads, WorkerStats{0, 0});
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < m_threads; t++) {
+        workers.push_back(std::thread([kernel, t, &stop, &stats]() {
+            switch (kernel) {
+            case KERNEL_HASH: hashWorker(t, stop, stats[t]); break;
+            case KERNEL_FPU: fpuWorker(stop, stats[t]); break;
+            default: streamWorker(stop, stats[t]); break;
+            }
+        }));
+    }
+
+    // Sample clocks, temperature and throttling while the kernel runs
+    SnapshotCollector collector(m_sysfsRoot, m_mailboxPath);
+
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(m_secondsPerKernel));
+    while (std::chrono::steady_clock::now() < deadline && !m_cancel) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kSampleIntervalMs));
+
+        SystemSnapshot snapshot;
+        collector.collect(snapshot);
+        for (int cpu = 0; cpu < snapshot.cpuCount; cpu++) {
+            if (!snapshot.cpuFreqValid[cpu]) continue;
+            long kHz = snapshot.cpuFreqKHz[cpu];
+            freq.sumKHz += kHz;
+            freq.samples++;
+            if (result.minFreqKHz == 0 || kHz < result.minFreqKHz) result.minFreqKHz = kHz;
+            result.maxFreqKHz = std::max(result.maxFreqKHz, kHz);
+        }
+        if (snapshot.temperatureValid) {
+            result.peakTempMilliC = std::max(result.peakTempMilliC, snapshot.temperatureMilliC);
+        }
+        if (snapshot.firmwareValid && snapshot.firmware.throttledValid) {
+            result.throttleBits |= snapshot.firmware.throttled;
+        }
+    }
+
+    stop = true;
+    for (auto& worker : workers) worker.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    KernelResult kr;
+    kr.workUnits = 0;
+    kr.errors = 0;
+    for (const auto& s : stats) {
+        kr.workUnits += s.units;
+        kr.errors += s.errors;
+    }
+
+    double work = 0;
+    switch (kernel) {
+    case KERNEL_HASH:
+        kr.name = "hash";
+        kr.unit = "Mhash/s";
+        work = static_cast<double>(kr.workUnits) * kHashRounds / 1e6;
+        break;
+    case KERNEL_FPU:
+        kr.name = "fpu";
+        kr.unit = "MFLOPS";
+        work = static_cast<double>(kr.workUnits) * kDotShifts * kDotLength * 2 / 1e6;
+        break;
+    default:
+        kr.name = "stream";
+        kr.unit = "MB/s";
+        work = static_cast<double>(kr.workUnits) * kStreamElems * 3 * sizeof(double) / 1e6;
+        break;
+    }
+    kr.score = elapsed > 0 ? work / elapsed : 0;
+    return kr;
+}
+
+std::string Benchmark::format(const BenchmarkResult& result) {
+    std::string text;
+    char line[160];
+
+    for (const auto& kernel : result.kernels) {
+        snprintf(line, sizeof(line), "%-8s %12.1f %-8s %s\n", kernel.name.c_str(), kernel.score, kernel.unit.c_str(),
+                 kernel.errors ? "FAILED" : "ok");
+        text += line;
+        if (kernel.errors) {
+            snprintf(line, sizeof(line), "         %llu of %llu work units wrong\n",
+                     static_cast<unsigned long long>(kernel.errors), static_cast<unsigned long long>(kernel.workUnits));
+            text += line;
+        }
+    }
+
+    snprintf(line, sizeof(line), "threads: %d, %.1f s\nclock: avg %ld MHz (min %ld, max %ld)\npeak temperature: %.1f °C\nthrottled: 0x%x\n",
+             result.threads, result.seconds,
+             result.avgFreqKHz / 1000, result.minFreqKHz / 1000, result.maxFreqKHz / 1000,
+             result.peakTempMilliC / 1000.0, result.throttleBits);
+    text += line;
+    return text;
+}
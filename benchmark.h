@@ -0,0 +1,76 @@
+#ifndef OVERPI_BENCHMARK_H
+#define OVERPI_BENCHMARK_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Score of one kernel over all cores
+struct KernelResult {
+    std::string name;
+    std::string unit;
+    double score;          // units per second, summed over threads
+    uint64_t workUnits;    // verified work units completed
+    uint64_t errors;       // work units whose result did not match
+};
+
+// Outcome of a benchmark run
+struct BenchmarkResult {
+    std::vector<KernelResult> kernels;
+    int threads;
+    double seconds;
+    long avgFreqKHz;       // mean of all cores over the run
+    long minFreqKHz;       // lowest core clock seen
+    long maxFreqKHz;       // highest core clock seen
+    long peakTempMilliC;
+    uint32_t throttleBits; // OR of get_throttled over the run
+    bool valid;
+
+    BenchmarkResult()
+    : threads(0), seconds(0),
+      avgFreqKHz(0), minFreqKHz(0), maxFreqKHz(0), peakTempMilliC(0),
+      throttleBits(0), valid(false) {}
+
+    // True when every work unit matched its known answer
+    bool verified() const;
+};
+
+// Stability and performance benchmark. Every kernel checks each work unit
+// against a known answer, so silent errors from an unstable overclock show
+// up as errors instead of as a higher score.
+//   hash    64-bit xorshift/FNV integer mixing
+//   fpu     float dot products (NEON on ARM, portable loop elsewhere)
+//   stream  STREAM-style triad over arrays larger than the caches
+class Benchmark {
+public:
+    explicit Benchmark(double secondsPerKernel = 3.0, int threads = 0,
+                       const std::string& sysfsRoot = "/sys",
+                       const std::string& mailboxPath = "/dev/vcio");
+
+    BenchmarkResult run();
+
+    // Ask a running benchmark to finish early
+    void cancel() { m_cancel = true; }
+
+    static std::string format(const BenchmarkResult& result);
+
+private:
+    Benchmark(const Benchmark&) = delete;
+    Benchmark& operator=(const Benchmark&) = delete;
+
+    struct FrequencyAccumulator {
+        double sumKHz;
+        long samples;
+    };
+
+    KernelResult runKernel(int kernel, BenchmarkResult& result, FrequencyAccumulator& freq);
+
+    double m_secondsPerKernel;
+    int m_threads;
+    std::string m_sysfsRoot;
+    std::string m_mailboxPath;
+    std::atomic<bool> m_cancel;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "board_sim.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config_txt.h"
+#include "file_tree.h"
+
+namespace {
+// Model step; short against the thermal time constant and the cap slew
+const double kMaxSubstepSeconds = 0.05;
+const double kOverVoltageStepVolts = 0.025;
+
+long configLong(const ConfigTxt& config, const char* key, long fallback) {
+    std::string value;
+    if (!config.get(key, value)) return fallback;
+    char* end = nullptr;
+    long result = strtol(value.c_str(), &end, 10);
+    return end == value.c_str() ? fallback : result;
+}
+}
+
+SimulatedBoard::SimulatedBoard(const std::string& root, const SimConfig& config)
+: m_config(config),
+  m_root(root),
+  m_armFreqKHz(config.defaultArmFreqMHz * 1000),
+  m_gpuFreqKHz(config.defaultGpuFreqMHz * 1000),
+  m_overVoltage(0),
+  m_forceTurbo(false),
+  m_hardLimitMilliC(config.defaultTempLimitC * 1000),
+  m_nowNs(0),
+  m_tempC(config.ambientC),
+  m_capKHz(m_armFreqKHz),
+  m_requestedKHz(config.minFreqKHz),
+  m_clockKHz(config.minFreqKHz),
+  m_powerW(config.idleWatts),
+  m_coreVolts(config.baseVolts),
+  m_supplyV(config.supplyVolts),
+  m_throttled(0),
+  m_underVoltageHold(0),
+  m_stateCarry(0) {
+}
+
+std::string SimulatedBoard::policyDir() const {
+    return sysfsRoot() + "/devices/system/cpu/cpufreq/policy0";
+}
+
+std::string SimulatedBoard::cpuDir(int cpu) const {
+    return sysfsRoot() + "/devices/system/cpu/cpu" + std::to_string(cpu);
+}
+
+bool SimulatedBoard::writeNode(const std::string& path, const std::string& value) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    bool ok = fputs(value.c_str(), f) >= 0 && fputc('\n', f) != EOF;
+    return fclose(f) == 0 && ok;
+}
+
+bool SimulatedBoard::readNode(const std::string& path, std::string& value) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    char buf[256];
+    bool ok = fgets(buf, sizeof(buf), f) != nullptr;
+    fclose(f);
+    if (!ok) return false;
+
+    // pwrite() from the code under test leaves the tail of a longer old
+    // value behind; the first line is what a kernel would have stored
+    value = buf;
+    while (!value.empty() && (value.back() == '\n' || value.back() == ' ')) value.pop_back();
+    return true;
+}
+
+long SimulatedBoard::readKHz(const std::string& path, long fallback) {
+    std::string value;
+    if (!readNode(path, value)) return fallback;
+    char* end = nullptr;
+    long kHz = strtol(value.c_str(), &end, 10);
+    return end == value.c_str() ? fallback : kHz;
+}
+
+long SimulatedBoard::quantize(long kHz) const {
+    // Highest operating point at or below kHz, like the firmware's clock
+    long result = m_opps.front();
+    for (long opp : m_opps) {
+        if (opp <= kHz) result = opp;
+    }
+    return result;
+}
+
+bool SimulatedBoard::create() {
+    makeDirs(sysfsRoot() + "/class/thermal/thermal_zone0");
+    makeDirs(policyDir() + "/stats");
+    for (int cpu = 0; cpu < m_config.cores; cpu++) {
+        // All cores share one policy, as on the BCM2711
+        makeDirs(cpuDir(cpu));
+        std::string link = cpuDir(cpu) + "/cpufreq";
+        if (symlink("../cpufreq/policy0", link.c_str()) != 0 && errno != EEXIST) return false;
+    }
+
+    makeDirs(m_root + "/boot");
+    struct stat st;
+    if (stat(configPath().c_str(), &st) != 0 && !writeNode(configPath(), "[all]")) return false;
+    return boot();
+}
+
+bool SimulatedBoard::boot() {
+    ConfigTxt config(m_config.boardFilters);
+    if (!config.load(configPath())) return false;
+
+    m_armFreqKHz = std::max(configLong(config, "arm_freq", m_config.defaultArmFreqMHz) * 1000, m_config.minFreqKHz);
+    m_gpuFreqKHz = configLong(config, "gpu_freq", m_config.defaultGpuFreqMHz) * 1000;
+    m_overVoltage = static_cast<int>(configLong(config, "over_voltage", 0));
+    m_forceTurbo = configLong(config, "force_turbo", 0) != 0;
+    m_hardLimitMilliC = configLong(config, "temp_limit", m_config.defaultTempLimitC) * 1000;
+
+    m_opps.clear();
+    for (long kHz = m_config.minFreqKHz; kHz < m_armFreqKHz; kHz += m_config.oppStepKHz) m_opps.push_back(kHz);
+    m_opps.push_back(m_armFreqKHz);
+    m_timeInState.assign(m_opps.size(), 0);
+    m_stateCarry = 0;
+
+    m_capKHz = m_armFreqKHz;
+    m_requestedKHz = m_opps.front();
+    m_clockKHz = m_opps.front();
+    m_throttled = 0;
+    m_underVoltageHold = 0;
+
+    std::string opps;
+    for (long kHz : m_opps) opps += std::to_string(kHz) + " ";
+    std::string policy = policyDir();
+    bool ok = writeNode(policy + "/scaling_available_frequencies", opps)
+           && writeNode(policy + "/cpuinfo_min_freq", std::to_string(m_opps.front()))
+           && writeNode(policy + "/cpuinfo_max_freq", std::to_string(m_armFreqKHz))
+           && writeNode(policy + "/scaling_min_freq", std::to_string(m_opps.front()))
+           && writeNode(policy + "/scaling_max_freq", std::to_string(m_armFreqKHz))
+           && writeNode(policy + "/scaling_governor", "ondemand");
+    writeSensors();
+    return ok;
+}
+
+void SimulatedBoard::step(double seconds, double load) {
+    if (seconds <= 0) return;
+    load = std::min(std::max(load, 0.0), 1.0);
+
+    // What the code under test asked cpufreq for; rewrite the nodes clean
+    std::string policy = policyDir();
+    std::string governor;
+    if (!readNode(policy + "/scaling_governor", governor)) governor = "ondemand";
+    long minKHz = std::max(readKHz(policy + "/scaling_min_freq", m_opps.front()), m_opps.front());
+    long maxKHz = std::min(readKHz(policy + "/scaling_max_freq", m_armFreqKHz), m_armFreqKHz);
+    if (maxKHz < minKHz) maxKHz = minKHz;
+    writeNode(policy + "/scaling_governor", governor);
+    writeNode(policy + "/scaling_min_freq", std::to_string(minKHz));
+    writeNode(policy + "/scaling_max_freq", std::to_string(maxKHz));
+
+    long requested;
+    if (governor == "performance") {
+        requested = maxKHz;
+    } else if (governor == "powersave") {
+        requested = minKHz;
+    } else {
+        // ondemand and schedutil scale roughly with utilisation
+        requested = minKHz + static_cast<long>(load * (maxKHz - minKHz));
+        auto it = std::lower_bound(m_opps.begin(), m_opps.end(), requested);
+        requested = it == m_opps.end() ? m_opps.back() : *it;
+        requested = std::min(std::max(requested, minKHz), maxKHz);
+    }
+    m_requestedKHz = quantize(requested);
+
+    int substeps = static_cast<int>(std::ceil(seconds / kMaxSubstepSeconds));
+    double dt = seconds / substeps;
+    double minVolts = m_config.baseVolts;
+    double turboVolts = m_config.baseVolts + kOverVoltageStepVolts * m_overVoltage;
+    long softLimit = m_config.softLimitMilliC;
+
+    for (int i = 0; i < substeps; i++) {
+        long milliC = static_cast<long>(m_tempC * 1000);
+
+        // Soft limit: the firmware walks its ARM cap down while above it
+        // and back up once it has cooled past the hysteresis
+        double slew = m_config.capStepKHz * dt;
+        if (milliC >= softLimit) {
+            m_capKHz = std::max(m_capKHz - static_cast<long>(slew), m_opps.front());
+        } else if (milliC < softLimit - m_config.softHysteresisMilliC) {
+            m_capKHz = std::min(m_capKHz + static_cast<long>(slew), m_armFreqKHz);
+        }
+
+        bool hard = milliC >= m_hardLimitMilliC;
+        bool underVoltage = m_underVoltageHold > 0;
+        long cappedKHz = std::min(m_requestedKHz, quantize(m_capKHz));
+        m_clockKHz = hard || underVoltage ? m_opps.front() : cappedKHz;
+
+        m_coreVolts = m_clockKHz > m_opps.front() || m_forceTurbo ? turboVolts : minVolts;
+        double ghz = m_clockKHz / 1e6;
+        m_powerW = m_config.idleWatts
+                 + m_config.dynamicWatts * load * m_config.cores * ghz * m_coreVolts * m_coreVolts;
+
+        // Supply sag across the cable; the PMIC latches under-voltage
+        m_supplyV = m_config.supplyVolts - m_powerW / m_config.supplyVolts * m_config.supplyOhms;
+        if (m_supplyV < m_config.underVoltageVolts) {
+            m_underVoltageHold = m_config.underVoltageHoldMs / 1000.0;
+            underVoltage = true;
+        } else {
+            m_underVoltageHold = std::max(m_underVoltageHold - dt, 0.0);
+        }
+
+        // First-order RC: C dT/dt = P - (T - ambient) / R
+        double leak = (m_tempC - m_config.ambientC) / m_config.thermalResistance;
+        m_tempC += dt * (m_powerW - leak) / m_config.thermalCapacity;
+
+        uint32_t live = 0;
+        if (underVoltage) live |= 0x1;
+        if (cappedKHz < m_requestedKHz) live |= 0x2;
+        if (hard || underVoltage) live |= 0x4;
+        if (milliC >= softLimit) live |= 0x8;
+        m_throttled = live | (m_throttled & 0xF0000) | (live << 16);
+
+        // time_in_state counts 10 ms ticks at the delivered clock
+        m_stateCarry += dt * 100.0;
+        uint64_t ticks = static_cast<uint64_t>(m_stateCarry);
+        m_stateCarry -= ticks;
+        size_t index = std::lower_bound(m_opps.begin(), m_opps.end(), m_clockKHz) - m_opps.begin();
+        if (index < m_timeInState.size()) m_timeInState[index] += ticks;
+
+        m_nowNs += static_cast<int64_t>(dt * 1e9);
+    }
+    writeSensors();
+}
+
+void SimulatedBoard::writeSensors() {
+    writeNode(sysfsRoot() + "/class/thermal/thermal_zone0/temp", std::to_string(static_cast<long>(m_tempC * 1000)));
+    writeNode(policyDir() + "/scaling_cur_freq", std::to_string(m_clockKHz));
+
+    std::string stats;
+    for (size_t i = 0; i < m_opps.size(); i++) {
+        stats += std::to_string(m_opps[i]) + " " + std::to_string(m_timeInState[i]) + "\n";
+    }
+    stats.pop_back();
+    writeNode(policyDir() + "/stats/time_in_state", stats);
+}
+
+bool SimulatedBoard::query(VcReading& reading) {
+    reading = VcReading();
+    // gpu_freq sets the core, v3d, h264 and isp domains together; they
+    // follow the ARM into the throttled floor. EMMC, SDRAM and the SDRAM
+    // rails are not modelled and read as unavailable.
+    bool floored = (m_throttled & 0x5) != 0;
+    uint32_t gpuHz = static_cast<uint32_t>(floored ? std::min(m_gpuFreqKHz, 250000L) : m_gpuFreqKHz) * 1000;
+    const int gpuDomains[] = {VC_DOMAIN_CORE, VC_DOMAIN_V3D, VC_DOMAIN_H264, VC_DOMAIN_ISP};
+    for (int domain : gpuDomains) {
+        reading.clockValid[domain] = true;
+        reading.clockHz[domain] = gpuHz;
+    }
+    reading.clockValid[VC_DOMAIN_ARM] = true;
+    reading.clockHz[VC_DOMAIN_ARM] = static_cast<uint32_t>(m_clockKHz) * 1000;
+    reading.throttledValid = true;
+    reading.throttled = m_throttled;
+    reading.voltsValid[VC_RAIL_CORE] = true;
+    reading.microVolts[VC_RAIL_CORE] = static_cast<uint32_t>(m_coreVolts * 1e6);
+    return true;
+}
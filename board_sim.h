@@ -0,0 +1,119 @@
+#ifndef OVERPI_BOARD_SIM_H
+#define OVERPI_BOARD_SIM_H
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "vc_mailbox.h"
+
+// Physical constants of the simulated board. The defaults approximate a
+// passively cooled Pi 4 class board on a thin USB cable.
+struct SimConfig {
+    int cores;
+    double ambientC;
+    double thermalResistance;     // °C per watt, die to ambient
+    double thermalCapacity;       // joules per °C; with the resistance, a time constant of ~100 s
+    double idleWatts;
+    double dynamicWatts;          // per fully loaded core, per GHz, per volt squared
+    double baseVolts;             // core voltage at over_voltage=0; each step adds 25 mV
+    double supplyVolts;           // at the power supply, unloaded
+    double supplyOhms;            // cable and connector resistance
+    double underVoltageVolts;     // the PMIC flags under-voltage below this
+    long underVoltageHoldMs;      // and the firmware stays throttled this long after
+    long softLimitMilliC;         // firmware starts capping the ARM clock here
+    long softHysteresisMilliC;    // and raises it again this far below
+    long capStepKHz;              // cap change per second around the soft limit
+    long minFreqKHz;              // lowest OPP, and the clock when throttled
+    long oppStepKHz;              // spacing of the generated OPP table
+    long defaultArmFreqMHz;       // when config.txt sets no arm_freq
+    long defaultGpuFreqMHz;
+    long defaultTempLimitC;       // firmware hard limit when config.txt sets no temp_limit
+    std::set<std::string> boardFilters;   // config.txt filters the board matches
+
+    SimConfig()
+    : cores(4), ambientC(25.0), thermalResistance(8.5), thermalCapacity(12.0),
+      idleWatts(2.0), dynamicWatts(1.0), baseVolts(0.85),
+      supplyVolts(5.1), supplyOhms(0.25), underVoltageVolts(4.63), underVoltageHoldMs(5000),
+      softLimitMilliC(80000), softHysteresisMilliC(2000), capStepKHz(100000),
+      minFreqKHz(600000), oppStepKHz(100000),
+      defaultArmFreqMHz(1500), defaultGpuFreqMHz(500), defaultTempLimitC(85),
+      boardFilters({"pi4"}) {}
+};
+
+// A board that runs faster than real time. It owns a sysfs tree and a
+// config.txt under root, so the real CpufreqBackend, SensorSampler,
+// ThermalGovernor and config.txt engine drive it unchanged; the firmware
+// state is served through FirmwareSource.
+//
+// Each step reads the cpufreq governor and limits the code under test
+// wrote, picks the clock the kernel would request for the given load,
+// applies the firmware's soft-limit cap, hard-limit and under-voltage
+// throttling, integrates a first-order thermal RC model, and writes the
+// temperature, scaling_cur_freq and time_in_state back.
+class SimulatedBoard : public FirmwareSource {
+public:
+    explicit SimulatedBoard(const std::string& root, const SimConfig& config = SimConfig());
+
+    // Create the sysfs tree and an empty config.txt under root
+    bool create();
+
+    // Read config.txt and restart the firmware: clears the sticky throttle
+    // bits and regenerates the OPP table. The temperature carries over.
+    bool boot();
+
+    // Advance simulated time under a CPU load from 0 (idle) to 1 (all cores)
+    void step(double seconds, double load);
+
+    bool query(VcReading& reading) override;
+
+    std::string sysfsRoot() const { return m_root + "/sys"; }
+    std::string configPath() const { return m_root + "/boot/config.txt"; }
+    const std::set<std::string>& boardFilters() const { return m_config.boardFilters; }
+
+    int64_t nowNs() const { return m_nowNs; }
+    double temperatureC() const { return m_tempC; }
+    long clockKHz() const { return m_clockKHz; }           // after firmware throttling
+    long requestedKHz() const { return m_requestedKHz; }   // what cpufreq asked for
+    double powerWatts() const { return m_powerW; }
+    double coreVolts() const { return m_coreVolts; }
+    double supplyVoltsNow() const { return m_supplyV; }
+    uint32_t throttled() const { return m_throttled; }
+
+private:
+    std::string cpuDir(int cpu) const;
+    std::string policyDir() const;
+    bool writeNode(const std::string& path, const std::string& value);
+    bool readNode(const std::string& path, std::string& value);
+    long readKHz(const std::string& path, long fallback);
+    long quantize(long kHz) const;
+    void writeSensors();
+
+    SimConfig m_config;
+    std::string m_root;
+
+    // Boot-time settings from config.txt
+    long m_armFreqKHz;
+    long m_gpuFreqKHz;
+    int m_overVoltage;
+    bool m_forceTurbo;
+    long m_hardLimitMilliC;
+    std::vector<long> m_opps;
+    std::vector<uint64_t> m_timeInState;   // 10 ms units, per OPP
+
+    // Model state
+    int64_t m_nowNs;
+    double m_tempC;
+    long m_capKHz;
+    long m_requestedKHz;
+    long m_clockKHz;
+    double m_powerW;
+    double m_coreVolts;
+    double m_supplyV;
+    uint32_t m_throttled;
+    double m_underVoltageHold;             // seconds left
+    double m_stateCarry;                   // time_in_state remainder below 10 ms
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "config_txt.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ConfigTxt::ConfigTxt(const std::set<std::string>& boardFilters)
+: m_trailingNewline(true) {
+    setBoardFilters(boardFilters);
+    parse("");
+}
+
+void ConfigTxt::setBoardFilters(const std::set<std::string>& filters) {
+    m_boardFilters = filters;
+    m_boardFilters.insert("all");
+}
+
+std::string ConfigTxt::trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool ConfigTxt::load(const std::string& path, std::string* error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            parse("");
+            return true;
+        }
+        if (error) *error = path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::string content;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) content.append(buf, n);
+    int readErrno = errno;
+    close(fd);
+    if (n < 0) {
+        if (error) *error = path + ": " + std::strerror(readErrno);
+        return false;
+    }
+
+    parse(content);
+    return true;
+}
+
+void ConfigTxt::parse(const std::string& content) {
+    m_original = content;
+    m_lines.clear();
+    m_sections.clear();
+
+    // Before the first filter everything applies
+    m_sections.push_back(std::vector<std::string>(1, "all"));
+    bool previousWasFilter = false;
+
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) end = content.size();
+
+        Line line;
+        line.text = content.substr(start, end - start);
+        line.isFilter = false;
+        line.isSetting = false;
+
+        std::string body = trim(line.text);
+        if (!body.empty() && body[0] == '[' && body[body.size() - 1] == ']') {
+            // "[pi4]" or "[pi4][HDMI:0]"; consecutive filter lines combine too
+            std::vector<std::string> filters;
+            if (previousWasFilter) filters = m_sections.back();
+            size_t pos = 0;
+            while ((pos = body.find('[', pos)) != std::string::npos) {
+                size_t close = body.find(']', pos);
+                if (close == std::string::npos) break;
+                std::string filter = trim(body.substr(pos + 1, close - pos - 1));
+                if (filter == "all") filters.clear();
+                filters.push_back(filter);
+                pos = close + 1;
+            }
+            if (previousWasFilter) m_sections.back() = filters;
+            else m_sections.push_back(filters);
+            line.isFilter = true;
+        } else if (!body.empty() && body[0] != '#') {
+            size_t eq = body.find('=');
+            if (eq != std::string::npos) {
+                line.isSetting = true;
+                line.key = trim(body.substr(0, eq));
+            }
+        }
+        previousWasFilter = line.isFilter;
+        line.section = m_sections.size() - 1;
+        m_lines.push_back(line);
+
+        start = end + 1;
+    }
+    m_trailingNewline = content.empty() || content[content.size() - 1] == '\n';
+}
+
+bool ConfigTxt::sectionApplies(size_t section) const {
+    for (const auto& filter : m_sections[section]) {
+        if (m_boardFilters.find(filter) == m_boardFilters.end()) return false;
+    }
+    return true;
+}
+
+bool ConfigTxt::get(const std::string& key, std::string& value) const {
+    bool found = false;
+    for (const auto& line : m_lines) {
+        if (!line.isSetting || line.key != key || !sectionApplies(line.section)) continue;
+        value = trim(line.text.substr(line.text.find('=') + 1));
+        found = true;
+    }
+    return found;
+}
+
+bool ConfigTxt::set(const std::string& key, const std::string& value) {
+    std::string text = key + "=" + value;
+
+    // The last applying assignment is the one the firmware uses
+    for (size_t i = m_lines.size(); i-- > 0;) {
+        Line& line = m_lines[i];
+        if (!line.isSetting || line.key != key || !sectionApplies(line.section)) continue;
+
+        std::string current;
+        get(key, current);
+        if (current == value) return false;
+        line.text = text;
+        return true;
+    }
+
+    // Append, opening an [all] section if the file ends inside a filter
+    Line line;
+    line.isFilter = false;
+    line.isSetting = true;
+    line.key = key;
+    line.text = text;
+
+    size_t last = m_lines.empty() ? 0 : m_lines.back().section;
+    const std::vector<std::string>& filters = m_sections[last];
+    if (!(filters.size() == 1 && filters[0] == "all")) {
+        Line header;
+        header.text = "[all]";
+        header.isFilter = true;
+        header.isSetting = false;
+        m_sections.push_back(std::vector<std::string>(1, "all"));
+        header.section = m_sections.size() - 1;
+        m_lines.push_back(header);
+    }
+    line.section = m_sections.size() - 1;
+    m_lines.push_back(line);
+    m_trailingNewline = true;
+    return true;
+}
+
+std::string ConfigTxt::serialize() const {
+    std::string out;
+    for (size_t i = 0; i < m_lines.size(); i++) {
+        out += m_lines[i].text;
+        if (i + 1 < m_lines.size() || m_trailingNewline) out += '\n';
+    }
+    return out;
+}
+
+bool ConfigTxt::save(const std::string& path, bool* written, std::string* error) const {
+    if (written) *written = false;
+
+    // Compare with what is on disk now, not with what was loaded
+    std::string content = serialize();
+    struct stat st;
+    ConfigTxt current(m_boardFilters);
+    if (stat(path.c_str(), &st) == 0 && current.load(path) && current.original() == content) return true;
+
+    if (!writeFileAtomic(path, content, error)) return false;
+    if (written) *written = true;
+    return true;
+}
+
+bool ConfigTxt::writeFileAtomic(const std::string& path, const std::string& content, std::string* error) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    // Same directory, so the rename never crosses a filesystem
+    std::string temp = dir + "/." + name + ".XXXXXX";
+    std::vector<char> tempPath(temp.begin(), temp.end());
+    tempPath.push_back('\0');
+
+    auto fail = [&](const std::string& what) {
+        if (error) *error = what + ": " + std::strerror(errno);
+        return false;
+    };
+
+    int fd = mkstemp(tempPath.data());
+    if (fd < 0) return fail(temp);
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) fchmod(fd, st.st_mode & 07777);
+    else fchmod(fd, 0644);
+
+    const char* p = content.data();
+    size_t left = content.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            int saved = errno;
+            close(fd);
+            unlink(tempPath.data());
+            errno = saved;
+            return fail(tempPath.data());
+        }
+        p += n;
+        left -= n;
+    }
+
+    if (fsync(fd) != 0) {
+        int saved = errno;
+        close(fd);
+        unlink(tempPath.data());
+        errno = saved;
+        return fail(tempPath.data());
+    }
+    close(fd);
+
+    if (rename(tempPath.data(), path.c_str()) != 0) {
+        int saved = errno;
+        unlink(tempPath.data());
+        errno = saved;
+        return fail(path);
+    }
+
+    // Make the rename itself durable
+    int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef OVERPI_CONFIG_TXT_H
+#define OVERPI_CONFIG_TXT_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Section-aware model of the firmware's config.txt. Every line is kept
+// verbatim, so a save rewrites only the settings that were changed.
+//
+// Conditional filters such as [pi4] or [all] open a section that lasts
+// until the next filter; consecutive filters combine. A section applies
+// to this board when each of its filters is all or one of the board's
+// filters, e.g. pi4 and pi400 on a Raspberry Pi 400.
+class ConfigTxt {
+public:
+    explicit ConfigTxt(const std::set<std::string>& boardFilters);
+
+    // A missing file loads as empty
+    bool load(const std::string& path, std::string* error = nullptr);
+    void parse(const std::string& content);
+
+    void setBoardFilters(const std::set<std::string>& filters);
+
+    // Effective value for this board: the last assignment in an applying section
+    bool get(const std::string& key, std::string& value) const;
+
+    // Change the effective assignment in place, or append the key under
+    // [all] when no applying section sets it. Returns true if the text changed.
+    bool set(const std::string& key, const std::string& value);
+
+    std::string serialize() const;
+    const std::string& original() const { return m_original; }
+    bool modified() const { return serialize() != m_original; }
+
+    // Write through a temp file in the same directory, fsync it, rename it
+    // over path and fsync the directory. Nothing is written when the file
+    // already holds this content; written reports which case it was.
+    bool save(const std::string& path, bool* written = nullptr, std::string* error = nullptr) const;
+
+    static bool writeFileAtomic(const std::string& path, const std::string& content, std::string* error = nullptr);
+
+private:
+    struct Line {
+        std::string text;
+        size_t section;       // index into m_sections
+        bool isFilter;
+        bool isSetting;
+        std::string key;
+    };
+
+    bool sectionApplies(size_t section) const;
+    static std::string trim(const std::string& s);
+
+    std::vector<Line> m_lines;
+    std::vector<std::vector<std::string>> m_sections;   // filters of each section
+    std::set<std::string> m_boardFilters;
+    std::string m_original;
+    bool m_trailingNewline;
+};
+
+#endif
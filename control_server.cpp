@@ -0,0 +1,160 @@
+#include "control_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const size_t ControlServer::kMaxLine;
+const size_t ControlServer::kMaxOutput;
+const size_t ControlServer::kMaxClients;
+
+ControlServer::ControlServer(EventLoop& loop, const RequestHandler& handler)
+: m_loop(loop),
+  m_handler(handler),
+  m_listenFd(-1) {
+}
+
+ControlServer::~ControlServer() {
+    close();
+}
+
+bool ControlServer::listen(const std::string& path, mode_t mode) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    close();
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) return false;
+
+    unlink(path.c_str());
+    if (bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        chmod(path.c_str(), mode) != 0 ||
+        ::listen(m_listenFd, 64) != 0 ||
+        !m_loop.add(m_listenFd, EPOLLIN, [this](uint32_t) { onAccept(); })) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        unlink(path.c_str());
+        return false;
+    }
+    m_path = path;
+    return true;
+}
+
+void ControlServer::close() {
+    while (!m_clients.empty()) drop(m_clients.begin()->first);
+
+    if (m_listenFd >= 0) {
+        m_loop.remove(m_listenFd);
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        unlink(m_path.c_str());
+    }
+}
+
+void ControlServer::onAccept() {
+    for (;;) {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        if (m_clients.size() >= kMaxClients ||
+            !m_loop.add(fd, EPOLLIN | EPOLLRDHUP, [this, fd](uint32_t events) { onClient(fd, events); })) {
+            ::close(fd);
+            continue;
+        }
+        Client& client = m_clients[fd];
+        client.closing = false;
+        client.events = EPOLLIN | EPOLLRDHUP;
+    }
+}
+
+void ControlServer::onClient(int fd, uint32_t events) {
+    auto it = m_clients.find(fd);
+    if (it == m_clients.end()) return;
+    Client& client = it->second;
+
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        drop(fd);
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP)) {
+        char buf[4096];
+        bool eof = false;
+        for (;;) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                client.input.append(buf, n);
+                continue;
+            }
+            if (n == 0) eof = true;
+            else if (errno == EINTR) continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK) eof = true;
+            break;
+        }
+
+        // Answer every complete line
+        size_t start = 0;
+        size_t end;
+        while (!client.closing && (end = client.input.find('\n', start)) != std::string::npos) {
+            std::string request = client.input.substr(start, end - start);
+            if (!request.empty() && request[request.size() - 1] == '\r') request.erase(request.size() - 1);
+            start = end + 1;
+
+            if (request == "QUIT") {
+                client.closing = true;
+            } else if (!request.empty()) {
+                client.output += m_handler(request);
+                client.output += '\n';
+            }
+        }
+        client.input.erase(0, start);
+
+        // A client that never sends a newline or never reads is cut off
+        if (client.input.size() > kMaxLine || client.output.size() > kMaxOutput) {
+            drop(fd);
+            return;
+        }
+        if (eof) client.closing = true;
+    }
+
+    if (!flush(fd, client)) drop(fd);
+}
+
+bool ControlServer::flush(int fd, Client& client) {
+    while (!client.output.empty()) {
+        ssize_t n = send(fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            client.output.erase(0, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Wait for room; once closing only the write side matters
+            watch(fd, client, client.closing ? EPOLLOUT : EPOLLIN | EPOLLOUT | EPOLLRDHUP);
+            return true;
+        }
+        return false;
+    }
+
+    if (client.closing) return false;
+    watch(fd, client, EPOLLIN | EPOLLRDHUP);
+    return true;
+}
+
+void ControlServer::watch(int fd, Client& client, uint32_t events) {
+    if (client.events == events) return;
+    client.events = events;
+    m_loop.modify(fd, events);
+}
+
+void ControlServer::drop(int fd) {
+    m_loop.remove(fd);
+    ::close(fd);
+    m_clients.erase(fd);
+}
@@ -0,0 +1,57 @@
+#ifndef OVERPI_CONTROL_SERVER_H
+#define OVERPI_CONTROL_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+#include "event_loop.h"
+
+// Line-based request/response server on a Unix stream socket. Every
+// request is one line of text; the handler's reply is sent back as one
+// line. "QUIT" closes the connection. Clients are non-blocking and served
+// from the event loop, so a slow reader never stalls the others.
+class ControlServer {
+public:
+    typedef std::function<std::string(const std::string& request)> RequestHandler;
+
+    static const size_t kMaxLine = 4096;
+    static const size_t kMaxOutput = 1 << 20;
+    static const size_t kMaxClients = 128;
+
+    ControlServer(EventLoop& loop, const RequestHandler& handler);
+    ~ControlServer();
+
+    // Replaces a stale socket at path
+    bool listen(const std::string& path, mode_t mode = 0660);
+    void close();
+
+    size_t clientCount() const { return m_clients.size(); }
+
+private:
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    struct Client {
+        std::string input;
+        std::string output;
+        bool closing;   // close once the output is sent
+        uint32_t events;  // current epoll interest
+    };
+
+    void onAccept();
+    void onClient(int fd, uint32_t events);
+    bool flush(int fd, Client& client);
+    void watch(int fd, Client& client, uint32_t events);
+    void drop(int fd);
+
+    EventLoop& m_loop;
+    RequestHandler m_handler;
+    int m_listenFd;
+    std::string m_path;
+    std::map<int, Client> m_clients;
+};
+
+#endif
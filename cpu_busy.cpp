@@ -0,0 +1,46 @@
+#include "cpu_busy.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+CpuBusyReader::CpuBusyReader(const std::string& procRoot)
+: m_fd(open((procRoot + "/stat").c_str(), O_RDONLY | O_CLOEXEC)),
+  m_lastBusy(0),
+  m_lastTotal(0) {
+}
+
+CpuBusyReader::~CpuBusyReader() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+bool CpuBusyReader::read(int& percent) {
+    if (m_fd < 0) return false;
+
+    // First line: cpu user nice system idle iowait irq softirq steal ...
+    char buf[256];
+    ssize_t n = pread(m_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    if (strncmp(buf, "cpu ", 4) != 0) return false;
+
+    uint64_t fields[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    char* p = buf + 4;
+    for (int i = 0; i < 8; i++) {
+        char* end;
+        fields[i] = strtoull(p, &end, 10);
+        if (end == p) break;
+        p = end;
+    }
+    uint64_t idle = fields[3] + fields[4];
+    uint64_t total = 0;
+    for (uint64_t v : fields) total += v;
+    uint64_t busy = total - idle;
+
+    bool ok = m_lastTotal != 0 && total > m_lastTotal;
+    if (ok) percent = static_cast<int>((busy - m_lastBusy) * 100 / (total - m_lastTotal));
+    m_lastBusy = busy;
+    m_lastTotal = total;
+    return ok;
+}
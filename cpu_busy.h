@@ -0,0 +1,31 @@
+#ifndef OVERPI_CPU_BUSY_H
+#define OVERPI_CPU_BUSY_H
+
+#include <cstdint>
+#include <string>
+
+// Share of CPU time spent busy between two reads of the aggregate "cpu"
+// line of /proc/stat, with one pread on a descriptor kept open.
+// Not thread-safe.
+class CpuBusyReader {
+public:
+    explicit CpuBusyReader(const std::string& procRoot = "/proc");
+    ~CpuBusyReader();
+
+    // Busy percent since the previous read; false on the first read, after
+    // reset() and when /proc/stat cannot be read
+    bool read(int& percent);
+
+    // The next read() starts a new delta
+    void reset() { m_lastTotal = 0; }
+
+private:
+    CpuBusyReader(const CpuBusyReader&) = delete;
+    CpuBusyReader& operator=(const CpuBusyReader&) = delete;
+
+    int m_fd;
+    uint64_t m_lastBusy;
+    uint64_t m_lastTotal;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "cpufreq_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sensor_sampler.h"
+
+CpufreqBackend::CpufreqBackend(const std::string& sysfsRoot)
+: m_root(sysfsRoot) {
+    std::string dir = m_root + "/devices/system/cpu/cpufreq";
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(d)) {
+        if (std::strncmp(entry->d_name, "policy", 6) == 0) names.push_back(entry->d_name);
+    }
+    closedir(d);
+
+    // policy2 before policy10
+    std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+        return std::atoi(a.c_str() + 6) < std::atoi(b.c_str() + 6);
+    });
+
+    for (const auto& name : names) {
+        std::string path = dir + "/" + name + "/";
+        CpufreqPolicy policy;
+        policy.name = name;
+        policy.governorFd = open((path + "scaling_governor").c_str(), O_RDWR | O_CLOEXEC);
+        policy.minFd = open((path + "scaling_min_freq").c_str(), O_RDWR | O_CLOEXEC);
+        policy.maxFd = open((path + "scaling_max_freq").c_str(), O_RDWR | O_CLOEXEC);
+        policy.cpuinfoMinKHz = 0;
+        policy.cpuinfoMaxKHz = 0;
+
+        int fd = open((path + "cpuinfo_min_freq").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            readLong(fd, policy.cpuinfoMinKHz);
+            close(fd);
+        }
+        fd = open((path + "cpuinfo_max_freq").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            readLong(fd, policy.cpuinfoMaxKHz);
+            close(fd);
+        }
+
+        fd = open((path + "scaling_available_frequencies").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            std::string list;
+            if (readNode(fd, list)) {
+                const char* p = list.c_str();
+                char* end = nullptr;
+                for (long kHz = strtol(p, &end, 10); end != p; kHz = strtol(p, &end, 10)) {
+                    policy.frequencies.push_back(kHz);
+                    p = end;
+                }
+                std::sort(policy.frequencies.begin(), policy.frequencies.end());
+            }
+            close(fd);
+        }
+
+        m_policies.push_back(policy);
+    }
+}
+
+CpufreqBackend::~CpufreqBackend() {
+    for (const auto& policy : m_policies) {
+        if (policy.governorFd >= 0) close(policy.governorFd);
+        if (policy.minFd >= 0) close(policy.minFd);
+        if (policy.maxFd >= 0) close(policy.maxFd);
+    }
+}
+
+const std::vector<long>& CpufreqBackend::frequencies() const {
+    static const std::vector<long> empty;
+    return m_policies.empty() ? empty : m_policies[0].frequencies;
+}
+
+bool CpufreqBackend::readNode(int fd, std::string& value) {
+    if (fd < 0) return false;
+
+    char buf[512];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) n--;
+    value.assign(buf, n);
+    return true;
+}
+
+bool CpufreqBackend::readLong(int fd, long& value) {
+    if (fd < 0) return false;
+
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    return n > 0 && parseSysfsInt(buf, static_cast<size_t>(n), value);
+}
+
+bool CpufreqBackend::writeNode(const CpufreqPolicy& policy, int fd, const char* attribute,
+                               const std::string& value, std::vector<CpufreqStep>* steps) {
+    int error = 0;
+    if (fd < 0) {
+        error = ENOENT;
+    } else {
+        std::string data = value + "\n";
+        ssize_t n = pwrite(fd, data.c_str(), data.size(), 0);
+        if (n < 0) error = errno;
+        else if (static_cast<size_t>(n) != data.size()) error = EIO;
+    }
+
+    if (steps) {
+        CpufreqStep step;
+        step.policy = policy.name;
+        step.attribute = attribute;
+        step.value = value;
+        step.error = error;
+        readNode(fd, step.readBack);
+        steps->push_back(step);
+    }
+    return error == 0;
+}
+
+bool CpufreqBackend::setGovernor(const std::string& governor, std::vector<CpufreqStep>* steps) {
+    bool ok = !m_policies.empty();
+    for (const auto& policy : m_policies) {
+        if (!writeNode(policy, policy.governorFd, "scaling_governor", governor, steps)) ok = false;
+    }
+    return ok;
+}
+
+bool CpufreqBackend::setLimits(long minKHz, long maxKHz, std::vector<CpufreqStep>* steps) {
+    if (minKHz > maxKHz) return false;
+
+    bool ok = !m_policies.empty();
+    std::string minValue = std::to_string(minKHz);
+    std::string maxValue = std::to_string(maxKHz);
+
+    for (const auto& policy : m_policies) {
+        long curMax = 0;
+        bool raising = readLong(policy.maxFd, curMax) && minKHz > curMax;
+
+        if (raising) {
+            if (!writeNode(policy, policy.maxFd, "scaling_max_freq", maxValue, steps)) ok = false;
+            if (!writeNode(policy, policy.minFd, "scaling_min_freq", minValue, steps)) ok = false;
+        } else {
+            if (!writeNode(policy, policy.minFd, "scaling_min_freq", minValue, steps)) ok = false;
+            if (!writeNode(policy, policy.maxFd, "scaling_max_freq", maxValue, steps)) ok = false;
+        }
+    }
+    return ok;
+}
+
+bool CpufreqBackend::setMax(long maxKHz, std::vector<CpufreqStep>* steps) {
+    bool ok = !m_policies.empty();
+    std::string value = std::to_string(maxKHz);
+    for (const auto& policy : m_policies) {
+        if (!writeNode(policy, policy.maxFd, "scaling_max_freq", value, steps)) ok = false;
+    }
+    return ok;
+}
+
+bool CpufreqBackend::setMin(long minKHz, std::vector<CpufreqStep>* steps) {
+    bool ok = !m_policies.empty();
+    std::string value = std::to_string(minKHz);
+    for (const auto& policy : m_policies) {
+        if (!writeNode(policy, policy.minFd, "scaling_min_freq", value, steps)) ok = false;
+    }
+    return ok;
+}
+
+bool CpufreqBackend::readLimits(size_t policy, long& minKHz, long& maxKHz) const {
+    if (policy >= m_policies.size()) return false;
+    return readLong(m_policies[policy].minFd, minKHz) && readLong(m_policies[policy].maxFd, maxKHz);
+}
+
+bool CpufreqBackend::readGovernor(size_t policy, std::string& governor) const {
+    if (policy >= m_policies.size()) return false;
+    return readNode(m_policies[policy].governorFd, governor);
+}
+
+std::string CpufreqBackend::describeErrors(const std::vector<CpufreqStep>& steps) {
+    std::string result;
+    for (const auto& step : steps) {
+        if (step.error == 0) continue;
+        result += step.policy + "/" + step.attribute + "=" + step.value + ": " + std::strerror(step.error) + "\n";
+    }
+    return result;
+}
@@ -0,0 +1,71 @@
+#ifndef OVERPI_CPUFREQ_BACKEND_H
+#define OVERPI_CPUFREQ_BACKEND_H
+
+#include <string>
+#include <vector>
+
+// Result of one sysfs write
+struct CpufreqStep {
+    std::string policy;     // e.g. "policy0"
+    std::string attribute;  // e.g. "scaling_max_freq"
+    std::string value;      // value written
+    std::string readBack;   // value the kernel reports afterwards
+    int error;              // errno, 0 on success
+};
+
+// One cpufreq policy (a group of cores sharing a clock)
+struct CpufreqPolicy {
+    std::string name;
+    int governorFd;
+    int minFd;
+    int maxFd;
+    long cpuinfoMinKHz;
+    long cpuinfoMaxKHz;
+    std::vector<long> frequencies;   // scaling_available_frequencies, sorted
+};
+
+// Direct cpufreq control through sysfs for every policy under
+// <root>/devices/system/cpu/cpufreq. Descriptors stay open, so each
+// change is a handful of pwrite() calls instead of a cpufreq-set fork.
+class CpufreqBackend {
+public:
+    explicit CpufreqBackend(const std::string& sysfsRoot = "/sys");
+    ~CpufreqBackend();
+
+    size_t policyCount() const { return m_policies.size(); }
+    const CpufreqPolicy& policy(size_t i) const { return m_policies[i]; }
+
+    // Operating points of the first policy (empty if not exported)
+    const std::vector<long>& frequencies() const;
+
+    bool setGovernor(const std::string& governor, std::vector<CpufreqStep>* steps = nullptr);
+
+    // Set both limits on every policy. Writes are ordered so that
+    // min <= max holds throughout: max is raised before min, min is
+    // lowered before max.
+    bool setLimits(long minKHz, long maxKHz, std::vector<CpufreqStep>* steps = nullptr);
+
+    // Single-limit writes for callers that keep the other limit valid
+    bool setMax(long maxKHz, std::vector<CpufreqStep>* steps = nullptr);
+    bool setMin(long minKHz, std::vector<CpufreqStep>* steps = nullptr);
+
+    bool readLimits(size_t policy, long& minKHz, long& maxKHz) const;
+    bool readGovernor(size_t policy, std::string& governor) const;
+
+    // "policy0/scaling_max_freq=1800000: Invalid argument" for each failed step
+    static std::string describeErrors(const std::vector<CpufreqStep>& steps);
+
+private:
+    CpufreqBackend(const CpufreqBackend&) = delete;
+    CpufreqBackend& operator=(const CpufreqBackend&) = delete;
+
+    bool writeNode(const CpufreqPolicy& policy, int fd, const char* attribute,
+                   const std::string& value, std::vector<CpufreqStep>* steps);
+    static bool readNode(int fd, std::string& value);
+    static bool readLong(int fd, long& value);
+
+    std::string m_root;
+    std::vector<CpufreqPolicy> m_policies;
+};
+
+#endif
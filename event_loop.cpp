@@ -0,0 +1,85 @@
+#include "event_loop.h"
+
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+EventLoop::EventLoop()
+: m_epollFd(epoll_create1(EPOLL_CLOEXEC)),
+  m_wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+  m_running(false) {
+    if (m_epollFd >= 0 && m_wakeFd >= 0) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = m_wakeFd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+    }
+}
+
+EventLoop::~EventLoop() {
+    if (m_wakeFd >= 0) close(m_wakeFd);
+    if (m_epollFd >= 0) close(m_epollFd);
+}
+
+bool EventLoop::add(int fd, uint32_t events, const Handler& handler) {
+    if (!isValid() || fd < 0) return false;
+
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) return false;
+
+    m_handlers[fd] = std::make_shared<Handler>(handler);
+    return true;
+}
+
+bool EventLoop::modify(int fd, uint32_t events) {
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::remove(int fd) {
+    if (m_handlers.erase(fd) == 0) return;
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void EventLoop::run() {
+    if (!isValid()) return;
+
+    m_running = true;
+    struct epoll_event events[32];
+    while (m_running) {
+        int n = epoll_wait(m_epollFd, events, 32, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < n && m_running; i++) {
+            int fd = events[i].data.fd;
+            if (fd == m_wakeFd) {
+                uint64_t count;
+                while (read(m_wakeFd, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+
+            // An earlier handler in this batch may have removed the descriptor;
+            // holding a reference keeps the handler alive if it removes itself
+            auto it = m_handlers.find(fd);
+            if (it == m_handlers.end()) continue;
+            std::shared_ptr<Handler> handler = it->second;
+            (*handler)(events[i].events);
+        }
+    }
+}
+
+void EventLoop::stop() {
+    m_running = false;
+    uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+        // Counter overflow only; the loop is already awake
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef OVERPI_EVENT_LOOP_H
+#define OVERPI_EVENT_LOOP_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+// Single-threaded epoll dispatcher. Handlers run on the thread that calls
+// run() and may add or remove descriptors, including their own.
+class EventLoop {
+public:
+    typedef std::function<void(uint32_t events)> Handler;
+
+    EventLoop();
+    ~EventLoop();
+
+    bool isValid() const { return m_epollFd >= 0 && m_wakeFd >= 0; }
+
+    // events are EPOLLIN/EPOLLOUT/...; the loop does not own the descriptor
+    bool add(int fd, uint32_t events, const Handler& handler);
+    bool modify(int fd, uint32_t events);
+    void remove(int fd);
+
+    // Dispatch until stop() is called
+    void run();
+
+    // Safe to call from any thread or from a handler
+    void stop();
+
+private:
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    int m_epollFd;
+    int m_wakeFd;
+    std::atomic<bool> m_running;
+    std::map<int, std::shared_ptr<Handler>> m_handlers;
+};
+
+#endif
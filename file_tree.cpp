@@ -0,0 +1,40 @@
+#include "file_tree.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// nftw passes no user data; the failing path is copied out here
+std::string g_failedPath;
+
+int removeEntry(const char* path, const struct stat*, int type, struct FTW*) {
+    if (unlinkat(AT_FDCWD, path, type == FTW_DP ? AT_REMOVEDIR : 0) == 0) return 0;
+    g_failedPath = path;
+    return -1;
+}
+}
+
+bool makeDirs(const std::string& path) {
+    for (size_t pos = 1; pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    mkdir(path.c_str(), 0755);
+
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool removeTree(const std::string& root, std::string* error) {
+    struct stat st;
+    if (lstat(root.c_str(), &st) != 0 && errno == ENOENT) return true;
+
+    // Children before their directory, symlinks removed rather than followed
+    g_failedPath = root;
+    if (nftw(root.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS) == 0) return true;
+    if (error) *error = g_failedPath + ": " + std::strerror(errno);
+    return false;
+}
@@ -0,0 +1,16 @@
+#ifndef OVERPI_FILE_TREE_H
+#define OVERPI_FILE_TREE_H
+
+#include <string>
+
+// Scratch directory trees for the simulated boards and the benchmarks
+
+// mkdir -p; true when path is a directory afterwards
+bool makeDirs(const std::string& path);
+
+// rm -rf without a shell: a depth-first walk that does not follow symlinks.
+// A missing root counts as removed. On failure error names the entry that
+// could not be removed.
+bool removeTree(const std::string& root, std::string* error = nullptr);
+
+#endif
@@ -0,0 +1,298 @@
+#include "fleet_aggregator.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "residency_tracker.h"
+#include "snapshot_collector.h"
+#include "throttle_tracker.h"
+
+const int64_t FleetAggregator::kRetryMinNs;
+const int64_t FleetAggregator::kRetryMaxNs;
+const int64_t FleetAggregator::kSilentNs;
+
+namespace {
+// Reconnect and silence checks; short against the retry backoff
+const long kTickMs = 250;
+}
+
+FleetAggregator::FleetAggregator(EventLoop& loop)
+: m_loop(loop),
+  m_timerFd(-1),
+  m_buffer(64 * 1024) {
+}
+
+FleetAggregator::~FleetAggregator() {
+    stop();
+}
+
+bool FleetAggregator::addAgent(const std::string& address) {
+    std::string host = address;
+    std::string port = std::to_string(kDefaultFleetPort);
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) return false;
+
+    Agent agent;
+    agent.addr = *reinterpret_cast<struct sockaddr_in*>(result->ai_addr);
+    agent.fd = -1;
+    agent.connecting = false;
+    agent.retryAtNs = 0;
+    agent.backoffNs = kRetryMinNs;
+    freeaddrinfo(result);
+
+    FleetBoard board;
+    board.address = host + ":" + port;
+    m_agents.push_back(agent);
+    m_boards.push_back(board);
+    return true;
+}
+
+bool FleetAggregator::start() {
+    stop();
+
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timerFd < 0) return false;
+    struct itimerspec spec = {};
+    spec.it_interval.tv_nsec = kTickMs * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(m_timerFd, 0, &spec, nullptr) != 0 ||
+        !m_loop.add(m_timerFd, EPOLLIN, [this](uint32_t) { onTimer(); })) {
+        ::close(m_timerFd);
+        m_timerFd = -1;
+        return false;
+    }
+
+    int64_t now = monotonicNowNs();
+    for (size_t i = 0; i < m_agents.size(); i++) connectAgent(i, now);
+    return true;
+}
+
+void FleetAggregator::stop() {
+    for (size_t i = 0; i < m_agents.size(); i++) {
+        if (m_agents[i].fd >= 0) disconnect(i, 0);
+    }
+    if (m_timerFd >= 0) {
+        m_loop.remove(m_timerFd);
+        ::close(m_timerFd);
+        m_timerFd = -1;
+    }
+}
+
+void FleetAggregator::connectAgent(size_t index, int64_t nowNs) {
+    Agent& agent = m_agents[index];
+    agent.decoder.reset();
+    agent.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (agent.fd < 0) {
+        // Out of descriptors; try again later
+        agent.retryAtNs = nowNs + agent.backoffNs;
+        return;
+    }
+
+    int rc = connect(agent.fd, reinterpret_cast<struct sockaddr*>(&agent.addr), sizeof(agent.addr));
+    agent.connecting = rc != 0;
+    if ((rc != 0 && errno != EINPROGRESS) ||
+        !m_loop.add(agent.fd, agent.connecting ? EPOLLOUT : EPOLLIN | EPOLLRDHUP,
+                    [this, index](uint32_t events) { onAgent(index, events); })) {
+        disconnect(index, nowNs);
+        return;
+    }
+    if (!agent.connecting) {
+        m_boards[index].connected = true;
+        m_boards[index].connects++;
+        m_boards[index].lastSeenNs = nowNs;
+    }
+}
+
+void FleetAggregator::onAgent(size_t index, uint32_t events) {
+    Agent& agent = m_agents[index];
+    FleetBoard& board = m_boards[index];
+    int64_t now = monotonicNowNs();
+
+    if (agent.connecting) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(agent.fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0 ||
+            (events & (EPOLLERR | EPOLLHUP))) {
+            disconnect(index, now);
+            return;
+        }
+        agent.connecting = false;
+        m_loop.modify(agent.fd, EPOLLIN | EPOLLRDHUP);
+        board.connected = true;
+        board.connects++;
+        board.lastSeenNs = now;
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) receive(index);
+}
+
+void FleetAggregator::receive(size_t index) {
+    Agent& agent = m_agents[index];
+    FleetBoard& board = m_boards[index];
+    int64_t now = monotonicNowNs();
+
+    bool closed = false;
+    for (;;) {
+        ssize_t n = recv(agent.fd, m_buffer.data(), m_buffer.size(), 0);
+        if (n > 0) {
+            agent.decoder.feed(m_buffer.data(), static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    while (agent.decoder.next(m_frame)) {
+        board.lastSeenNs = now;
+        if (m_frame.type == FLEET_INFO) {
+            board.hostname = m_frame.hostname;
+            board.profile = m_frame.profile;
+        } else if (m_frame.type == FLEET_SAMPLES && !m_frame.samples.empty()) {
+            board.last = m_frame.samples.back();
+            board.haveSample = true;
+            board.samples += m_frame.samples.size();
+        }
+    }
+
+    if (closed || agent.decoder.error()) {
+        disconnect(index, now);
+    } else {
+        // A healthy stream resets the backoff
+        agent.backoffNs = kRetryMinNs;
+    }
+}
+
+void FleetAggregator::disconnect(size_t index, int64_t nowNs) {
+    Agent& agent = m_agents[index];
+    if (agent.fd >= 0) {
+        m_loop.remove(agent.fd);
+        ::close(agent.fd);
+        agent.fd = -1;
+    }
+    agent.connecting = false;
+    m_boards[index].connected = false;
+
+    // Spread the retries of agents that dropped together
+    int64_t jitter = static_cast<int64_t>(rand() % 1000) * (agent.backoffNs / 4000);
+    agent.retryAtNs = nowNs + agent.backoffNs + jitter;
+    agent.backoffNs = std::min(agent.backoffNs * 2, kRetryMaxNs);
+}
+
+void FleetAggregator::onTimer() {
+    uint64_t expirations;
+    while (read(m_timerFd, &expirations, sizeof(expirations)) > 0) {}
+
+    int64_t now = monotonicNowNs();
+    for (size_t i = 0; i < m_agents.size(); i++) {
+        Agent& agent = m_agents[i];
+        if (agent.fd < 0) {
+            if (now >= agent.retryAtNs) connectAgent(i, now);
+        } else if (now - m_boards[i].lastSeenNs > kSilentNs) {
+            // Half-open connection or a stuck agent
+            disconnect(i, now);
+        }
+    }
+}
+
+size_t FleetAggregator::connectedCount() const {
+    size_t count = 0;
+    for (const auto& board : m_boards) {
+        if (board.connected) count++;
+    }
+    return count;
+}
+
+std::vector<size_t> FleetAggregator::hottest(size_t count) const {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < m_boards.size(); i++) {
+        if (m_boards[i].haveSample && m_boards[i].last.tempMilliC != INT32_MIN) order.push_back(i);
+    }
+    auto hotter = [this](size_t a, size_t b) { return m_boards[a].last.tempMilliC > m_boards[b].last.tempMilliC; };
+    count = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), hotter);
+    order.resize(count);
+    return order;
+}
+
+std::vector<size_t> FleetAggregator::throttled() const {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < m_boards.size(); i++) {
+        if (m_boards[i].throttledNow()) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_boards[a].last.tempMilliC > m_boards[b].last.tempMilliC;
+    });
+    return order;
+}
+
+std::map<std::string, size_t> FleetAggregator::profileCounts() const {
+    std::map<std::string, size_t> counts;
+    for (const auto& board : m_boards) {
+        if (board.connected) counts[board.profile.empty() ? "none" : board.profile]++;
+    }
+    return counts;
+}
+
+std::string FleetAggregator::format(size_t top) const {
+    std::vector<size_t> hot = hottest(top);
+    std::vector<size_t> throttling = throttled();
+    char line[256];
+    std::string text;
+
+    snprintf(line, sizeof(line), "boards %zu/%zu connected, %zu throttled\n",
+             connectedCount(), m_boards.size(), throttling.size());
+    text += line;
+
+    text += "profiles:";
+    for (const auto& entry : profileCounts()) {
+        snprintf(line, sizeof(line), " %s=%zu", entry.first.c_str(), entry.second);
+        text += line;
+    }
+    text += "\n";
+
+    auto row = [&](size_t index) {
+        const FleetBoard& board = m_boards[index];
+        const FleetSample& s = board.last;
+        std::string flags;
+        for (int flag = 0; flag < THROTTLE_FLAG_COUNT; flag++) {
+            if (!(s.throttled & (1u << flag))) continue;
+            if (!flags.empty()) flags += ",";
+            flags += ThrottleTracker::flagName(flag);
+        }
+        snprintf(line, sizeof(line), "  %-21s %-16.16s %-9.9s %6.1f °C %5u MHz %s%s\n",
+                 board.address.c_str(), board.hostname.c_str(), board.profile.c_str(),
+                 s.tempMilliC / 1000.0, s.cpuKHz / 1000, flags.empty() ? "-" : flags.c_str(),
+                 board.connected ? "" : " (offline)");
+        text += line;
+    };
+
+    text += "hottest:\n";
+    for (size_t index : hot) row(index);
+
+    text += "throttled:\n";
+    for (size_t i = 0; i < throttling.size() && i < top; i++) row(throttling[i]);
+    if (throttling.size() > top) {
+        snprintf(line, sizeof(line), "  ... %zu more\n", throttling.size() - top);
+        text += line;
+    }
+    return text;
+}
@@ -0,0 +1,90 @@
+#ifndef OVERPI_FLEET_AGGREGATOR_H
+#define OVERPI_FLEET_AGGREGATOR_H
+
+#include <cstdint>
+#include <map>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "fleet_protocol.h"
+
+// Last known state of one agent
+struct FleetBoard {
+    std::string address;       // host:port as configured
+    std::string hostname;      // reported by the agent
+    std::string profile;
+    bool connected;
+    bool haveSample;
+    FleetSample last;
+    int64_t lastSeenNs;        // aggregator clock of the last frame
+    uint64_t samples;
+    uint64_t connects;
+
+    FleetBoard() : connected(false), haveSample(false), lastSeenNs(0), samples(0), connects(0) {}
+
+    // An offline board's last sample is stale, so it never counts
+    bool throttledNow() const { return connected && haveSample && (last.throttled & 0xf) != 0; }
+};
+
+// Collects the fleet protocol from many agents over TCP on one event loop
+// thread. Each agent is a non-blocking client socket registered with the
+// loop; a periodic timer reconnects lost agents with exponential backoff
+// and drops connections that went silent. The merged view is kept as one
+// FleetBoard per agent and summarised on demand.
+class FleetAggregator {
+public:
+    static const int64_t kRetryMinNs = 1000000000LL;
+    static const int64_t kRetryMaxNs = 60000000000LL;
+    static const int64_t kSilentNs = 60000000000LL;   // reconnect an agent this quiet
+
+    explicit FleetAggregator(EventLoop& loop);
+    ~FleetAggregator();
+
+    // "host" or "host:port"; false if the host does not resolve to IPv4
+    bool addAgent(const std::string& address);
+
+    // Connect to every agent and keep reconnecting until stop()
+    bool start();
+    void stop();
+
+    const std::vector<FleetBoard>& boards() const { return m_boards; }
+    size_t connectedCount() const;
+
+    // Indices into boards()
+    std::vector<size_t> hottest(size_t count) const;
+    std::vector<size_t> throttled() const;      // hottest first
+    std::map<std::string, size_t> profileCounts() const;
+
+    // Text overview: totals, profile distribution, hottest and throttled boards
+    std::string format(size_t top) const;
+
+private:
+    FleetAggregator(const FleetAggregator&) = delete;
+    FleetAggregator& operator=(const FleetAggregator&) = delete;
+
+    struct Agent {
+        struct sockaddr_in addr;
+        int fd;
+        bool connecting;
+        int64_t retryAtNs;
+        int64_t backoffNs;
+        FleetDecoder decoder;
+    };
+
+    void connectAgent(size_t index, int64_t nowNs);
+    void onAgent(size_t index, uint32_t events);
+    void receive(size_t index);
+    void disconnect(size_t index, int64_t nowNs);
+    void onTimer();
+
+    EventLoop& m_loop;
+    int m_timerFd;
+    std::vector<FleetBoard> m_boards;
+    std::vector<Agent> m_agents;      // same order as m_boards
+    std::vector<char> m_buffer;
+    FleetFrame m_frame;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "fleet_protocol.h"
+
+#include <algorithm>
+
+namespace {
+void putU32(std::string& out, uint32_t value) {
+    char bytes[4] = {
+        static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff),
+        static_cast<char>((value >> 16) & 0xff), static_cast<char>((value >> 24) & 0xff)
+    };
+    out.append(bytes, 4);
+}
+
+uint32_t getU32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8 |
+           static_cast<uint32_t>(b[2]) << 16 | static_cast<uint32_t>(b[3]) << 24;
+}
+
+void putHeader(std::string& out, uint8_t type, uint16_t count, uint32_t payloadBytes) {
+    putU32(out, kFleetMagic);
+    out.push_back(static_cast<char>(kFleetVersion));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(count & 0xff));
+    out.push_back(static_cast<char>(count >> 8));
+    putU32(out, payloadBytes);
+}
+
+uint32_t clampU32(long value) {
+    return value <= 0 ? 0 : static_cast<uint32_t>(std::min<unsigned long>(value, UINT32_MAX));
+}
+}
+
+FleetSample FleetSample::fromSnapshot(const SystemSnapshot& snapshot) {
+    FleetSample sample;
+    sample.sequence = static_cast<uint32_t>(snapshot.sequence);
+    sample.monotonicMs = static_cast<uint32_t>(snapshot.monotonicNs / 1000000);
+    if (snapshot.temperatureValid) sample.tempMilliC = static_cast<int32_t>(snapshot.temperatureMilliC);
+
+    long fastest = 0;
+    for (int cpu = 0; cpu < snapshot.cpuCount && cpu < kSnapshotMaxCpus; cpu++) {
+        if (snapshot.cpuFreqValid[cpu]) fastest = std::max(fastest, snapshot.cpuFreqKHz[cpu]);
+    }
+    sample.cpuKHz = clampU32(fastest);
+
+    if (snapshot.firmwareValid) {
+        const VcReading& fw = snapshot.firmware;
+        if (fw.clockValid[VC_DOMAIN_V3D]) sample.gpuKHz = fw.clockHz[VC_DOMAIN_V3D] / 1000;
+        if (fw.voltsValid[VC_RAIL_CORE]) sample.coreMicroVolts = fw.microVolts[VC_RAIL_CORE];
+        if (fw.throttledValid) sample.throttled = fw.throttled;
+    }
+    if (snapshot.governorEngaged) sample.ceilingKHz = clampU32(snapshot.governorCeilingKHz);
+    return sample;
+}
+
+void encodeFleetInfo(const std::string& hostname, const std::string& profile, std::string& out) {
+    // Neither field may contain the separator
+    std::string host = hostname.substr(0, std::min(hostname.find('\n'), static_cast<size_t>(255)));
+    std::string id = profile.substr(0, std::min(profile.find('\n'), static_cast<size_t>(255)));
+    putHeader(out, FLEET_INFO, 0, static_cast<uint32_t>(host.size() + 1 + id.size()));
+    out += host;
+    out.push_back('\n');
+    out += id;
+}
+
+void encodeFleetSamples(const FleetSample* samples, size_t count, std::string& out) {
+    count = std::min(count, kFleetMaxPayload / kFleetSampleBytes);
+    putHeader(out, FLEET_SAMPLES, static_cast<uint16_t>(count), static_cast<uint32_t>(count * kFleetSampleBytes));
+    for (size_t i = 0; i < count; i++) {
+        const FleetSample& s = samples[i];
+        putU32(out, s.sequence);
+        putU32(out, s.monotonicMs);
+        putU32(out, static_cast<uint32_t>(s.tempMilliC));
+        putU32(out, s.cpuKHz);
+        putU32(out, s.gpuKHz);
+        putU32(out, s.coreMicroVolts);
+        putU32(out, s.throttled);
+        putU32(out, s.ceilingKHz);
+    }
+}
+
+bool FleetDecoder::next(FleetFrame& frame) {
+    if (m_error) return false;
+
+    // Drop the decoded frames once the caller has drained them
+    size_t available = m_buffer.size() - m_offset;
+    if (available < kFleetHeaderBytes) {
+        compact();
+        return false;
+    }
+
+    const char* header = m_buffer.data() + m_offset;
+    uint8_t version = static_cast<uint8_t>(header[4]);
+    uint8_t type = static_cast<uint8_t>(header[5]);
+    size_t count = static_cast<uint8_t>(header[6]) | static_cast<size_t>(static_cast<uint8_t>(header[7])) << 8;
+    size_t payload = getU32(header + 8);
+    if (getU32(header) != kFleetMagic || version != kFleetVersion || payload > kFleetMaxPayload ||
+        (type == FLEET_SAMPLES && payload != count * kFleetSampleBytes)) {
+        m_error = true;
+        return false;
+    }
+    if (available < kFleetHeaderBytes + payload) {
+        compact();
+        return false;
+    }
+
+    const char* p = header + kFleetHeaderBytes;
+    m_offset += kFleetHeaderBytes + payload;
+    frame.type = type;
+    frame.samples.clear();
+
+    if (type == FLEET_INFO) {
+        std::string text(p, payload);
+        size_t newline = text.find('\n');
+        frame.hostname = text.substr(0, newline);
+        frame.profile = newline == std::string::npos ? "" : text.substr(newline + 1);
+    } else if (type == FLEET_SAMPLES) {
+        frame.samples.resize(count);
+        for (size_t i = 0; i < count; i++, p += kFleetSampleBytes) {
+            FleetSample& s = frame.samples[i];
+            s.sequence = getU32(p);
+            s.monotonicMs = getU32(p + 4);
+            s.tempMilliC = static_cast<int32_t>(getU32(p + 8));
+            s.cpuKHz = getU32(p + 12);
+            s.gpuKHz = getU32(p + 16);
+            s.coreMicroVolts = getU32(p + 20);
+            s.throttled = getU32(p + 24);
+            s.ceilingKHz = getU32(p + 28);
+        }
+    }
+    // Unknown types are skipped, so a newer agent can add frames
+    return true;
+}
+
+void FleetDecoder::compact() {
+    m_buffer.erase(0, m_offset);
+    m_offset = 0;
+}
+
+void FleetDecoder::reset() {
+    m_buffer.clear();
+    m_offset = 0;
+    m_error = false;
+}
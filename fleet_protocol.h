@@ -0,0 +1,81 @@
+#ifndef OVERPI_FLEET_PROTOCOL_H
+#define OVERPI_FLEET_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "system_snapshot.h"
+
+const int kDefaultFleetPort = 9466;
+
+// Binary stream an agent sends to the fleet aggregator. Every frame is a
+// 12-byte header followed by its payload, all little-endian:
+//   u32 magic "OPFT", u8 version, u8 type, u16 count, u32 payload bytes
+// FLEET_INFO carries "hostname\nprofile id" and is sent on connect and
+// whenever the profile changes. FLEET_SAMPLES carries count samples of
+// kFleetSampleBytes each, batched by the agent.
+const uint32_t kFleetMagic = 0x5446504f;
+const uint8_t kFleetVersion = 1;
+const size_t kFleetHeaderBytes = 12;
+const size_t kFleetSampleBytes = 32;
+const size_t kFleetMaxPayload = 64 * 1024;
+
+enum FleetFrameType {
+    FLEET_INFO = 1,
+    FLEET_SAMPLES = 2
+};
+
+// One snapshot, reduced to what a fleet overview needs
+struct FleetSample {
+    uint32_t sequence;
+    uint32_t monotonicMs;     // agent clock, wraps after 49 days
+    int32_t tempMilliC;       // INT32_MIN if unavailable
+    uint32_t cpuKHz;          // fastest core
+    uint32_t gpuKHz;
+    uint32_t coreMicroVolts;
+    uint32_t throttled;       // get_throttled bits, 0 if unavailable
+    uint32_t ceilingKHz;      // thermal governor ceiling, 0 when not engaged
+
+    FleetSample()
+    : sequence(0), monotonicMs(0), tempMilliC(INT32_MIN), cpuKHz(0), gpuKHz(0),
+      coreMicroVolts(0), throttled(0), ceilingKHz(0) {}
+
+    static FleetSample fromSnapshot(const SystemSnapshot& snapshot);
+};
+
+struct FleetFrame {
+    int type;
+    std::string hostname;               // FLEET_INFO
+    std::string profile;                // FLEET_INFO
+    std::vector<FleetSample> samples;   // FLEET_SAMPLES
+};
+
+// Append a complete frame to out
+void encodeFleetInfo(const std::string& hostname, const std::string& profile, std::string& out);
+void encodeFleetSamples(const FleetSample* samples, size_t count, std::string& out);
+
+// Incremental decoder for one connection's byte stream
+class FleetDecoder {
+public:
+    FleetDecoder() : m_offset(0), m_error(false) {}
+
+    void feed(const char* data, size_t len) { m_buffer.append(data, len); }
+
+    // True and a frame when one is complete. A bad magic, version or size
+    // puts the decoder into the error state; the connection must be dropped.
+    bool next(FleetFrame& frame);
+
+    bool error() const { return m_error; }
+    void reset();
+
+private:
+    void compact();
+
+    std::string m_buffer;
+    size_t m_offset;   // start of the first undecoded frame
+    bool m_error;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "fleet_publisher.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const size_t FleetPublisher::kBatchSamples;
+const int64_t FleetPublisher::kFlushNs;
+const size_t FleetPublisher::kMaxSubscribers;
+const size_t FleetPublisher::kMaxBacklog;
+
+FleetPublisher::FleetPublisher(EventLoop& loop)
+: m_loop(loop),
+  m_listenFd(-1),
+  m_batchStartNs(0),
+  m_haveLast(false) {
+    m_batch.reserve(kBatchSamples);
+}
+
+FleetPublisher::~FleetPublisher() {
+    close();
+}
+
+bool FleetPublisher::listen(int port, const std::string& address) {
+    close();
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) return false;
+
+    m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) return false;
+
+    int one = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(m_listenFd, 16) != 0 ||
+        !m_loop.add(m_listenFd, EPOLLIN, [this](uint32_t) { onAccept(); })) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void FleetPublisher::close() {
+    while (!m_subscribers.empty()) drop(m_subscribers.begin()->first);
+
+    if (m_listenFd >= 0) {
+        m_loop.remove(m_listenFd);
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+}
+
+void FleetPublisher::setInfo(const std::string& hostname, const std::string& profileId) {
+    m_hostname = hostname;
+    setProfile(profileId);
+}
+
+void FleetPublisher::setProfile(const std::string& profileId) {
+    if (profileId == m_profile) return;
+    m_profile = profileId;
+
+    // Samples taken under the old profile go out first
+    flush();
+    m_frame.clear();
+    encodeFleetInfo(m_hostname, m_profile, m_frame);
+    broadcast(m_frame);
+}
+
+void FleetPublisher::publish(const SystemSnapshot& snapshot) {
+    FleetSample sample = FleetSample::fromSnapshot(snapshot);
+    bool throttleChanged = m_haveLast && (sample.throttled & 0xf) != (m_last.throttled & 0xf);
+    m_last = sample;
+    m_haveLast = true;
+
+    if (m_batch.empty()) m_batchStartNs = snapshot.monotonicNs;
+    m_batch.push_back(sample);
+    if (throttleChanged || m_batch.size() >= kBatchSamples || snapshot.monotonicNs - m_batchStartNs >= kFlushNs) {
+        flush();
+    }
+}
+
+void FleetPublisher::flush() {
+    if (m_batch.empty()) return;
+    if (!m_subscribers.empty()) {
+        m_frame.clear();
+        encodeFleetSamples(m_batch.data(), m_batch.size(), m_frame);
+        broadcast(m_frame);
+    }
+    m_batch.clear();
+}
+
+void FleetPublisher::broadcast(const std::string& frame) {
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end();) {
+        int fd = it->first;
+        Subscriber& subscriber = it->second;
+        ++it;
+
+        subscriber.output += frame;
+        if (subscriber.output.size() > kMaxBacklog || !send(fd, subscriber)) drop(fd);
+    }
+}
+
+void FleetPublisher::onAccept() {
+    for (;;) {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        if (m_subscribers.size() >= kMaxSubscribers ||
+            !m_loop.add(fd, EPOLLIN | EPOLLRDHUP, [this, fd](uint32_t events) { onSubscriber(fd, events); })) {
+            ::close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        // Identify the board and hand over the latest state right away
+        Subscriber& subscriber = m_subscribers[fd];
+        subscriber.events = EPOLLIN | EPOLLRDHUP;
+        encodeFleetInfo(m_hostname, m_profile, subscriber.output);
+        if (m_haveLast) encodeFleetSamples(&m_last, 1, subscriber.output);
+        if (!send(fd, subscriber)) drop(fd);
+    }
+}
+
+void FleetPublisher::onSubscriber(int fd, uint32_t events) {
+    auto it = m_subscribers.find(fd);
+    if (it == m_subscribers.end()) return;
+
+    if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        drop(fd);
+        return;
+    }
+    if (events & EPOLLIN) {
+        // Aggregators only listen; anything sent is discarded
+        char buf[256];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {}
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop(fd);
+            return;
+        }
+    }
+    if (!send(fd, it->second)) drop(fd);
+}
+
+bool FleetPublisher::send(int fd, Subscriber& subscriber) {
+    while (!subscriber.output.empty()) {
+        ssize_t n = ::send(fd, subscriber.output.data(), subscriber.output.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            subscriber.output.erase(0, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+
+    uint32_t events = EPOLLIN | EPOLLRDHUP | (subscriber.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    if (events != subscriber.events) {
+        subscriber.events = events;
+        m_loop.modify(fd, events);
+    }
+    return true;
+}
+
+void FleetPublisher::drop(int fd) {
+    m_loop.remove(fd);
+    ::close(fd);
+    m_subscribers.erase(fd);
+}
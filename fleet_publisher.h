@@ -0,0 +1,66 @@
+#ifndef OVERPI_FLEET_PUBLISHER_H
+#define OVERPI_FLEET_PUBLISHER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "fleet_protocol.h"
+#include "system_snapshot.h"
+
+// Agent side of the fleet protocol: streams batched samples to every
+// aggregator connected to the fleet port. Samples are held back until the
+// batch is full or old enough; a throttle change flushes immediately so the
+// fleet view never lags a board that just started throttling. Runs on the
+// event loop thread only.
+class FleetPublisher {
+public:
+    static const size_t kBatchSamples = 16;
+    static const int64_t kFlushNs = 5000000000LL;
+    static const size_t kMaxSubscribers = 16;
+    static const size_t kMaxBacklog = 256 * 1024;   // a slower reader is dropped
+
+    explicit FleetPublisher(EventLoop& loop);
+    ~FleetPublisher();
+
+    // Every interface by default: the aggregator runs on another machine
+    bool listen(int port = kDefaultFleetPort, const std::string& address = "0.0.0.0");
+    void close();
+
+    void setInfo(const std::string& hostname, const std::string& profileId);
+    void setProfile(const std::string& profileId);
+    void publish(const SystemSnapshot& snapshot);
+
+    size_t subscriberCount() const { return m_subscribers.size(); }
+
+private:
+    FleetPublisher(const FleetPublisher&) = delete;
+    FleetPublisher& operator=(const FleetPublisher&) = delete;
+
+    struct Subscriber {
+        std::string output;
+        uint32_t events;
+    };
+
+    void onAccept();
+    void onSubscriber(int fd, uint32_t events);
+    void flush();
+    void broadcast(const std::string& frame);
+    bool send(int fd, Subscriber& subscriber);
+    void drop(int fd);
+
+    EventLoop& m_loop;
+    int m_listenFd;
+    std::string m_hostname;
+    std::string m_profile;
+    std::vector<FleetSample> m_batch;
+    int64_t m_batchStartNs;
+    FleetSample m_last;
+    bool m_haveLast;
+    std::string m_frame;
+    std::map<int, Subscriber> m_subscribers;
+};
+
+#endif
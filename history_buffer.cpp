@@ -0,0 +1,169 @@
+#include "history_buffer.h"
+
+void snapshotChannels(const SystemSnapshot& snapshot, int cores, int32_t* values, uint32_t& throttle) {
+    values[HISTORY_TEMPERATURE] = snapshot.temperatureValid ? static_cast<int32_t>(snapshot.temperatureMilliC) : kHistoryInvalid;
+
+    const VcReading& fw = snapshot.firmware;
+    for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+        bool valid = snapshot.firmwareValid && fw.clockValid[domain];
+        values[historyDomainChannel(domain)] = valid ? static_cast<int32_t>(fw.clockHz[domain] / 1000) : kHistoryInvalid;
+    }
+    for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+        bool valid = snapshot.firmwareValid && fw.voltsValid[rail];
+        values[historyRailChannel(rail)] = valid ? static_cast<int32_t>(fw.microVolts[rail]) : kHistoryInvalid;
+    }
+
+    for (int core = 0; core < cores; core++) {
+        bool valid = core < snapshot.cpuCount && snapshot.cpuFreqValid[core];
+        values[HISTORY_CPU_FREQ_BASE + core] = valid ? static_cast<int32_t>(snapshot.cpuFreqKHz[core]) : kHistoryInvalid;
+    }
+
+    throttle = (snapshot.firmwareValid && fw.throttledValid) ? fw.throttled : 0;
+}
+
+// v3d and the core rail keep the channels they had before the other
+// domains and rails were recorded
+int historyDomainChannel(int domain) {
+    if (domain == VC_DOMAIN_V3D) return HISTORY_GPU_CLOCK;
+    return HISTORY_DOMAIN_BASE + (domain < VC_DOMAIN_V3D ? domain : domain - 1);
+}
+
+int historyRailChannel(int rail) {
+    if (rail == VC_RAIL_CORE) return HISTORY_CORE_VOLTAGE;
+    return HISTORY_RAIL_BASE + rail - 1;
+}
+
+std::string historyChannelName(int channel) {
+    switch (channel) {
+    case HISTORY_TEMPERATURE: return "temperature_mc";
+    case HISTORY_GPU_CLOCK: return "gpu_clock_khz";
+    case HISTORY_CORE_VOLTAGE: return "core_uv";
+    default: break;
+    }
+    if (channel < HISTORY_RAIL_BASE) {
+        int domain = channel - HISTORY_DOMAIN_BASE;
+        if (domain >= VC_DOMAIN_V3D) domain++;
+        return std::string(vcDomainName(domain)) + "_clock_khz";
+    }
+    if (channel < HISTORY_CPU_FREQ_BASE) return std::string(vcRailName(channel - HISTORY_RAIL_BASE + 1)) + "_uv";
+    return "cpu" + std::to_string(channel - HISTORY_CPU_FREQ_BASE) + "_khz";
+}
+
+HistoryRollup::HistoryRollup(int64_t bucketNs, size_t capacity, int channels)
+: m_bucketNs(bucketNs),
+  m_capacity(capacity),
+  m_channels(channels),
+  m_head(capacity - 1),
+  m_size(0),
+  m_start(capacity, 0),
+  m_throttle(capacity, 0),
+  m_min(capacity * channels, 0),
+  m_max(capacity * channels, 0),
+  m_sum(capacity * channels, 0),
+  m_count(capacity * channels, 0) {
+}
+
+int32_t HistoryRollup::min(int channel, size_t i) const {
+    size_t c = cell(channel, slot(i));
+    return m_count[c] ? m_min[c] : kHistoryInvalid;
+}
+
+int32_t HistoryRollup::max(int channel, size_t i) const {
+    size_t c = cell(channel, slot(i));
+    return m_count[c] ? m_max[c] : kHistoryInvalid;
+}
+
+int32_t HistoryRollup::avg(int channel, size_t i) const {
+    size_t c = cell(channel, slot(i));
+    return m_count[c] ? static_cast<int32_t>(m_sum[c] / m_count[c]) : kHistoryInvalid;
+}
+
+void HistoryRollup::openBucket(int64_t start) {
+    m_head = (m_head + 1) % m_capacity;
+    if (m_size < m_capacity) m_size++;
+
+    m_start[m_head] = start;
+    m_throttle[m_head] = 0;
+    for (int ch = 0; ch < m_channels; ch++) {
+        size_t c = cell(ch, m_head);
+        m_min[c] = INT32_MAX;
+        m_max[c] = INT32_MIN;
+        m_sum[c] = 0;
+        m_count[c] = 0;
+    }
+}
+
+void HistoryRollup::add(int64_t timestampNs, const int32_t* values, uint32_t throttle) {
+    int64_t start = timestampNs - timestampNs % m_bucketNs;
+    if (m_size == 0 || start > m_start[m_head]) {
+        openBucket(start);
+    }
+
+    // Throttle bits are sticky for the whole bucket
+    m_throttle[m_head] |= throttle;
+    for (int ch = 0; ch < m_channels; ch++) {
+        int32_t v = values[ch];
+        if (v == kHistoryInvalid) continue;
+
+        size_t c = cell(ch, m_head);
+        if (v < m_min[c]) m_min[c] = v;
+        if (v > m_max[c]) m_max[c] = v;
+        m_sum[c] += v;
+        m_count[c]++;
+    }
+}
+
+HistoryBuffer::HistoryBuffer(int cores, size_t rawCapacity, size_t secondBuckets,
+                             size_t tenSecondBuckets, size_t minuteBuckets)
+: m_channels(HISTORY_CPU_FREQ_BASE + cores),
+  m_capacity(rawCapacity),
+  m_head(0),
+  m_size(0),
+  m_timestamp(rawCapacity, 0),
+  m_throttle(rawCapacity, 0),
+  m_values(rawCapacity * m_channels, 0),
+  m_scratch(m_channels, kHistoryInvalid) {
+    m_rollups.push_back(HistoryRollup(1000000000LL, secondBuckets, m_channels));
+    m_rollups.push_back(HistoryRollup(10000000000LL, tenSecondBuckets, m_channels));
+    m_rollups.push_back(HistoryRollup(60000000000LL, minuteBuckets, m_channels));
+}
+
+void HistoryBuffer::append(const SystemSnapshot& snapshot) {
+    uint32_t throttle = 0;
+    snapshotChannels(snapshot, cores(), m_scratch.data(), throttle);
+    append(snapshot.monotonicNs, m_scratch.data(), throttle);
+}
+
+void HistoryBuffer::append(int64_t timestampNs, const int32_t* values, uint32_t throttle) {
+    m_timestamp[m_head] = timestampNs;
+    m_throttle[m_head] = throttle;
+    for (int ch = 0; ch < m_channels; ch++) {
+        m_values[static_cast<size_t>(ch) * m_capacity + m_head] = values[ch];
+    }
+    m_head = (m_head + 1) % m_capacity;
+    if (m_size < m_capacity) m_size++;
+
+    for (auto& rollup : m_rollups) {
+        rollup.add(timestampNs, values, throttle);
+    }
+}
+
+size_t HistoryBuffer::lowerBound(int64_t timestampNs) const {
+    size_t lo = 0;
+    size_t hi = m_size;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (timestamp(mid) < timestampNs) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t HistoryBuffer::memoryBytes() const {
+    size_t bytes = m_capacity * (sizeof(int64_t) + sizeof(uint32_t) + m_channels * sizeof(int32_t));
+    for (const auto& rollup : m_rollups) {
+        bytes += rollup.capacity() * (sizeof(int64_t) + sizeof(uint32_t) +
+                 m_channels * (2 * sizeof(int32_t) + sizeof(int64_t) + sizeof(uint32_t)));
+    }
+    return bytes;
+}
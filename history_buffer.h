@@ -0,0 +1,126 @@
+#ifndef OVERPI_HISTORY_BUFFER_H
+#define OVERPI_HISTORY_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "system_snapshot.h"
+
+// Value stored for a channel that had no valid reading
+const int32_t kHistoryInvalid = INT32_MIN;
+
+// Channel layout shared by raw samples and rollups
+enum HistoryChannel {
+    HISTORY_TEMPERATURE = 0,    // millidegrees Celsius
+    HISTORY_GPU_CLOCK = 1,      // kHz, the v3d domain
+    HISTORY_CORE_VOLTAGE = 2,   // microvolts
+    HISTORY_DOMAIN_BASE = 3,    // kHz, the other firmware clock domains in VcDomain order
+    HISTORY_RAIL_BASE = HISTORY_DOMAIN_BASE + VC_DOMAIN_COUNT - 1,   // microvolts, the SDRAM rails
+    HISTORY_CPU_FREQ_BASE = HISTORY_RAIL_BASE + VC_RAIL_COUNT - 1    // kHz, one channel per core
+};
+
+// History channel of a firmware clock domain or voltage rail
+int historyDomainChannel(int domain);
+int historyRailChannel(int rail);
+
+// Flatten a snapshot into the channel layout above
+void snapshotChannels(const SystemSnapshot& snapshot, int cores, int32_t* values, uint32_t& throttle);
+
+// Stable machine-readable name of a channel, e.g. "temperature_mc" or "cpu2_khz"
+std::string historyChannelName(int channel);
+
+// Fixed-size ring of min/max/avg buckets covering a fixed time span each
+class HistoryRollup {
+public:
+    HistoryRollup(int64_t bucketNs, size_t capacity, int channels);
+
+    int64_t bucketNs() const { return m_bucketNs; }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+
+    // Index 0 is the oldest bucket, size() - 1 the one still filling
+    int64_t bucketStart(size_t i) const { return m_start[slot(i)]; }
+    int32_t min(int channel, size_t i) const;
+    int32_t max(int channel, size_t i) const;
+    int32_t avg(int channel, size_t i) const;
+    uint32_t throttleBits(size_t i) const { return m_throttle[slot(i)]; }
+
+    void add(int64_t timestampNs, const int32_t* values, uint32_t throttle);
+
+private:
+    size_t slot(size_t i) const { return (m_head + m_capacity - m_size + 1 + i) % m_capacity; }
+    size_t cell(int channel, size_t s) const { return static_cast<size_t>(channel) * m_capacity + s; }
+    void openBucket(int64_t start);
+
+    int64_t m_bucketNs;
+    size_t m_capacity;
+    int m_channels;
+    size_t m_head;
+    size_t m_size;
+
+    std::vector<int64_t> m_start;
+    std::vector<uint32_t> m_throttle;
+    std::vector<int32_t> m_min;
+    std::vector<int32_t> m_max;
+    std::vector<int64_t> m_sum;
+    std::vector<uint32_t> m_count;
+};
+
+// Fixed-capacity time-series history in structure-of-arrays layout.
+// Raw samples are kept for a short window; 1 s, 10 s and 1 min rollups
+// keep min/max/avg for hours. Every append is O(1) and allocation-free.
+class HistoryBuffer {
+public:
+    enum Tier {
+        TIER_1S = 0,
+        TIER_10S = 1,
+        TIER_1MIN = 2,
+        TIER_COUNT = 3
+    };
+
+    // Defaults: 2 minutes of raw samples at 100 Hz, 1 h / 6 h / 24 h of rollups
+    explicit HistoryBuffer(int cores,
+                           size_t rawCapacity = 12000,
+                           size_t secondBuckets = 3600,
+                           size_t tenSecondBuckets = 2160,
+                           size_t minuteBuckets = 1440);
+
+    int channels() const { return m_channels; }
+    int cores() const { return m_channels - HISTORY_CPU_FREQ_BASE; }
+
+    void append(const SystemSnapshot& snapshot);
+    void append(int64_t timestampNs, const int32_t* values, uint32_t throttle);
+
+    // Raw samples, index 0 is the oldest
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    int64_t timestamp(size_t i) const { return m_timestamp[slot(i)]; }
+    int32_t value(int channel, size_t i) const { return m_values[static_cast<size_t>(channel) * m_capacity + slot(i)]; }
+    uint32_t throttleBits(size_t i) const { return m_throttle[slot(i)]; }
+
+    const HistoryRollup& rollup(Tier tier) const { return m_rollups[tier]; }
+
+    // Index of the first raw sample at or after timestampNs
+    size_t lowerBound(int64_t timestampNs) const;
+
+    // Total bytes reserved by all rings
+    size_t memoryBytes() const;
+
+private:
+    size_t slot(size_t i) const { return (m_head + m_capacity - m_size + i) % m_capacity; }
+
+    int m_channels;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_size;
+
+    std::vector<int64_t> m_timestamp;
+    std::vector<uint32_t> m_throttle;
+    std::vector<int32_t> m_values;
+    std::vector<HistoryRollup> m_rollups;
+    std::vector<int32_t> m_scratch;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "history_chart.h"
+
+#include <algorithm>
+#include <libintl.h>
+
+#include "latency_stats.h"
+
+#define _(string) gettext(string)
+
+namespace {
+// Fixed vertical scales keep cached columns valid while scrolling
+const double kTemperatureScale = 100000.0;  // millidegrees, 0-100 °C
+const double kClockScale = 2500000.0;       // kHz, 0-2500 MHz
+
+// Samples further apart than this are not joined by the line
+const int64_t kMaxGapNs = 10000000000LL;
+
+const uint32_t kThrottleNowMask = 0xF;
+
+struct Rgb {
+    double r, g, b;
+};
+
+const Rgb kBackground = {0.12, 0.12, 0.14};
+const Rgb kGrid = {0.22, 0.22, 0.25};
+const Rgb kThrottle = {0.45, 0.12, 0.10};
+const Rgb kSeriesColor[] = {
+    {0.91, 0.30, 0.24},   // temperature, #e74c3c
+    {0.20, 0.60, 0.86},   // CPU, #3498db
+    {0.95, 0.61, 0.07}    // GPU, #f39c12
+};
+}
+
+HistoryChart::HistoryChart(const HistoryBuffer& history, std::mutex& historyMutex, int windowSeconds)
+: m_history(history),
+  m_historyMutex(historyMutex),
+  m_windowNs(static_cast<int64_t>(windowSeconds) * 1000000000LL),
+  m_width(0),
+  m_height(0),
+  m_columnNs(1),
+  m_lastColumn(0),
+  m_cacheValid(false) {
+    set_size_request(-1, 180);
+}
+
+void HistoryChart::refresh() {
+    queue_draw();
+}
+
+double HistoryChart::seriesY(int series, int32_t value) const {
+    double scale = (series == SERIES_TEMPERATURE) ? kTemperatureScale : kClockScale;
+    double y = (m_height - 1) * (1.0 - value / scale);
+    return std::max(0.0, std::min(static_cast<double>(m_height - 1), y));
+}
+
+bool HistoryChart::columnStats(int64_t column, ColumnStats& stats) const {
+    int64_t start = column * m_columnNs;
+    int64_t end = start + m_columnNs;
+
+    for (int s = 0; s < SERIES_COUNT; s++) {
+        stats.valid[s] = false;
+        stats.min[s] = INT32_MAX;
+        stats.max[s] = INT32_MIN;
+    }
+    stats.throttle = 0;
+
+    size_t size = m_history.size();
+    size_t first = m_history.lowerBound(start);
+
+    // Include the preceding sample so steps and sparse data join up
+    size_t i = first;
+    if (i > 0 && start - m_history.timestamp(i - 1) <= kMaxGapNs) i--;
+
+    bool any = false;
+    for (; i < size && m_history.timestamp(i) < end; i++) {
+        int32_t values[SERIES_COUNT];
+        values[SERIES_TEMPERATURE] = m_history.value(HISTORY_TEMPERATURE, i);
+        values[SERIES_GPU] = m_history.value(HISTORY_GPU_CLOCK, i);
+
+        // CPU band spans the slowest and fastest core
+        int32_t cpuMin = INT32_MAX;
+        int32_t cpuMax = INT32_MIN;
+        for (int core = 0; core < m_history.cores(); core++) {
+            int32_t v = m_history.value(HISTORY_CPU_FREQ_BASE + core, i);
+            if (v == kHistoryInvalid) continue;
+            cpuMin = std::min(cpuMin, v);
+            cpuMax = std::max(cpuMax, v);
+        }
+        values[SERIES_CPU] = (cpuMax == INT32_MIN) ? kHistoryInvalid : cpuMin;
+
+        for (int s = 0; s < SERIES_COUNT; s++) {
+            if (values[s] == kHistoryInvalid) continue;
+            int32_t hi = (s == SERIES_CPU) ? cpuMax : values[s];
+            stats.valid[s] = true;
+            stats.min[s] = std::min(stats.min[s], values[s]);
+            stats.max[s] = std::max(stats.max[s], hi);
+        }
+        stats.throttle |= m_history.throttleBits(i);
+        any = true;
+    }
+    return any;
+}
+
+void HistoryChart::drawColumns(const Cairo::RefPtr<Cairo::Context>& cr, int64_t firstColumn, int64_t lastColumn, int64_t newestColumn) {
+    for (int64_t column = firstColumn; column <= lastColumn; column++) {
+        double x = m_width - 1 - static_cast<double>(newestColumn - column);
+        if (x < 0) continue;
+
+        ColumnStats stats;
+        bool any = columnStats(column, stats);
+
+        const Rgb& bg = (any && (stats.throttle & kThrottleNowMask)) ? kThrottle : kBackground;
+        cr->set_source_rgb(bg.r, bg.g, bg.b);
+        cr->rectangle(x, 0, 1, m_height);
+        cr->fill();
+
+        cr->set_source_rgb(kGrid.r, kGrid.g, kGrid.b);
+        for (int line = 1; line < 4; line++) {
+            cr->rectangle(x, (m_height * line) / 4, 1, 1);
+        }
+        cr->fill();
+
+        if (!any) continue;
+
+        for (int s = 0; s < SERIES_COUNT; s++) {
+            if (!stats.valid[s]) continue;
+            double top = seriesY(s, stats.max[s]);
+            double bottom = seriesY(s, stats.min[s]);
+            cr->set_source_rgb(kSeriesColor[s].r, kSeriesColor[s].g, kSeriesColor[s].b);
+            cr->rectangle(x, top, 1, std::max(1.0, bottom - top + 1));
+            cr->fill();
+        }
+    }
+}
+
+void HistoryChart::updateCache(int width, int height) {
+    if (width != m_width || height != m_height || !m_surface) {
+        m_width = width;
+        m_height = height;
+        m_surface = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, width, height);
+        m_scratch = Cairo::ImageSurface::create(Cairo::FORMAT_RGB24, width, height);
+        m_columnNs = std::max<int64_t>(1, m_windowNs / width);
+        m_cacheValid = false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_historyMutex);
+    if (m_history.size() == 0) {
+        if (!m_cacheValid) {
+            auto cr = Cairo::Context::create(m_surface);
+            cr->set_source_rgb(kBackground.r, kBackground.g, kBackground.b);
+            cr->paint();
+        }
+        return;
+    }
+
+    int64_t newestColumn = m_history.timestamp(m_history.size() - 1) / m_columnNs;
+    int64_t elapsed = newestColumn - m_lastColumn;
+
+    if (!m_cacheValid || elapsed < 0 || elapsed >= m_width) {
+        auto cr = Cairo::Context::create(m_surface);
+        drawColumns(cr, newestColumn - m_width + 1, newestColumn, newestColumn);
+        m_cacheValid = true;
+    } else {
+        if (elapsed > 0) {
+            // Scroll the cached plot left by the elapsed columns
+            auto scroll = Cairo::Context::create(m_scratch);
+            scroll->set_operator(Cairo::OPERATOR_SOURCE);
+            scroll->set_source(m_surface, -static_cast<double>(elapsed), 0);
+            scroll->paint();
+            std::swap(m_surface, m_scratch);
+        }
+
+        // The previous newest column may have received more samples
+        auto cr = Cairo::Context::create(m_surface);
+        drawColumns(cr, m_lastColumn, newestColumn, newestColumn);
+    }
+    m_lastColumn = newestColumn;
+}
+
+void HistoryChart::drawOverlay(const Cairo::RefPtr<Cairo::Context>& cr, int width, int height) {
+    cr->set_font_size(11);
+
+    const char* names[SERIES_COUNT] = { _("Temperature"), _("CPU"), _("GPU") };
+    double x = 8;
+    for (int s = 0; s < SERIES_COUNT; s++) {
+        cr->set_source_rgb(kSeriesColor[s].r, kSeriesColor[s].g, kSeriesColor[s].b);
+        cr->move_to(x, 14);
+        cr->show_text(names[s]);
+        x += 90;
+    }
+
+    cr->set_source_rgb(0.7, 0.7, 0.7);
+    cr->move_to(8, height - 6);
+    cr->show_text("0 °C / 0 MHz");
+    cr->move_to(width - 120, 14);
+    cr->show_text("100 °C / 2500 MHz");
+}
+
+bool HistoryChart::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
+    ScopedLatency latency(PROBE_CHART_DRAW);
+    int width = get_allocated_width();
+    int height = get_allocated_height();
+    if (width <= 0 || height <= 0) return true;
+
+    updateCache(width, height);
+
+    cr->set_source(m_surface, 0, 0);
+    cr->paint();
+    drawOverlay(cr, width, height);
+    return true;
+}
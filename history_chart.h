@@ -0,0 +1,58 @@
+#ifndef OVERPI_HISTORY_CHART_H
+#define OVERPI_HISTORY_CHART_H
+
+#include <gtkmm.h>
+#include <mutex>
+#include <cstdint>
+
+#include "history_buffer.h"
+
+// Live chart of temperature, CPU/GPU clocks and throttle intervals.
+// The plot is kept in a cached surface: on each refresh the cache is
+// scrolled by the number of elapsed pixel columns and only the new
+// columns are drawn, each one min/max-decimated from the raw samples.
+class HistoryChart : public Gtk::DrawingArea {
+public:
+    HistoryChart(const HistoryBuffer& history, std::mutex& historyMutex, int windowSeconds = 120);
+
+    // Call after new samples were appended
+    void refresh();
+
+protected:
+    bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override;
+
+private:
+    enum Series {
+        SERIES_TEMPERATURE = 0,
+        SERIES_CPU = 1,
+        SERIES_GPU = 2,
+        SERIES_COUNT = 3
+    };
+
+    struct ColumnStats {
+        bool valid[SERIES_COUNT];
+        int32_t min[SERIES_COUNT];
+        int32_t max[SERIES_COUNT];
+        uint32_t throttle;
+    };
+
+    void updateCache(int width, int height);
+    void drawColumns(const Cairo::RefPtr<Cairo::Context>& cr, int64_t firstColumn, int64_t lastColumn, int64_t newestColumn);
+    bool columnStats(int64_t column, ColumnStats& stats) const;
+    double seriesY(int series, int32_t value) const;
+    void drawOverlay(const Cairo::RefPtr<Cairo::Context>& cr, int width, int height);
+
+    const HistoryBuffer& m_history;
+    std::mutex& m_historyMutex;
+    int64_t m_windowNs;
+
+    Cairo::RefPtr<Cairo::ImageSurface> m_surface;
+    Cairo::RefPtr<Cairo::ImageSurface> m_scratch;
+    int m_width;
+    int m_height;
+    int64_t m_columnNs;
+    int64_t m_lastColumn;
+    bool m_cacheValid;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "latency_stats.h"
+
+#include <cstdio>
+#include <time.h>
+
+namespace {
+LatencyHistogram g_histograms[PROBE_COUNT];
+
+const char* const kProbeNames[PROBE_COUNT] = {
+    "collect",
+    "read_temperature",
+    "read_frequency",
+    "read_limits",
+    "read_governor",
+    "mailbox",
+    "exec_command",
+    "perf",
+    "decode_throttling",
+    "render",
+    "chart_draw",
+    "metrics_scrape",
+    "apply_governor",
+    "apply_limits",
+    "config_load",
+    "config_backup",
+    "config_save"
+};
+
+int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_totalNs.store(0, std::memory_order_relaxed);
+    m_maxNs.store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns) {
+    // Values below 2^kSubBits get a bucket each
+    if (ns < (1u << kSubBits)) return static_cast<int>(ns);
+    int log2 = 63 - __builtin_clzll(ns);
+    int sub = static_cast<int>((ns >> (log2 - kSubBits)) & ((1u << kSubBits) - 1));
+    return ((log2 - kSubBits + 1) << kSubBits) + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(int bucket) {
+    if (bucket < (1 << kSubBits)) return static_cast<uint64_t>(bucket);
+    int log2 = (bucket >> kSubBits) + kSubBits - 1;
+    uint64_t sub = static_cast<uint64_t>(bucket & ((1 << kSubBits) - 1));
+    uint64_t lower = (1ULL << log2) + (sub << (log2 - kSubBits));
+    return lower + (1ULL << (log2 - kSubBits)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    m_buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t max = m_maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !m_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    // Concurrent records may make the buckets and count disagree slightly;
+    // the percentiles are taken over the buckets alone
+    uint64_t counts[kBuckets];
+    uint64_t count = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        count += counts[i];
+    }
+
+    LatencySummary summary = {count, 0, 0, m_maxNs.load(std::memory_order_relaxed),
+                              m_totalNs.load(std::memory_order_relaxed)};
+    if (count == 0) return summary;
+
+    uint64_t p50Rank = (count + 1) / 2;
+    uint64_t p99Rank = count - count / 100;
+    uint64_t seen = 0;
+    bool p50Found = false;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts[i];
+        if (!p50Found && seen >= p50Rank) {
+            summary.p50Ns = bucketUpperNs(i);
+            p50Found = true;
+        }
+        if (seen >= p99Rank) {
+            summary.p99Ns = bucketUpperNs(i);
+            break;
+        }
+    }
+
+    // A bucket bound can overshoot the largest value seen
+    if (summary.p50Ns > summary.maxNs) summary.p50Ns = summary.maxNs;
+    if (summary.p99Ns > summary.maxNs) summary.p99Ns = summary.maxNs;
+    return summary;
+}
+
+LatencyHistogram& latencyHistogram(LatencyProbe probe) {
+    return g_histograms[probe];
+}
+
+const char* latencyProbeName(LatencyProbe probe) {
+    return kProbeNames[probe];
+}
+
+ScopedLatency::ScopedLatency(LatencyProbe probe)
+: m_probe(probe),
+  m_startNs(nowNs()) {
+}
+
+ScopedLatency::~ScopedLatency() {
+    int64_t elapsed = nowNs() - m_startNs;
+    g_histograms[m_probe].record(elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+}
+
+std::string formatLatency() {
+    std::string text;
+    char line[160];
+    snprintf(line, sizeof(line), "%-18s %8s %10s %10s %10s %10s\n", "step", "calls", "p50 us", "p99 us", "max us", "total ms");
+    text += line;
+
+    for (int i = 0; i < PROBE_COUNT; i++) {
+        LatencySummary s = g_histograms[i].summary();
+        if (s.count == 0) continue;
+        snprintf(line, sizeof(line), "%-18s %8llu %10.1f %10.1f %10.1f %10.1f\n", kProbeNames[i],
+                 static_cast<unsigned long long>(s.count),
+                 s.p50Ns / 1000.0, s.p99Ns / 1000.0, s.maxNs / 1000.0, s.totalNs / 1000000.0);
+        text += line;
+    }
+    return text;
+}
+
+std::string formatLatencyLine() {
+    std::string text = "OK";
+    char item[96];
+    for (int i = 0; i < PROBE_COUNT; i++) {
+        LatencySummary s = g_histograms[i].summary();
+        if (s.count == 0) continue;
+        snprintf(item, sizeof(item), " %s=%llu:%llu:%llu:%llu", kProbeNames[i],
+                 static_cast<unsigned long long>(s.count),
+                 static_cast<unsigned long long>(s.p50Ns / 1000),
+                 static_cast<unsigned long long>(s.p99Ns / 1000),
+                 static_cast<unsigned long long>(s.maxNs / 1000));
+        text += item;
+    }
+    return text;
+}
+
+void resetLatency() {
+    for (auto& histogram : g_histograms) histogram.reset();
+}
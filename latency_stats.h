@@ -0,0 +1,91 @@
+#ifndef OVERPI_LATENCY_STATS_H
+#define OVERPI_LATENCY_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Instrumented steps of the sampling, rendering and apply paths
+enum LatencyProbe {
+    PROBE_COLLECT = 0,          // whole SnapshotCollector::collect()
+    PROBE_READ_TEMPERATURE,
+    PROBE_READ_FREQUENCY,       // one core's scaling_cur_freq
+    PROBE_READ_LIMITS,
+    PROBE_READ_GOVERNOR,
+    PROBE_MAILBOX,              // batched firmware query
+    PROBE_EXEC_COMMAND,         // vcgencmd fallback, one popen
+    PROBE_PERF,
+    PROBE_DECODE_THROTTLING,
+    PROBE_RENDER,               // labels for one snapshot
+    PROBE_CHART_DRAW,
+    PROBE_METRICS_SCRAPE,
+    PROBE_APPLY_GOVERNOR,       // applyProfileHot: governor switch
+    PROBE_APPLY_LIMITS,         // applyProfileHot: min/max clock
+    PROBE_CONFIG_LOAD,          // applyProfilePermanent: read and parse
+    PROBE_CONFIG_BACKUP,
+    PROBE_CONFIG_SAVE,          // write, fsync and rename
+    PROBE_COUNT
+};
+
+struct LatencySummary {
+    uint64_t count;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t maxNs;
+    uint64_t totalNs;
+};
+
+// Log-bucketed histogram: four sub-buckets per power of two, so any
+// percentile is within 19% of the true value. Recording is a handful
+// of relaxed atomic increments and is safe from any thread.
+class LatencyHistogram {
+public:
+    static const int kSubBits = 2;
+    static const int kBuckets = 64 << kSubBits;
+
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    LatencySummary summary() const;
+    void reset();
+
+private:
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    static int bucketOf(uint64_t ns);
+    static uint64_t bucketUpperNs(int bucket);
+
+    std::atomic<uint64_t> m_buckets[kBuckets];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_totalNs;
+    std::atomic<uint64_t> m_maxNs;
+};
+
+// Process-wide histogram of a probe
+LatencyHistogram& latencyHistogram(LatencyProbe probe);
+const char* latencyProbeName(LatencyProbe probe);
+
+// Records the lifetime of the scope into a probe
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyProbe probe);
+    ~ScopedLatency();
+
+private:
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+    LatencyProbe m_probe;
+    int64_t m_startNs;
+};
+
+// Table of count, p50, p99, max and total per probe that has been hit
+std::string formatLatency();
+
+// One line for the control socket: name=count:p50_us:p99_us:max_us ...
+std::string formatLatencyLine();
+
+void resetLatency();
+
+#endif
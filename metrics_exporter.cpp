@@ -0,0 +1,377 @@
+#include "metrics_exporter.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "latency_stats.h"
+#include "snapshot_collector.h"
+
+const int MetricsExporter::kMaxConnections;
+const size_t MetricsExporter::kRequestBytes;
+const size_t MetricsExporter::kBodyBytes;
+
+namespace {
+// Bounded printf-style appends into a caller-owned buffer
+class TextWriter {
+public:
+    TextWriter(char* out, size_t capacity) : m_out(out), m_capacity(capacity), m_len(0), m_overflow(false) {}
+
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        if (m_overflow) return;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(m_out + m_len, m_capacity - m_len, format, args);
+        va_end(args);
+        if (n < 0 || static_cast<size_t>(n) >= m_capacity - m_len) m_overflow = true;
+        else m_len += n;
+    }
+
+    // Label value with \, " and newline escaped
+    void label(const char* value) {
+        for (const char* p = value; *p && !m_overflow; p++) {
+            if (*p == '\\') printf("\\\\");
+            else if (*p == '"') printf("\\\"");
+            else if (*p == '\n') printf("\\n");
+            else printf("%c", *p);
+        }
+    }
+
+    void gauge(const char* name, const char* help) {
+        printf("# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+    }
+
+    size_t length() const { return m_len; }
+    bool overflow() const { return m_overflow; }
+
+private:
+    char* m_out;
+    size_t m_capacity;
+    size_t m_len;
+    bool m_overflow;
+};
+
+struct ThrottleFlag {
+    uint32_t bit;
+    const char* name;
+};
+
+const ThrottleFlag kThrottleFlags[] = {
+    {0x1, "under_voltage"},
+    {0x2, "frequency_capped"},
+    {0x4, "throttled"},
+    {0x8, "soft_temperature_limit"},
+    {0x10000, "under_voltage_occurred"},
+    {0x20000, "frequency_capped_occurred"},
+    {0x40000, "throttled_occurred"},
+    {0x80000, "soft_temperature_limit_occurred"}
+};
+}
+
+MetricsExporter::MetricsExporter(EventLoop& loop)
+: m_loop(loop),
+  m_listenFd(-1),
+  m_pollFd(-1) {
+    m_profile[0] = '\0';
+    for (int i = 0; i < kMaxConnections; i++) m_connections[i].fd = -1;
+}
+
+MetricsExporter::~MetricsExporter() {
+    close();
+}
+
+bool MetricsExporter::listen(int port, const std::string& address) {
+    close();
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) return false;
+
+    m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_pollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_listenFd < 0 || m_pollFd < 0) {
+        close();
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(m_listenFd, 16) != 0 ||
+        !m_loop.add(m_listenFd, EPOLLIN, [this](uint32_t) { onAccept(); }) ||
+        !m_loop.add(m_pollFd, EPOLLIN, [this](uint32_t) { onConnections(); })) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MetricsExporter::close() {
+    for (int i = 0; i < kMaxConnections; i++) release(m_connections[i]);
+
+    if (m_listenFd >= 0) {
+        m_loop.remove(m_listenFd);
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (m_pollFd >= 0) {
+        m_loop.remove(m_pollFd);
+        ::close(m_pollFd);
+        m_pollFd = -1;
+    }
+}
+
+void MetricsExporter::update(const SystemSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_snapshot = snapshot;
+}
+
+void MetricsExporter::setProfile(const std::string& profileId) {
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    snprintf(m_profile, sizeof(m_profile), "%s", profileId.c_str());
+}
+
+void MetricsExporter::onAccept() {
+    for (;;) {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        // Take a free slot, or evict the oldest connection
+        Connection* slot = nullptr;
+        for (int i = 0; i < kMaxConnections; i++) {
+            Connection& conn = m_connections[i];
+            if (conn.fd < 0) {
+                slot = &conn;
+                break;
+            }
+            if (!slot || conn.acceptedNs < slot->acceptedNs) slot = &conn;
+        }
+        release(*slot);
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = slot;
+        if (epoll_ctl(m_pollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        slot->fd = fd;
+        slot->acceptedNs = monotonicNowNs();
+        slot->requestLen = 0;
+        slot->headerLen = 0;
+        slot->bodyLen = 0;
+        slot->sent = 0;
+        slot->responding = false;
+    }
+}
+
+void MetricsExporter::onConnections() {
+    struct epoll_event events[kMaxConnections];
+    int n = epoll_wait(m_pollFd, events, kMaxConnections, 0);
+    for (int i = 0; i < n; i++) {
+        Connection& conn = *static_cast<Connection*>(events[i].data.ptr);
+        if (conn.fd >= 0) onConnection(conn, events[i].events);
+    }
+}
+
+void MetricsExporter::onConnection(Connection& conn, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        release(conn);
+        return;
+    }
+
+    if (!conn.responding) {
+        ssize_t n;
+        while ((n = recv(conn.fd, conn.request + conn.requestLen, kRequestBytes - 1 - conn.requestLen, 0)) > 0) {
+            conn.requestLen += n;
+            if (conn.requestLen == kRequestBytes - 1) break;
+        }
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            release(conn);
+            return;
+        }
+        conn.request[conn.requestLen] = '\0';
+
+        // Headers are ignored; answer once they are complete
+        if (!strstr(conn.request, "\r\n\r\n") && !strstr(conn.request, "\n\n")) {
+            if (conn.requestLen < kRequestBytes - 1) return;
+        }
+        respond(conn);
+    }
+
+    if (!send(conn)) release(conn);
+}
+
+void MetricsExporter::respond(Connection& conn) {
+    const char* status = "200 OK";
+    const char* type = "text/plain; version=0.0.4; charset=utf-8";
+
+    if (strncmp(conn.request, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+        conn.bodyLen = snprintf(conn.body, kBodyBytes, "only GET is supported\n");
+    } else if (strncmp(conn.request + 4, "/metrics ", 9) != 0 && strncmp(conn.request + 4, "/metrics?", 9) != 0) {
+        status = "404 Not Found";
+        conn.bodyLen = snprintf(conn.body, kBodyBytes, "see /metrics\n");
+    } else {
+        ScopedLatency latency(PROBE_METRICS_SCRAPE);
+        conn.bodyLen = formatMetrics(conn.body, kBodyBytes);
+        if (conn.bodyLen == 0) {
+            status = "500 Internal Server Error";
+            conn.bodyLen = snprintf(conn.body, kBodyBytes, "metrics do not fit the response buffer\n");
+        }
+    }
+    if (status[0] != '2') type = "text/plain; charset=utf-8";
+
+    conn.headerLen = snprintf(conn.header, sizeof(conn.header),
+                              "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                              status, type, conn.bodyLen);
+    conn.sent = 0;
+    conn.responding = true;
+}
+
+bool MetricsExporter::send(Connection& conn) {
+    size_t total = conn.headerLen + conn.bodyLen;
+    while (conn.sent < total) {
+        struct iovec iov[2];
+        int count = 0;
+        if (conn.sent < conn.headerLen) {
+            iov[count].iov_base = conn.header + conn.sent;
+            iov[count].iov_len = conn.headerLen - conn.sent;
+            count++;
+        }
+        size_t bodySent = conn.sent > conn.headerLen ? conn.sent - conn.headerLen : 0;
+        iov[count].iov_base = conn.body + bodySent;
+        iov[count].iov_len = conn.bodyLen - bodySent;
+        count++;
+
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.sent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct epoll_event ev = {};
+            ev.events = EPOLLOUT;
+            ev.data.ptr = &conn;
+            epoll_ctl(m_pollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+            return true;
+        }
+        return false;
+    }
+
+    // Response complete (or still waiting for the request)
+    return !conn.responding;
+}
+
+void MetricsExporter::release(Connection& conn) {
+    if (conn.fd < 0) return;
+    epoll_ctl(m_pollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    ::close(conn.fd);
+    conn.fd = -1;
+}
+
+size_t MetricsExporter::formatMetrics(char* out, size_t capacity) {
+    SystemSnapshot s;
+    char profile[sizeof(m_profile)];
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        s = m_snapshot;
+        memcpy(profile, m_profile, sizeof(profile));
+    }
+
+    TextWriter w(out, capacity);
+
+    w.gauge("overpi_snapshot_sequence", "Number of the cached snapshot.");
+    w.printf("overpi_snapshot_sequence %llu\n", static_cast<unsigned long long>(s.sequence));
+    if (s.sequence != 0) {
+        w.gauge("overpi_snapshot_age_seconds", "Time since the cached snapshot was taken.");
+        w.printf("overpi_snapshot_age_seconds %.3f\n", (monotonicNowNs() - s.monotonicNs) / 1e9);
+    }
+
+    if (s.temperatureValid) {
+        w.gauge("overpi_temperature_celsius", "SoC temperature.");
+        w.printf("overpi_temperature_celsius %.3f\n", s.temperatureMilliC / 1000.0);
+    }
+
+    w.gauge("overpi_cpu_frequency_hertz", "Current clock of each core.");
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        if (s.cpuFreqValid[cpu]) w.printf("overpi_cpu_frequency_hertz{cpu=\"%d\"} %lld\n", cpu, s.cpuFreqKHz[cpu] * 1000LL);
+    }
+
+    w.gauge("overpi_cpu_delivered_hertz", "Clock delivered while busy, from cycle counters.");
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        if (s.perf[cpu].clockValid) w.printf("overpi_cpu_delivered_hertz{cpu=\"%d\"} %lld\n", cpu, s.perf[cpu].effectiveKHz * 1000LL);
+    }
+    w.gauge("overpi_cpu_ipc", "Instructions per cycle.");
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        if (s.perf[cpu].ipcValid) w.printf("overpi_cpu_ipc{cpu=\"%d\"} %.3f\n", cpu, s.perf[cpu].ipcMilli / 1000.0);
+    }
+
+    if (s.limitsValid) {
+        w.gauge("overpi_cpu_scaling_min_hertz", "cpufreq scaling_min_freq.");
+        w.printf("overpi_cpu_scaling_min_hertz %lld\n", s.minFreqKHz * 1000LL);
+        w.gauge("overpi_cpu_scaling_max_hertz", "cpufreq scaling_max_freq.");
+        w.printf("overpi_cpu_scaling_max_hertz %lld\n", s.maxFreqKHz * 1000LL);
+    }
+
+    if (s.governorValid) {
+        w.gauge("overpi_cpu_governor_info", "Active cpufreq governor.");
+        w.printf("overpi_cpu_governor_info{governor=\"");
+        w.label(s.governor);
+        w.printf("\"} 1\n");
+    }
+
+    if (profile[0]) {
+        w.gauge("overpi_profile_info", "Active overclock profile.");
+        w.printf("overpi_profile_info{profile=\"");
+        w.label(profile);
+        w.printf("\"} 1\n");
+    }
+
+    w.gauge("overpi_thermal_governor_ceiling_hertz", "Clock ceiling set by the thermal governor, 0 when off.");
+    w.printf("overpi_thermal_governor_ceiling_hertz %lld\n", s.governorEngaged ? s.governorCeilingKHz * 1000LL : 0LL);
+
+    const VcReading& fw = s.firmware;
+    if (s.firmwareValid && fw.clockValid[VC_DOMAIN_V3D]) {
+        w.gauge("overpi_gpu_frequency_hertz", "Measured V3D clock.");
+        w.printf("overpi_gpu_frequency_hertz %lu\n", static_cast<unsigned long>(fw.clockHz[VC_DOMAIN_V3D]));
+    }
+    if (s.firmwareValid && fw.voltsValid[VC_RAIL_CORE]) {
+        w.gauge("overpi_core_voltage_volts", "Core voltage.");
+        w.printf("overpi_core_voltage_volts %.6f\n", fw.microVolts[VC_RAIL_CORE] / 1e6);
+    }
+    if (s.firmwareValid) {
+        w.gauge("overpi_clock_hertz", "Measured clock of each firmware clock domain.");
+        for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+            if (!fw.clockValid[domain]) continue;
+            w.printf("overpi_clock_hertz{domain=\"%s\"} %lu\n", vcDomainName(domain), static_cast<unsigned long>(fw.clockHz[domain]));
+        }
+        w.gauge("overpi_voltage_volts", "Voltage of each firmware rail.");
+        for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+            if (!fw.voltsValid[rail]) continue;
+            w.printf("overpi_voltage_volts{rail=\"%s\"} %.6f\n", vcRailName(rail), fw.microVolts[rail] / 1e6);
+        }
+    }
+    if (s.firmwareValid && fw.throttledValid) {
+        w.gauge("overpi_throttled_raw", "get_throttled bit mask.");
+        w.printf("overpi_throttled_raw %lu\n", static_cast<unsigned long>(fw.throttled));
+        w.gauge("overpi_throttled", "One get_throttled flag, 1 when set.");
+        for (const ThrottleFlag& flag : kThrottleFlags) {
+            w.printf("overpi_throttled{flag=\"%s\"} %d\n", flag.name, (fw.throttled & flag.bit) ? 1 : 0);
+        }
+    }
+
+    return w.overflow() ? 0 : w.length();
+}
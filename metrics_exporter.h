@@ -0,0 +1,74 @@
+#ifndef OVERPI_METRICS_EXPORTER_H
+#define OVERPI_METRICS_EXPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "event_loop.h"
+#include "system_snapshot.h"
+
+const int kDefaultMetricsPort = 9465;
+
+// Prometheus text exposition of the latest snapshot on GET /metrics.
+// Scrapes never touch sysfs or the firmware: update() caches a copy of the
+// snapshot, and each response is formatted into buffers that belong to a
+// fixed pool of connection slots, so serving a scrape does not allocate.
+// Connections live in a private epoll set that is registered with the
+// event loop as a single descriptor.
+class MetricsExporter {
+public:
+    static const int kMaxConnections = 8;
+    static const size_t kRequestBytes = 2048;
+    static const size_t kBodyBytes = 16384;
+
+    explicit MetricsExporter(EventLoop& loop);
+    ~MetricsExporter();
+
+    // Binds to the loopback interface unless another address is given
+    bool listen(int port = kDefaultMetricsPort, const std::string& address = "127.0.0.1");
+    void close();
+
+    // Thread-safe; called by whoever collects snapshots
+    void update(const SystemSnapshot& snapshot);
+    void setProfile(const std::string& profileId);
+
+private:
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    struct Connection {
+        int fd;
+        int64_t acceptedNs;
+        char request[kRequestBytes];
+        size_t requestLen;
+        char header[256];
+        size_t headerLen;
+        char body[kBodyBytes];
+        size_t bodyLen;
+        size_t sent;          // bytes of header + body already written
+        bool responding;
+    };
+
+    void onAccept();
+    void onConnections();
+    void onConnection(Connection& conn, uint32_t events);
+    void respond(Connection& conn);
+    bool send(Connection& conn);
+    void release(Connection& conn);
+    size_t formatMetrics(char* out, size_t capacity);
+
+    EventLoop& m_loop;
+    int m_listenFd;
+    int m_pollFd;
+
+    // Latest state, guarded by m_stateMutex
+    std::mutex m_stateMutex;
+    SystemSnapshot m_snapshot;
+    char m_profile[64];
+
+    Connection m_connections[kMaxConnections];
+};
+
+#endif
@@ -8,31 +8,55 @@
 #include <map>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <mutex>
 #include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <functional>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 #include <array>
+#include <algorithm>
 #include <memory>
 #include <cstdio>
+#include <ctime>
 #include <libintl.h>
 #include <locale.h>
 
+#include "system_snapshot.h"
+#include "triple_buffer.h"
+#include "history_buffer.h"
+#include "history_chart.h"
+#include "benchmark.h"
+#include "auto_tuner.h"
+#include "profile_compare.h"
+#include "profile_store.h"
+#include "overpi_core.h"
+#include "overpi_daemon.h"
+#include "metrics_exporter.h"
+#include "sample_pipeline.h"
+#include "workload_scheduler.h"
+#include "latency_stats.h"
+
 #define _(string) gettext(string)
 
-// Structure to store profile configuration
-struct ProfileConfig {
-    std::string arm_freq;
-    std::string gpu_freq;
-    std::string over_voltage;
-    std::string force_turbo;
-    std::string temp_limit;
-    std::string desc;
-    std::string color;
+// Command line options
+struct AppOptions {
+    std::string recordPath;
+    int metricsPort;   // 0 disables the /metrics endpoint
+    bool autoProfile;  // start with the workload scheduler on
+    WorkloadConfig workload;
+    
+    AppOptions() : metricsPort(0), autoProfile(false) {}
 };
 
 class PiOverclockApp : public Gtk::Window {
 public:
-    PiOverclockApp();
+    explicit PiOverclockApp(const AppOptions& options = AppOptions());
     virtual ~PiOverclockApp();
 
 protected:
@@ -44,13 +68,23 @@ protected:
     Gtk::Button m_applyHotBtn;
     Gtk::Button m_applyPermBtn;
     Gtk::Button m_infoBtn;
+    Gtk::Button m_benchmarkBtn;
+    Gtk::Button m_tuneBtn;
+    Gtk::Button m_eventsBtn;
+    Gtk::CheckButton m_governorCheck;
+    Gtk::CheckButton m_autoCheck;
     
     Gtk::Frame m_metricsFrame;
     Gtk::Box m_metricsBox;
     Gtk::Label m_cpuTempLabel;
     Gtk::Label m_cpuFreqLabel;
+    Gtk::Label m_cpuEffLabel;
     Gtk::Label m_gpuFreqLabel;
+    Gtk::Label m_coreVoltLabel;
+    Gtk::Label m_clocksLabel;
+    Gtk::Label m_railsLabel;
     Gtk::Label m_cpuGovLabel;
+    Gtk::Label m_thermalGovLabel;
     Gtk::Label m_throttlingStatusLabel;
     Gtk::Label m_throttlingDetailsLabel;
     Gtk::Label m_statusLabel;
@@ -62,59 +96,125 @@ protected:
     Gtk::Frame m_warningFrame;
     Gtk::Label m_warningLabel;
     
-    // State variables
-    std::map<std::string, ProfileConfig> m_profiles;
+    // Clock of each firmware domain in the last rendered snapshot
+    std::array<uint32_t, VC_DOMAIN_COUNT> m_lastClockHz;
+    
+    // State variables; profiles are keyed by id. The selected profile is
+    // the one in the combo box, the current one was hot-applied (empty
+    // until then); only the current one drives metrics and the governor.
+    ProfileStore m_store;
+    ProfileMap m_profiles;
+    std::string m_selectedProfile;
     std::string m_currentProfile;
     
-    // Thread for system information updates
+    // Prometheus endpoint, served by its own event loop thread
+    EventLoop m_metricsLoop;
+    MetricsExporter m_metrics;
+    std::thread m_metricsThread;
+    
+    // Producer thread sampling through the pipeline; the UI reads the
+    // trackers and the history under m_pipeline.mutex()
+    SamplePipeline m_pipeline;
+    TripleBuffer<SystemSnapshot> m_snapshots;
+    Glib::Dispatcher m_snapshotReady;
     std::thread m_updateThread;
-    bool m_threadRunning;
+    std::atomic<bool> m_threadRunning;
+    
+    // Sample history, appended by the pipeline
+    HistoryBuffer m_history;
+    HistoryChart m_chart;
+    
+    // Switches profiles with the load, driven from the UI thread
+    WorkloadScheduler m_workload;
+    
+    // Benchmark worker; the profile's result is stored when it finishes
+    std::unique_ptr<Benchmark> m_benchmark;
+    std::thread m_benchmarkThread;
+    BenchmarkResult m_benchmarkResult;
+    std::string m_benchmarkProfile;
+    Glib::Dispatcher m_benchmarkDone;
+    
+    // Auto-tune worker
+    std::unique_ptr<AutoTuner> m_tuner;
+    std::thread m_tuneThread;
+    TuneResult m_tuneResult;
+    std::string m_tuneBaseProfile;
+    Glib::Dispatcher m_tuneDone;
     
     // Methods
     void loadProfiles();
+    void refreshProfiles();   // rebuild the list from the store without rereading it
+    bool onProfileFilesChanged(Glib::IOCondition condition);
     void onProfileChanged();
     void onApplyHotClicked();
     void onApplyPermClicked();
     void onInfoClicked();
-    void updateSystemInfo();
-    void applyHotProfile(const std::string& profileName, bool showMessage = true);
-    void applyPermanentProfile(const std::string& profileName);
-    std::string getThrottlingInfo();
-    std::string decodeThrottling(const std::string& throttledHex);
-    std::string execCommand(const std::string& cmd);
+    void onEventsClicked();
+    void onGovernorToggled();
+    void onAutoToggled();
+    void followWorkload(const SystemSnapshot& snapshot);
+    void onBenchmarkClicked();
+    void onBenchmarkDone();
+    std::string formatBenchmarks();
+    void onTuneClicked();
+    void onTuneDone();
+    ProfileConfig makeTunedProfile(long freqKHz, const std::string& baseProfile);
+    void setWorkersSensitive(bool sensitive);
+    void configureGovernor();
+    void onSnapshotReady();
+    void renderSnapshot(const SystemSnapshot& snapshot);
+    void requestUpdate();
+    void showCurrentProfile();
+    void applyHotProfile(const std::string& profileId, bool showMessage = true);
+    void applyPermanentProfile(const std::string& profileId);
+    std::string profileName(const std::string& profileId) const;
+    std::string getThrottlingInfo(const SystemSnapshot& snapshot);
     bool fileExists(const std::string& filename);
     void showMessageDialog(const std::string& title, const std::string& message, Gtk::MessageType type);
     bool showQuestionDialog(const std::string& title, const std::string& message);
 };
 
-PiOverclockApp::PiOverclockApp() 
+PiOverclockApp::PiOverclockApp(const AppOptions& options) 
 : m_mainBox(Gtk::ORIENTATION_VERTICAL, 5),
   m_controlBox(Gtk::ORIENTATION_HORIZONTAL, 5),
   m_profileLabel(_("Profile:")),
   m_metricsBox(Gtk::ORIENTATION_VERTICAL, 5),
   m_descBox(Gtk::ORIENTATION_VERTICAL, 5),
-  m_threadRunning(true) {
+  m_lastClockHz(),
+  m_metrics(m_metricsLoop),
+  m_threadRunning(true),
+  m_history(m_pipeline.collector().cpuCount()),
+  m_chart(m_history, m_pipeline.mutex()),
+  m_workload(options.workload) {
     
     // Configure main window
     set_title(_("RPi 400 Overclock Control - Hot Mode"));
     set_default_size(900, 600);
     set_border_width(10);
     
-    // Load profiles
+    // Load profiles and follow edits of the profile files
+    m_selectedProfile = "normal";
     loadProfiles();
+    if (m_store.watch()) {
+        Glib::signal_io().connect(sigc::mem_fun(*this, &PiOverclockApp::onProfileFilesChanged), m_store.fd(), Glib::IO_IN);
+    }
     
     // Configure controls
-    m_profileCombo.append(_("Minimum"));
-    m_profileCombo.append(_("Normal"));
-    m_profileCombo.append(_("Moderate"));
-    m_profileCombo.append(_("High"));
-    m_profileCombo.append(_("Extreme"));
-    m_profileCombo.set_active_text(_("Normal"));
-    m_currentProfile = "Normal";
+    showCurrentProfile();
     
     m_applyHotBtn.set_label(_("Apply Hot"));
     m_applyPermBtn.set_label(_("Apply Permanently"));
     m_infoBtn.set_label(_("System Info"));
+    m_benchmarkBtn.set_label(_("Benchmark"));
+    m_benchmarkBtn.set_tooltip_text(_("Apply the profile hot and measure verified throughput on all cores"));
+    m_tuneBtn.set_label(_("Auto Tune"));
+    m_tuneBtn.set_tooltip_text(_("Search for the fastest CPU clock this board runs without errors or throttling"));
+    m_eventsBtn.set_label(_("Throttle Events"));
+    m_eventsBtn.set_tooltip_text(_("When each under-voltage, capping and throttling flag was set and cleared"));
+    m_governorCheck.set_label(_("Thermal Governor"));
+    m_governorCheck.set_tooltip_text(_("Hold the highest CPU clock that keeps the temperature below the profile limit"));
+    m_autoCheck.set_label(_("Automatic Profile"));
+    m_autoCheck.set_tooltip_text(_("Switch to High while the system is busy and to Minimum when it is idle"));
     
     m_metricsFrame.set_label(_("System Status"));
     m_descFrame.set_label(_("Profile Description"));
@@ -128,14 +228,25 @@ PiOverclockApp::PiOverclockApp()
     m_controlBox.pack_start(m_applyHotBtn, Gtk::PACK_SHRINK);
     m_controlBox.pack_start(m_applyPermBtn, Gtk::PACK_SHRINK);
     m_controlBox.pack_start(m_infoBtn, Gtk::PACK_SHRINK);
+    m_controlBox.pack_start(m_eventsBtn, Gtk::PACK_SHRINK);
+    m_controlBox.pack_start(m_benchmarkBtn, Gtk::PACK_SHRINK);
+    m_controlBox.pack_start(m_tuneBtn, Gtk::PACK_SHRINK);
+    m_controlBox.pack_start(m_governorCheck, Gtk::PACK_SHRINK);
+    m_controlBox.pack_start(m_autoCheck, Gtk::PACK_SHRINK);
     
     m_metricsBox.pack_start(m_cpuTempLabel);
     m_metricsBox.pack_start(m_cpuFreqLabel);
+    m_metricsBox.pack_start(m_cpuEffLabel);
     m_metricsBox.pack_start(m_gpuFreqLabel);
+    m_metricsBox.pack_start(m_coreVoltLabel);
+    m_metricsBox.pack_start(m_clocksLabel);
+    m_metricsBox.pack_start(m_railsLabel);
     m_metricsBox.pack_start(m_cpuGovLabel);
+    m_metricsBox.pack_start(m_thermalGovLabel);
     m_metricsBox.pack_start(m_throttlingStatusLabel);
     m_metricsBox.pack_start(m_throttlingDetailsLabel);
     m_metricsBox.pack_start(m_statusLabel);
+    m_metricsBox.pack_start(m_chart);
     m_metricsFrame.add(m_metricsBox);
     
     m_descBox.pack_start(m_descLabel);
@@ -155,98 +266,166 @@ PiOverclockApp::PiOverclockApp()
     m_applyHotBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onApplyHotClicked));
     m_applyPermBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onApplyPermClicked));
     m_infoBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onInfoClicked));
+    m_eventsBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onEventsClicked));
+    m_benchmarkBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onBenchmarkClicked));
+    m_tuneBtn.signal_clicked().connect(sigc::mem_fun(*this, &PiOverclockApp::onTuneClicked));
+    m_governorCheck.signal_toggled().connect(sigc::mem_fun(*this, &PiOverclockApp::onGovernorToggled));
+    m_autoCheck.signal_toggled().connect(sigc::mem_fun(*this, &PiOverclockApp::onAutoToggled));
+    m_snapshotReady.connect(sigc::mem_fun(*this, &PiOverclockApp::onSnapshotReady));
+    m_benchmarkDone.connect(sigc::mem_fun(*this, &PiOverclockApp::onBenchmarkDone));
+    m_tuneDone.connect(sigc::mem_fun(*this, &PiOverclockApp::onTuneDone));
     
-    // Start update thread
+    m_pipeline.setHistory(&m_history);
+    m_pipeline.setMetrics(&m_metrics);
+    
+    // Start recording before the first sample is taken
+    if (!options.recordPath.empty() && !m_pipeline.recorder().open(options.recordPath, m_pipeline.collector().cpuCount())) {
+        std::cerr << _("Error: Could not open telemetry log: ") << options.recordPath << std::endl;
+    }
+    
+    if (options.metricsPort > 0) {
+        if (m_metrics.listen(options.metricsPort)) {
+            m_metricsThread = std::thread([this]() { m_metricsLoop.run(); });
+        } else {
+            std::cerr << _("Error: Could not serve metrics on port ") << options.metricsPort << std::endl;
+        }
+    }
+    
+    // Start update thread: all sensor I/O happens here, the UI only renders
     m_updateThread = std::thread([this]() {
         while (m_threadRunning) {
-            Glib::signal_idle().connect_once(sigc::mem_fun(*this, &PiOverclockApp::updateSystemInfo));
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+            SystemSnapshot& snapshot = m_snapshots.back();
+            int intervalMs = m_pipeline.sample(snapshot);
+            m_snapshots.publish();
+            m_snapshotReady.emit();
+            
+            m_pipeline.scheduler().arm(intervalMs);
+            m_pipeline.scheduler().wait();
         }
     });
     
     // Update initial interface
     onProfileChanged();
-    updateSystemInfo();
+    m_autoCheck.set_active(options.autoProfile);
+    renderSnapshot(m_snapshots.front());
     
     show_all_children();
 }
 
 PiOverclockApp::~PiOverclockApp() {
+    m_metricsLoop.stop();
+    if (m_metricsThread.joinable()) {
+        m_metricsThread.join();
+    }
+    
+    if (m_benchmark) m_benchmark->cancel();
+    if (m_benchmarkThread.joinable()) {
+        m_benchmarkThread.join();
+    }
+    if (m_tuner) m_tuner->cancel();
+    if (m_tuneThread.joinable()) {
+        m_tuneThread.join();
+    }
+    
     m_threadRunning = false;
+    m_pipeline.scheduler().wake();
     if (m_updateThread.joinable()) {
         m_updateThread.join();
     }
 }
 
 void PiOverclockApp::loadProfiles() {
-    // Minimum Profile
-    ProfileConfig minimum;
-    minimum.arm_freq = "600";
-    minimum.gpu_freq = "500";
-    minimum.over_voltage = "0";
-    minimum.force_turbo = "0";
-    minimum.temp_limit = "80";
-    minimum.desc = _("Minimum operation configuration\n- CPU: 600 MHz\n- GPU: 500 MHz\n- Overvoltage: 0\n- Force Turbo: 0");
-    minimum.color = "#27ae60";
-    m_profiles[_("Minimum")] = minimum;
-    
-    // Normal Profile
-    ProfileConfig normal;
-    normal.arm_freq = "1800";
-    normal.gpu_freq = "500";
-    normal.over_voltage = "0";
-    normal.force_turbo = "0";
-    normal.temp_limit = "80";
-    normal.desc = _("Factory default configuration\n- CPU: 1800 MHz\n- GPU: 500 MHz\n- Overvoltage: 0\n- Force Turbo: 0");
-    normal.color = "#27ae60";
-    m_profiles[_("Normal")] = normal;
-    
-    // Moderate Profile
-    ProfileConfig moderate;
-    moderate.arm_freq = "1900";
-    moderate.gpu_freq = "550";
-    moderate.over_voltage = "2";
-    moderate.force_turbo = "0";
-    moderate.temp_limit = "75";
-    moderate.desc = _("Slight performance increase\n- CPU: 1900 MHz\n- GPU: 550 MHz\n- Overvoltage: 2\n- Force Turbo: 0");
-    moderate.color = "#3498db";
-    m_profiles[_("Moderate")] = moderate;
-    
-    // High Profile
-    ProfileConfig high;
-    high.arm_freq = "2000";
-    high.gpu_freq = "600";
-    high.over_voltage = "4";
-    high.force_turbo = "0";
-    high.temp_limit = "70";
-    high.desc = _("Improved performance\n- CPU: 2000 MHz\n- GPU: 600 MHz\n- Overvoltage: 4\n- Force Turbo: 0");
-    high.color = "#f39c12";
-    m_profiles[_("High")] = high;
-    
-    // Extreme Profile
-    ProfileConfig extreme;
-    extreme.arm_freq = "2200";
-    extreme.gpu_freq = "750";
-    extreme.over_voltage = "8";
-    extreme.force_turbo = "0";
-    extreme.temp_limit = "65";
-    extreme.desc = _("Maximum performance (dangerous)\n- CPU: 2200 MHz\n- GPU: 750 MHz\n- Overvoltage: 8\n- Force Turbo: 0\n\n⚠️ REQUIRES GOOD COOLING");
-    extreme.color = "#e74c3c";
-    m_profiles[_("Extreme")] = extreme;
+    m_store.load();
+    refreshProfiles();
+}
+
+void PiOverclockApp::refreshProfiles() {
+    for (const auto& error : m_store.errors()) {
+        std::cerr << error << std::endl;
+    }
+    
+    // Benchmark results and the tuned profile live only in this session
+    ProfileMap profiles = m_store.profiles();
+    for (const auto& entry : m_profiles) {
+        auto it = profiles.find(entry.first);
+        if (it != profiles.end()) {
+            it->second.benchmark = entry.second.benchmark;
+        } else if (entry.first == "tuned") {
+            profiles[entry.first] = entry.second;
+        }
+    }
+    m_profiles.swap(profiles);
+    
+    std::string selected = m_selectedProfile;
+    if (m_profiles.find(selected) == m_profiles.end()) selected = "normal";
+    m_profileCombo.remove_all();
+    for (const ProfileConfig* profile : sortedProfiles(m_profiles)) {
+        m_profileCombo.append(profile->id, profile->name);
+    }
+    m_profileCombo.set_active_id(selected);
+}
+
+bool PiOverclockApp::onProfileFilesChanged(Glib::IOCondition) {
+    // consume() has reloaded the store already
+    if (m_store.consume()) {
+        refreshProfiles();
+        onProfileChanged();
+    }
+    return true;
 }
 
 void PiOverclockApp::onProfileChanged() {
-    m_currentProfile = m_profileCombo.get_active_text();
-    if (m_profiles.find(m_currentProfile) != m_profiles.end()) {
-        m_descLabel.set_label(m_profiles[m_currentProfile].desc);
-        m_statusLabel.set_label(_("Current profile: ") + m_currentProfile);
+    // Emitted with nothing selected while the list is refilled
+    if (m_profileCombo.get_active_id().empty()) return;
+    
+    // Only shown; metrics and the governor follow the applied profile
+    m_selectedProfile = m_profileCombo.get_active_id();
+    if (m_profiles.find(m_selectedProfile) != m_profiles.end()) {
+        m_descLabel.set_label(m_profiles[m_selectedProfile].desc);
     }
 }
 
+void PiOverclockApp::onGovernorToggled() {
+    if (m_governorCheck.get_active()) {
+        configureGovernor();
+    } else {
+        m_pipeline.releaseGovernor();
+    }
+    requestUpdate();
+}
+
+void PiOverclockApp::onAutoToggled() {
+    // Decide from fresh load readings on the next snapshot
+    if (m_autoCheck.get_active()) {
+        m_workload.reset();
+        requestUpdate();
+    }
+}
+
+void PiOverclockApp::followWorkload(const SystemSnapshot& snapshot) {
+    // Benchmarks and the tuner set the clocks themselves
+    if (!m_autoCheck.get_active() || m_benchmark || m_tuner) return;
+    
+    std::string profileId;
+    if (!m_workload.update(snapshot.monotonicNs, profileId)) return;
+    
+    if (m_profiles.find(profileId) == m_profiles.end()) return;
+    m_profileCombo.set_active_id(profileId);
+    applyHotProfile(profileId, false);
+}
+
+void PiOverclockApp::configureGovernor() {
+    // Same fallback as the daemon when nothing was applied yet
+    const ProfileConfig* profile = findProfile(m_profiles, m_currentProfile);
+    if (!profile) profile = findProfile(m_profiles, "normal");
+    if (profile) m_pipeline.engageGovernor(*profile);
+}
+
 void PiOverclockApp::onApplyHotClicked() {
-    std::string selectedProfile = m_profileCombo.get_active_text();
+    std::string selectedProfile = m_profileCombo.get_active_id();
+    if (m_profiles.find(selectedProfile) == m_profiles.end()) return;
     
-    if (selectedProfile == _("Extreme")) {
+    if (selectedProfile == "extreme") {
         if (!showQuestionDialog(_("⚠️ DANGER - EXTREME OVERCLOCK"), 
             _("EXTREME PROFILE IS DANGEROUS:\n\n"
             "• Can permanently damage your Raspberry Pi\n"
@@ -254,7 +433,7 @@ void PiOverclockApp::onApplyHotClicked() {
             "• Requires excellent active cooling\n"
             "• Void warranty permanently\n\n"
             "Are you absolutely sure to continue?"))) {
-            m_profileCombo.set_active_text(_("Normal"));
+            m_profileCombo.set_active_id("normal");
             onProfileChanged();
             return;
         }
@@ -266,13 +445,16 @@ void PiOverclockApp::onApplyHotClicked() {
         "- Only CPU frequency will be adjusted\n"
         "- Overvoltage and GPU require permanent application\n"
         "- Changes will be lost on reboot\n\n"
-        "Do you want to continue?")).replace(std::string(_("Profile '%s' will be applied hot.")).find("%s"), 2, selectedProfile))) {
+        "Do you want to continue?")).replace(std::string(_("Profile '%s' will be applied hot.")).find("%s"), 2, m_profiles[selectedProfile].name))) {
+        // Unticking auto keeps the workload scheduler from undoing this pick
+        m_autoCheck.set_active(false);
         applyHotProfile(selectedProfile);
     }
 }
 
 void PiOverclockApp::onApplyPermClicked() {
-    std::string selectedProfile = m_profileCombo.get_active_text();
+    std::string selectedProfile = m_profileCombo.get_active_id();
+    if (m_profiles.find(selectedProfile) == m_profiles.end()) return;
     
     ProfileConfig settings = m_profiles[selectedProfile];
     std::string message = std::string(_("Are you sure to apply profile '%s' permanently?\n\n"
@@ -285,19 +467,19 @@ void PiOverclockApp::onApplyPermClicked() {
     
     // Replace placeholders
     size_t pos = message.find("%s");
-    if (pos != std::string::npos) message.replace(pos, 2, selectedProfile);
+    if (pos != std::string::npos) message.replace(pos, 2, settings.name);
     
     pos = message.find("%s");
-    if (pos != std::string::npos) message.replace(pos, 2, settings.arm_freq);
+    if (pos != std::string::npos) message.replace(pos, 2, std::to_string(settings.armFreqMHz));
     
     pos = message.find("%s");
-    if (pos != std::string::npos) message.replace(pos, 2, settings.gpu_freq);
+    if (pos != std::string::npos) message.replace(pos, 2, std::to_string(settings.gpuFreqMHz));
     
     pos = message.find("%s");
-    if (pos != std::string::npos) message.replace(pos, 2, settings.over_voltage);
+    if (pos != std::string::npos) message.replace(pos, 2, std::to_string(settings.overVoltage));
     
     pos = message.find("%s");
-    if (pos != std::string::npos) message.replace(pos, 2, settings.force_turbo);
+    if (pos != std::string::npos) message.replace(pos, 2, settings.forceTurbo ? "1" : "0");
     
     if (showQuestionDialog(_("Confirm Permanent Change"), message)) {
         applyPermanentProfile(selectedProfile);
@@ -307,300 +489,539 @@ void PiOverclockApp::onApplyPermClicked() {
 void PiOverclockApp::onInfoClicked() {
     std::string info = _("=== SYSTEM INFORMATION ===\n\n");
     
+    const SystemSnapshot& snapshot = m_snapshots.front();
+    
     // Get CPU information
-    try {
-        std::ifstream minFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq");
-        std::ifstream maxFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_max_freq");
-        std::ifstream curFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
-        
-        std::string minFreq, maxFreq, curFreq;
-        if (minFile) std::getline(minFile, minFreq);
-        if (maxFile) std::getline(maxFile, maxFreq);
-        if (curFile) std::getline(curFile, curFreq);
-        
-        if (!minFreq.empty() && !maxFreq.empty() && !curFreq.empty()) {
-            int min = std::stoi(minFreq) / 1000;
-            int max = std::stoi(maxFreq) / 1000;
-            int cur = std::stoi(curFreq) / 1000;
-            info += std::string(_("CPU: ")) + std::to_string(cur) + _(" MHz (Min: ") + std::to_string(min) + _(" MHz, Max: ") + std::to_string(max) + _(" MHz)\n");
-        }
-    } catch (...) {
+    if (snapshot.limitsValid && snapshot.cpuFreqValid[0]) {
+        info += std::string(_("CPU: ")) + std::to_string(snapshot.cpuFreqKHz[0] / 1000) + _(" MHz (Min: ") + std::to_string(snapshot.minFreqKHz / 1000) + _(" MHz, Max: ") + std::to_string(snapshot.maxFreqKHz / 1000) + _(" MHz)\n");
+    } else {
         info += _("CPU: N/A\n");
     }
     
     // Get governor
-    try {
-        std::ifstream govFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
-        std::string governor;
-        if (govFile) std::getline(govFile, governor);
-        info += std::string(_("Governor: ")) + governor + "\n";
-    } catch (...) {
+    if (snapshot.governorValid) {
+        info += std::string(_("Governor: ")) + snapshot.governor + "\n";
+    } else {
         info += _("Governor: N/A\n");
     }
     
     // Get throttling
-    info += std::string(_("Throttling: ")) + getThrottlingInfo() + "\n";
+    info += std::string(_("Throttling: ")) + getThrottlingInfo(snapshot) + "\n";
     
     // Get temperature
-    try {
-        std::ifstream tempFile("/sys/class/thermal/thermal_zone0/temp");
-        std::string tempStr;
-        if (tempFile) std::getline(tempFile, tempStr);
-        if (!tempStr.empty()) {
-            float temp = std::stof(tempStr) / 1000.0;
-            info += std::string(_("Temperature: ")) + std::to_string(temp) + _(" °C\n");
-        }
-    } catch (...) {
+    if (snapshot.temperatureValid) {
+        float temp = snapshot.temperatureMilliC / 1000.0f;
+        info += std::string(_("Temperature: ")) + std::to_string(temp) + _(" °C\n");
+    } else {
         info += _("Temperature: N/A\n");
     }
     
+    // Time at each clock per applied profile
+    {
+        std::lock_guard<std::mutex> lock(m_pipeline.mutex());
+        info += std::string("\n") + _("=== TIME IN STATE ===\n");
+        if (!m_pipeline.residency().kernelStats()) {
+            info += _("(cpufreq stats unavailable, estimated from samples)\n");
+        }
+        for (const auto& entry : m_pipeline.residency().stats()) {
+            info += ResidencyTracker::format(entry.first, entry.second);
+        }
+    }
+    
+    // What the monitor itself costs
+    info += std::string("\n") + _("=== SELF LATENCY ===\n") + formatLatency();
+    
     // Show dialog with information
     Gtk::MessageDialog dialog(*this, info, false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_OK, true);
     dialog.set_title(_("System Information"));
     dialog.run();
 }
 
-void PiOverclockApp::updateSystemInfo() {
-    // Update temperature
-    try {
-        std::ifstream tempFile("/sys/class/thermal/thermal_zone0/temp");
-        std::string tempStr;
-        if (tempFile) std::getline(tempFile, tempStr);
-        if (!tempStr.empty()) {
-            float temp = std::stof(tempStr) / 1000.0;
-            m_cpuTempLabel.set_label(std::string(_("CPU Temperature: ")) + std::to_string(temp) + _(" °C"));
+void PiOverclockApp::onEventsClicked() {
+    std::vector<ThrottleEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(m_pipeline.mutex());
+        m_pipeline.throttle().query(0, ~0u, m_pipeline.throttle().size(), events);
+    }
+    
+    // Event times are monotonic; show them as local wall clock time
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    int64_t wallOffsetNs = static_cast<int64_t>(real.tv_sec) * 1000000000LL + real.tv_nsec - monotonicNowNs();
+    
+    struct Columns : public Gtk::TreeModelColumnRecord {
+        Gtk::TreeModelColumn<Glib::ustring> time;
+        Gtk::TreeModelColumn<Glib::ustring> flag;
+        Gtk::TreeModelColumn<Glib::ustring> change;
+        Gtk::TreeModelColumn<Glib::ustring> temperature;
+        Gtk::TreeModelColumn<Glib::ustring> cpu;
+        Gtk::TreeModelColumn<Glib::ustring> gpu;
+        Gtk::TreeModelColumn<Glib::ustring> voltage;
+        Columns() { add(time); add(flag); add(change); add(temperature); add(cpu); add(gpu); add(voltage); }
+    } columns;
+    Glib::RefPtr<Gtk::ListStore> store = Gtk::ListStore::create(columns);
+    
+    const char* flagLabels[] = {_("Under-voltage"), _("Frequency capped"), _("Throttled"), _("Soft temperature limit")};
+    const char* changeLabels[] = {_("set"), _("cleared"), _("set and cleared between samples")};
+    
+    // Newest first
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        const ThrottleEvent& event = *it;
+        int64_t wallNs = event.monotonicNs + wallOffsetNs;
+        time_t secs = static_cast<time_t>(wallNs / 1000000000LL);
+        struct tm tmv;
+        localtime_r(&secs, &tmv);
+        char stamp[48];
+        char text[32];
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tmv);
+        snprintf(stamp, sizeof(stamp), "%s.%03lld", text, static_cast<long long>(wallNs / 1000000 % 1000));
+        
+        Gtk::TreeModel::Row row = *store->append();
+        row[columns.time] = stamp;
+        row[columns.flag] = flagLabels[event.flag];
+        row[columns.change] = changeLabels[event.kind];
+        snprintf(text, sizeof(text), "%.1f °C", event.tempMilliC / 1000.0);
+        row[columns.temperature] = event.tempMilliC == kHistoryInvalid ? "-" : text;
+        snprintf(text, sizeof(text), "%d MHz", event.cpuKHz / 1000);
+        row[columns.cpu] = event.cpuKHz == kHistoryInvalid ? "-" : text;
+        snprintf(text, sizeof(text), "%d MHz", event.gpuKHz / 1000);
+        row[columns.gpu] = event.gpuKHz == kHistoryInvalid ? "-" : text;
+        snprintf(text, sizeof(text), "%.4f V", event.coreMicroVolts / 1000000.0);
+        row[columns.voltage] = event.coreMicroVolts == kHistoryInvalid ? "-" : text;
+    }
+    
+    Gtk::TreeView view(store);
+    view.append_column(_("Time"), columns.time);
+    view.append_column(_("Flag"), columns.flag);
+    view.append_column(_("Change"), columns.change);
+    view.append_column(_("Temperature"), columns.temperature);
+    view.append_column(_("CPU"), columns.cpu);
+    view.append_column(_("GPU"), columns.gpu);
+    view.append_column(_("Core Voltage"), columns.voltage);
+    
+    Gtk::ScrolledWindow scroll;
+    scroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+    scroll.set_min_content_height(300);
+    scroll.add(view);
+    
+    Gtk::Label empty(_("No throttle flag has changed since overpi started."));
+    
+    Gtk::Dialog dialog(_("Throttle Events"), *this, true);
+    dialog.set_default_size(760, 400);
+    dialog.get_content_area()->pack_start(events.empty() ? static_cast<Gtk::Widget&>(empty) : static_cast<Gtk::Widget&>(scroll));
+    dialog.add_button(_("Close"), Gtk::RESPONSE_CLOSE);
+    dialog.show_all_children();
+    dialog.run();
+}
+
+void PiOverclockApp::onBenchmarkClicked() {
+    if (m_benchmarkThread.joinable() || m_tuneThread.joinable()) return;
+    
+    std::string selectedProfile = m_profileCombo.get_active_id();
+    if (m_profiles.find(selectedProfile) == m_profiles.end()) return;
+    
+    if (!showQuestionDialog(_("Benchmark"), 
+        std::string(_("Profile '%s' will be applied hot and all cores will be loaded for about 10 seconds.\n\n"
+        "Do you want to continue?")).replace(std::string(_("Profile '%s' will be applied hot")).find("%s"), 2, m_profiles[selectedProfile].name))) {
+        return;
+    }
+    
+    applyHotProfile(selectedProfile, false);
+    
+    m_benchmarkProfile = selectedProfile;
+    setWorkersSensitive(false);
+    m_statusLabel.set_label(std::string(_("Running benchmark: ")) + m_profiles[selectedProfile].name);
+    
+    m_benchmark.reset(new Benchmark());
+    m_benchmarkThread = std::thread([this]() {
+        m_benchmarkResult = m_benchmark->run();
+        m_benchmarkDone.emit();
+    });
+}
+
+void PiOverclockApp::onBenchmarkDone() {
+    if (m_benchmarkThread.joinable()) {
+        m_benchmarkThread.join();
+    }
+    m_benchmark.reset();
+    setWorkersSensitive(true);
+    showCurrentProfile();
+    
+    // The profile may have been removed from the profile file meanwhile
+    const BenchmarkResult& result = m_benchmarkResult;
+    auto profile = m_profiles.find(m_benchmarkProfile);
+    if (!result.valid || profile == m_profiles.end()) return;
+    profile->second.benchmark = result;
+    
+    std::string message = std::string(_("Profile: ")) + profile->second.name + "\n\n" + Benchmark::format(result);
+    message += std::string(_("Throttling: ")) + decodeThrottling(result.throttleBits) + "\n\n";
+    if (!result.verified()) {
+        message += _("⚠️ Wrong results detected: this profile is NOT stable.\n\n");
+    }
+    message += formatBenchmarks();
+    
+    showMessageDialog(_("Benchmark Results"), message, result.verified() ? Gtk::MESSAGE_INFO : Gtk::MESSAGE_WARNING);
+}
+
+std::string PiOverclockApp::formatBenchmarks() {
+    std::string text = _("=== PROFILE COMPARISON ===\n");
+    
+    for (const ProfileConfig* profile : sortedProfiles(m_profiles)) {
+        const BenchmarkResult& result = profile->benchmark;
+        if (!result.valid) continue;
+        
+        char value[96];
+        text += profile->name + ":";
+        for (const auto& kernel : result.kernels) {
+            snprintf(value, sizeof(value), " %s %.0f", kernel.name.c_str(), kernel.score);
+            text += value;
         }
-    } catch (...) {
+        snprintf(value, sizeof(value), ", %ld MHz, %.1f °C", result.avgFreqKHz / 1000, result.peakTempMilliC / 1000.0);
+        text += value;
+        if (!result.verified()) text += _(", UNSTABLE");
+        text += "\n";
+    }
+    return text;
+}
+
+void PiOverclockApp::setWorkersSensitive(bool sensitive) {
+    m_benchmarkBtn.set_sensitive(sensitive);
+    m_tuneBtn.set_sensitive(sensitive);
+    m_applyHotBtn.set_sensitive(sensitive);
+}
+
+void PiOverclockApp::onTuneClicked() {
+    if (m_benchmarkThread.joinable() || m_tuneThread.joinable()) return;
+    
+    std::string selectedProfile = m_profileCombo.get_active_id();
+    if (m_profiles.find(selectedProfile) == m_profiles.end()) return;
+    
+    if (!showQuestionDialog(_("Auto Tune"), 
+        _("Every CPU clock up to the current firmware limit will be tested under full load.\n\n"
+        "• This takes a few minutes\n"
+        "• The temperature limit of the selected profile is enforced\n"
+        "• Clocks above arm_freq in config.txt cannot be tested until applied permanently\n\n"
+        "Do you want to continue?"))) {
+        return;
+    }
+    
+    // The governor would fight the pinned candidate clocks
+    if (m_governorCheck.get_active()) {
+        m_governorCheck.set_active(false);
+    }
+    
+    TunerConfig config;
+    config.tempLimitMilliC = m_profiles[selectedProfile].tempLimitMilliC;
+    
+    m_tuneBaseProfile = selectedProfile;
+    setWorkersSensitive(false);
+    m_statusLabel.set_label(_("Auto-tuning, please wait..."));
+    
+    m_tuner.reset(new AutoTuner(config));
+    m_tuneThread = std::thread([this]() {
+        m_tuneResult = m_tuner->run();
+        m_tuneDone.emit();
+    });
+}
+
+void PiOverclockApp::onTuneDone() {
+    if (m_tuneThread.joinable()) {
+        m_tuneThread.join();
+    }
+    m_tuner.reset();
+    setWorkersSensitive(true);
+    showCurrentProfile();
+    requestUpdate();
+    
+    std::string report;
+    for (const auto& candidate : m_tuneResult.candidates) {
+        report += std::to_string(candidate.freqKHz / 1000) + _(" MHz: ");
+        report += candidate.stable ? std::string(_("stable")) : candidate.reason;
+        report += "\n";
+    }
+    
+    if (!m_tuneResult.found) {
+        showMessageDialog(_("Auto Tune"), std::string(_("No stable clock was found.\n\n")) + report, Gtk::MESSAGE_WARNING);
+        return;
+    }
+    
+    // Store the winner as its own profile
+    ProfileConfig tuned = makeTunedProfile(m_tuneResult.freqKHz, m_tuneBaseProfile);
+    tuned.benchmark = m_tuneResult.best;
+    if (m_profiles.find(tuned.id) == m_profiles.end()) {
+        m_profileCombo.append(tuned.id, tuned.name);
+    }
+    m_profiles[tuned.id] = tuned;
+    m_profileCombo.set_active_id(tuned.id);
+    onProfileChanged();
+    
+    showMessageDialog(_("Auto Tune"), std::string(_("Fastest stable clock: ")) + std::to_string(tuned.armFreqMHz) + _(" MHz") + "\n\n" + report, Gtk::MESSAGE_INFO);
+}
+
+ProfileConfig PiOverclockApp::makeTunedProfile(long freqKHz, const std::string& baseProfile) {
+    long mhz = freqKHz / 1000;
+    
+    // GPU clock and overvoltage of the fastest built-in profile the winner reaches;
+    // they can only change at boot, so they are not part of the search
+    ProfileConfig tuned = builtinProfiles()["minimum"];
+    long reached = 0;
+    for (const auto& entry : m_profiles) {
+        long arm = entry.second.armFreqMHz;
+        if (entry.first != "tuned" && arm <= mhz && arm > reached) {
+            reached = arm;
+            tuned = entry.second;
+        }
+    }
+    
+    tuned.id = "tuned";
+    tuned.name = _("Tuned");
+    tuned.order = 1000;
+    tuned.armFreqMHz = mhz;
+    const ProfileConfig* base = findProfile(m_profiles, baseProfile);
+    if (base) tuned.tempLimitMilliC = base->tempLimitMilliC;
+    tuned.color = "#8e44ad";
+    
+    std::string desc = _("Found by auto-tune on this board\n- CPU: %s MHz\n- GPU: %s MHz\n- Overvoltage: %s\n- Force Turbo: %s");
+    std::string values[] = {std::to_string(tuned.armFreqMHz), std::to_string(tuned.gpuFreqMHz),
+                            std::to_string(tuned.overVoltage), tuned.forceTurbo ? "1" : "0"};
+    for (const std::string& value : values) {
+        size_t pos = desc.find("%s");
+        if (pos != std::string::npos) desc.replace(pos, 2, value);
+    }
+    tuned.desc = desc;
+    return tuned;
+}
+
+std::string PiOverclockApp::profileName(const std::string& profileId) const {
+    auto it = m_profiles.find(profileId);
+    return it != m_profiles.end() ? it->second.name : profileId;
+}
+
+void PiOverclockApp::onSnapshotReady() {
+    // Several emits may coalesce; only the newest snapshot is rendered
+    if (m_snapshots.update()) {
+        renderSnapshot(m_snapshots.front());
+        m_chart.refresh();
+        followWorkload(m_snapshots.front());
+    }
+}
+
+void PiOverclockApp::requestUpdate() {
+    m_pipeline.scheduler().wake();
+}
+
+void PiOverclockApp::showCurrentProfile() {
+    m_statusLabel.set_label(std::string(_("Current profile: ")) + (m_currentProfile.empty() ? _("N/A") : profileName(m_currentProfile)));
+}
+
+void PiOverclockApp::renderSnapshot(const SystemSnapshot& snapshot) {
+    ScopedLatency latency(PROBE_RENDER);
+    
+    // Update temperature
+    if (snapshot.temperatureValid) {
+        float temp = snapshot.temperatureMilliC / 1000.0f;
+        m_cpuTempLabel.set_label(std::string(_("CPU Temperature: ")) + std::to_string(temp) + _(" °C"));
+    } else {
         m_cpuTempLabel.set_label(_("CPU Temperature: N/A"));
     }
     
     // Update CPU frequency
-    try {
-        std::ifstream freqFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
-        std::string freqStr;
-        if (freqFile) std::getline(freqFile, freqStr);
-        if (!freqStr.empty()) {
-            int freq = std::stoi(freqStr) / 1000;
-            m_cpuFreqLabel.set_label(std::string(_("CPU Frequency: ")) + std::to_string(freq) + _(" MHz"));
-        }
-    } catch (...) {
+    if (snapshot.cpuFreqValid[0]) {
+        m_cpuFreqLabel.set_label(std::string(_("CPU Frequency: ")) + std::to_string(snapshot.cpuFreqKHz[0] / 1000) + _(" MHz"));
+    } else {
         m_cpuFreqLabel.set_label(_("CPU Frequency: N/A"));
     }
     
-    // Update GPU frequency
-    std::string gpuFreq = execCommand("vcgencmd measure_clock v3d");
-    if (!gpuFreq.empty() && gpuFreq.find("=") != std::string::npos) {
-        try {
-            std::string freqStr = gpuFreq.substr(gpuFreq.find("=") + 1);
-            int freq = std::stoi(freqStr) / 1000000;
-            m_gpuFreqLabel.set_label(std::string(_("GPU Frequency: ")) + std::to_string(freq) + _(" MHz"));
-        } catch (...) {
-            m_gpuFreqLabel.set_label(_("GPU Frequency: N/A"));
+    // Update delivered clock: mean over the cores that were busy
+    long effSum = 0;
+    int effCount = 0;
+    long ipcSum = 0;
+    int ipcCount = 0;
+    for (int cpu = 0; cpu < snapshot.cpuCount; cpu++) {
+        if (snapshot.perf[cpu].clockValid) {
+            effSum += snapshot.perf[cpu].effectiveKHz;
+            effCount++;
         }
+        if (snapshot.perf[cpu].ipcValid) {
+            ipcSum += snapshot.perf[cpu].ipcMilli;
+            ipcCount++;
+        }
+    }
+    if (effCount > 0) {
+        char text[96];
+        if (ipcCount > 0) {
+            snprintf(text, sizeof(text), "%ld MHz, IPC %.2f", effSum / effCount / 1000, ipcSum / ipcCount / 1000.0);
+        } else {
+            snprintf(text, sizeof(text), "~%ld MHz", effSum / effCount / 1000);
+        }
+        std::string label = std::string(_("Delivered Clock: ")) + text;
+        if (snapshot.perfMode == PerfSampler::MODE_TASK_CLOCK) label += _(" (estimated, no PMU)");
+        m_cpuEffLabel.set_label(label);
+    } else {
+        m_cpuEffLabel.set_label(_("Delivered Clock: N/A"));
+    }
+    
+    const VcReading& reading = snapshot.firmware;
+    bool firmwareOk = snapshot.firmwareValid;
+    
+    // Update GPU frequency
+    if (firmwareOk && reading.clockValid[VC_DOMAIN_V3D]) {
+        m_gpuFreqLabel.set_label(std::string(_("GPU Frequency: ")) + std::to_string(reading.clockHz[VC_DOMAIN_V3D] / 1000000) + _(" MHz"));
     } else {
         m_gpuFreqLabel.set_label(_("GPU Frequency: N/A"));
     }
     
+    // Update core voltage with its lowest point over the last minute, so
+    // sag under load stays visible between samples
+    if (firmwareOk && reading.voltsValid[VC_RAIL_CORE]) {
+        int32_t low = kHistoryInvalid;
+        {
+            std::lock_guard<std::mutex> lock(m_pipeline.mutex());
+            const HistoryRollup& seconds = m_history.rollup(HistoryBuffer::TIER_1S);
+            for (size_t i = seconds.size() > 60 ? seconds.size() - 60 : 0; i < seconds.size(); i++) {
+                int32_t v = seconds.min(HISTORY_CORE_VOLTAGE, i);
+                if (v != kHistoryInvalid && (low == kHistoryInvalid || v < low)) low = v;
+            }
+        }
+        char volts[32];
+        snprintf(volts, sizeof(volts), "%.4f V", reading.microVolts[VC_RAIL_CORE] / 1000000.0);
+        std::string label = std::string(_("Core Voltage: ")) + volts;
+        if (low != kHistoryInvalid && static_cast<uint32_t>(low) < reading.microVolts[VC_RAIL_CORE]) {
+            snprintf(volts, sizeof(volts), "%.4f V", low / 1000000.0);
+            label += std::string(_(", 1 min low ")) + volts;
+        }
+        m_coreVoltLabel.set_label(label);
+    } else {
+        m_coreVoltLabel.set_label(_("Core Voltage: N/A"));
+    }
+    
+    // Every clock domain; an arrow marks the ones that moved since the last sample
+    std::string clocks;
+    for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+        if (!firmwareOk || !reading.clockValid[domain]) continue;
+        uint32_t mhz = reading.clockHz[domain] / 1000000;
+        uint32_t before = m_lastClockHz[domain] / 1000000;
+        char text[48];
+        snprintf(text, sizeof(text), "%s%s %u%s", clocks.empty() ? "" : ", ", vcDomainName(domain), mhz,
+                 m_lastClockHz[domain] == 0 || mhz == before ? "" : mhz > before ? " ↑" : " ↓");
+        clocks += text;
+        m_lastClockHz[domain] = reading.clockHz[domain];
+    }
+    m_clocksLabel.set_label(std::string(_("Clocks (MHz): ")) + (clocks.empty() ? _("N/A") : clocks));
+    
+    std::string rails;
+    for (int rail = VC_RAIL_SDRAM_C; rail < VC_RAIL_COUNT; rail++) {
+        if (!firmwareOk || !reading.voltsValid[rail]) continue;
+        char text[48];
+        snprintf(text, sizeof(text), "%s%s %.4f V", rails.empty() ? "" : ", ", vcRailName(rail), reading.microVolts[rail] / 1000000.0);
+        rails += text;
+    }
+    m_railsLabel.set_label(std::string(_("SDRAM Voltages: ")) + (rails.empty() ? _("N/A") : rails));
+    
     // Update governor
-    try {
-        std::ifstream govFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
-        std::string governor;
-        if (govFile) std::getline(govFile, governor);
-        m_cpuGovLabel.set_label(std::string(_("CPU Governor: ")) + governor);
-    } catch (...) {
+    if (snapshot.governorValid) {
+        m_cpuGovLabel.set_label(std::string(_("CPU Governor: ")) + snapshot.governor);
+    } else {
         m_cpuGovLabel.set_label(_("CPU Governor: N/A"));
     }
     
+    // Update thermal governor state
+    if (snapshot.governorEngaged) {
+        m_thermalGovLabel.set_label(std::string(_("Thermal Governor: ceiling ")) + std::to_string(snapshot.governorCeilingKHz / 1000) + _(" MHz"));
+    } else if (m_governorCheck.get_active()) {
+        m_thermalGovLabel.set_label(_("Thermal Governor: unavailable"));
+    } else {
+        m_thermalGovLabel.set_label(_("Thermal Governor: off"));
+    }
+    
     // Update throttling information
-    std::string throttlingInfo = getThrottlingInfo();
-    m_throttlingStatusLabel.set_label(std::string(_("Status: ")) + throttlingInfo);
-    m_throttlingDetailsLabel.set_label(std::string(_("Details: ")) + decodeThrottling(execCommand("vcgencmd get_throttled")));
+    if (firmwareOk && reading.throttledValid) {
+        char hex[16];
+        snprintf(hex, sizeof(hex), "0x%x", reading.throttled);
+        m_throttlingStatusLabel.set_label(std::string(_("Status: ")) + decodeThrottling(reading.throttled));
+        m_throttlingDetailsLabel.set_label(std::string(_("Details: ")) + _("Hexadecimal value: ") + hex);
+    } else {
+        m_throttlingStatusLabel.set_label(std::string(_("Status: ")) + _("Error getting throttling"));
+        m_throttlingDetailsLabel.set_label(std::string(_("Details: ")) + _("N/A"));
+    }
 }
 
-void PiOverclockApp::applyHotProfile(const std::string& profileName, bool showMessage) {
-    if (m_profiles.find(profileName) == m_profiles.end()) return;
+void PiOverclockApp::applyHotProfile(const std::string& profileId, bool showMessage) {
+    if (m_profiles.find(profileId) == m_profiles.end()) return;
 
-    ProfileConfig settings = m_profiles[profileName];
+    ProfileConfig settings = m_profiles[profileId];
 
     try {
-        // Change governor to performance
-        std::string cmdGov = "cpufreq-set -g performance";
-        int retGov = system(cmdGov.c_str());
-        if (retGov != 0) {
-            showMessageDialog(_("Error"), _("Could not change governor to performance.\nMake sure 'cpufrequtils' is installed and you have root permissions."), Gtk::MESSAGE_ERROR);
-            return;
-        }
-
-        // Change minimum and maximum frequencies
-        std::string cmdFreq = "cpufreq-set -d " + settings.arm_freq + "MHz -u " + settings.arm_freq + "MHz";
-        int retFreq = system(cmdFreq.c_str());
-        if (retFreq != 0) {
-            showMessageDialog(_("Error"), _("Could not adjust CPU frequency.\nMake sure 'cpufrequtils' is installed and you have root permissions."), Gtk::MESSAGE_ERROR);
+        std::string error;
+        if (!m_pipeline.applyProfile(settings, error)) {
+            showMessageDialog(_("Error"), error, Gtk::MESSAGE_ERROR);
             return;
         }
 
         // Update interface status
-        m_currentProfile = profileName;
-        m_statusLabel.set_label(std::string(_("Current profile: ")) + profileName + _(" (Hot applied)"));
+        m_currentProfile = profileId;
+        m_statusLabel.set_label(std::string(_("Current profile: ")) + settings.name + _(" (Hot applied)"));
 
         if (showMessage) {
             std::string message = std::string(_("Profile %s partially applied hot.\n\n"
                 "✅ CPU frequency adjusted correctly\n"
                 "⚠️ Overvoltage and GPU not applied (require reboot)\n"
                 "⚠️ Changes will be lost on reboot")).replace(
-                std::string(_("Profile %s partially applied hot.")).find("%s"), 2, profileName);
+                std::string(_("Profile %s partially applied hot.")).find("%s"), 2, settings.name);
             
             showMessageDialog(_("Partial Success"), message, Gtk::MESSAGE_INFO);
         }
 
-        // Update metrics
-        updateSystemInfo();
+        // Refresh metrics without waiting for the next tick
+        requestUpdate();
 
     } catch (const std::exception& e) {
         showMessageDialog(_("Error"), std::string(_("An error occurred while applying the profile: ")) + e.what(), Gtk::MESSAGE_ERROR);
     }
 }
 
-void PiOverclockApp::applyPermanentProfile(const std::string& profileName) {
-    if (m_profiles.find(profileName) == m_profiles.end()) return;
+void PiOverclockApp::applyPermanentProfile(const std::string& profileId) {
+    if (m_profiles.find(profileId) == m_profiles.end()) return;
     
-    ProfileConfig settings = m_profiles[profileName];
-    std::string configFile = "/boot/firmware/config.txt";
-    std::string backupFile = "/boot/firmware/config.txt.bak";
+    ProfileConfig settings = m_profiles[profileId];
     
-    try {
-        // Read current configuration
-        std::vector<std::string> lines;
-        if (fileExists(configFile)) {
-            std::ifstream inFile(configFile);
-            std::string line;
-            while (std::getline(inFile, line)) {
-                lines.push_back(line);
-            }
-            inFile.close();
-        }
-        
-        // Create backup if it doesn't exist
-        if (!fileExists(backupFile)) {
-            std::ofstream outFile(backupFile);
-            for (const auto& line : lines) {
-                outFile << line << std::endl;
-            }
-            outFile.close();
-        }
-        
-        // Remove existing configurations
-        std::vector<std::string> newLines;
-        std::vector<std::string> settingsToRemove = {"arm_freq", "gpu_freq", "over_voltage", "force_turbo"};
-        
-        for (const auto& line : lines) {
-            bool keepLine = true;
-            for (const auto& setting : settingsToRemove) {
-                if (line.find(setting + "=") == 0) {
-                    keepLine = false;
-                    break;
-                }
-            }
-            if (keepLine) {
-                newLines.push_back(line);
-            }
-        }
-        
-        // Add new configurations
-        newLines.push_back("arm_freq=" + settings.arm_freq);
-        newLines.push_back("gpu_freq=" + settings.gpu_freq);
-        newLines.push_back("over_voltage=" + settings.over_voltage);
-        newLines.push_back("force_turbo=" + settings.force_turbo);
-        
-        // Save temporary changes
-        std::ofstream tmpFile("/tmp/config.txt.tmp");
-        for (const auto& line : newLines) {
-            tmpFile << line << std::endl;
-        }
-        tmpFile.close();
-        
-        // Replace configuration file
-        system("sudo mv /tmp/config.txt.tmp /boot/firmware/config.txt");
-        system("sudo chown root:root /boot/firmware/config.txt");
-        system("sudo chmod 644 /boot/firmware/config.txt");
-        
-        std::string message = std::string(_("Profile %s applied permanently.\n\n"
+    bool changed = false;
+    std::string error;
+    if (!applyProfilePermanent(settings, m_store.boardFilters(), changed, error)) {
+        showMessageDialog(_("Error"), error, Gtk::MESSAGE_ERROR);
+        return;
+    }
+    
+    std::string message;
+    if (changed) {
+        message = _("Profile %s applied permanently.\n\n"
             "All settings (CPU, GPU, Overvoltage) have been saved.\n"
             "Backup saved at: %s\n\n"
-            "Do you want to reboot now to apply all changes?"));
-        
-        // Replace placeholders
-        size_t pos = message.find("%s");
-        if (pos != std::string::npos) message.replace(pos, 2, profileName);
-        
-        pos = message.find("%s");
-        if (pos != std::string::npos) message.replace(pos, 2, backupFile);
-        
-        if (showQuestionDialog(_("Success"), message)) {
-            system("sudo reboot");
-        }
-        
-    } catch (const std::exception& e) {
-        showMessageDialog(_("Error"), std::string(_("Could not modify config.txt: ")) + e.what(), Gtk::MESSAGE_ERROR);
-    }
-}
-
-std::string PiOverclockApp::getThrottlingInfo() {
-    std::string result = execCommand("vcgencmd get_throttled");
-    if (result.empty() || result.find("=") == std::string::npos) {
-        return _("Error getting throttling");
+            "Do you want to reboot now to apply all changes?");
+    } else {
+        message = _("config.txt already holds profile %s; nothing was written.\n"
+            "Backup at: %s\n\n"
+            "Do you want to reboot now to apply it?");
     }
     
-    std::string throttledHex = result.substr(result.find("=") + 1);
-    return decodeThrottling(throttledHex);
-}
-
-std::string PiOverclockApp::decodeThrottling(const std::string& throttledHex) {
-    try {
-        unsigned long throttledCode = std::stoul(throttledHex, nullptr, 16);
-        std::vector<std::string> messages;
-        
-        // Current bits
-        if (throttledCode & 0x1) messages.push_back(_("Under-voltage now"));
-        if (throttledCode & 0x2) messages.push_back(_("Frequency capped now"));
-        if (throttledCode & 0x4) messages.push_back(_("Throttling now"));
-        if (throttledCode & 0x8) messages.push_back(_("Temperature limit now"));
-        
-        // Historical bits
-        if (throttledCode & 0x10000) messages.push_back(_("Under-voltage occurred"));
-        if (throttledCode & 0x20000) messages.push_back(_("Frequency capped occurred"));
-        if (throttledCode & 0x40000) messages.push_back(_("Throttling occurred"));
-        if (throttledCode & 0x80000) messages.push_back(_("Temperature limit occurred"));
-        
-        if (messages.empty()) {
-            return _("No throttling");
-        }
-        
-        std::string result;
-        for (size_t i = 0; i < messages.size(); i++) {
-            if (i > 0) result += ", ";
-            result += messages[i];
-        }
-        return result;
-    } catch (...) {
-        return std::string(_("Hexadecimal value: ")) + throttledHex;
+    // Replace placeholders
+    size_t pos = message.find("%s");
+    if (pos != std::string::npos) message.replace(pos, 2, settings.name);
+    
+    pos = message.find("%s");
+    if (pos != std::string::npos) message.replace(pos, 2, kBootConfigBackupPath);
+    
+    if (showQuestionDialog(_("Success"), message)) {
+        system("sudo reboot");
     }
 }
 
-std::string PiOverclockApp::execCommand(const std::string& cmd) {
-    char buffer[128];
-    std::string result;
-
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-    if (!pipe) {
-        return "";
-    }
-
-    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-        result += buffer;
+std::string PiOverclockApp::getThrottlingInfo(const SystemSnapshot& snapshot) {
+    if (!snapshot.firmwareValid || !snapshot.firmware.throttledValid) {
+        return _("Error getting throttling");
     }
-
-    return result;
+    
+    return decodeThrottling(snapshot.firmware.throttled);
 }
 
 bool PiOverclockApp::fileExists(const std::string& filename) {
@@ -621,6 +1042,65 @@ bool PiOverclockApp::showQuestionDialog(const std::string& title, const std::str
     return (result == Gtk::RESPONSE_YES);
 }
 
+// Calls cancel on SIGINT or SIGTERM while a command-line run blocks the main
+// thread, so the run still gets to undo its cpufreq changes. Construct it
+// before the run starts any thread; threads inherit the blocked mask.
+class SignalCancel {
+public:
+    explicit SignalCancel(const std::function<void()>& cancel)
+    : m_signalFd(-1), m_stopFd(-1), m_interrupted(false) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigprocmask(SIG_BLOCK, &mask, &m_savedMask);
+        m_signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        m_stopFd = eventfd(0, EFD_CLOEXEC);
+        if (m_signalFd < 0 || m_stopFd < 0) return;
+        
+        m_thread = std::thread([this, cancel]() {
+            struct pollfd fds[2] = {{m_signalFd, POLLIN, 0}, {m_stopFd, POLLIN, 0}};
+            for (;;) {
+                if (poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR) continue;
+                    return;
+                }
+                if (fds[1].revents) return;
+                struct signalfd_siginfo info;
+                bool caught = false;
+                while (read(m_signalFd, &info, sizeof(info)) > 0) caught = true;
+                if (caught) {
+                    m_interrupted = true;
+                    cancel();
+                }
+            }
+        });
+    }
+    
+    ~SignalCancel() {
+        if (m_thread.joinable()) {
+            uint64_t one = 1;
+            if (write(m_stopFd, &one, sizeof(one)) == sizeof(one)) m_thread.join();
+            else m_thread.detach();
+        }
+        if (m_signalFd >= 0) close(m_signalFd);
+        if (m_stopFd >= 0) close(m_stopFd);
+        sigprocmask(SIG_SETMASK, &m_savedMask, nullptr);
+    }
+    
+    bool interrupted() const { return m_interrupted; }
+    
+private:
+    SignalCancel(const SignalCancel&) = delete;
+    SignalCancel& operator=(const SignalCancel&) = delete;
+    
+    int m_signalFd;
+    int m_stopFd;
+    sigset_t m_savedMask;
+    std::atomic<bool> m_interrupted;
+    std::thread m_thread;
+};
+
 int main(int argc, char *argv[]) {
     // Set up internationalization
     setlocale(LC_ALL, "");
@@ -633,13 +1113,162 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // Benchmark the current settings from the command line
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) != "--benchmark") continue;
+        
+        double seconds = 3.0;
+        for (int j = 1; j + 1 < argc; j++) {
+            if (std::string(argv[j]) == "--seconds") seconds = strtod(argv[j + 1], nullptr);
+        }
+        Benchmark benchmark(seconds > 0 ? seconds : 3.0);
+        BenchmarkResult result = benchmark.run();
+        std::cout << Benchmark::format(result);
+        return result.verified() ? 0 : 2;
+    }
+    
+    // Search for the fastest stable clock from the command line
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) != "--tune") continue;
+        
+        if (geteuid() != 0) {
+            std::cerr << _("Error: Run with: sudo ") << argv[0] << std::endl;
+            return 1;
+        }
+        AutoTuner tuner;
+        TuneResult result;
+        bool interrupted;
+        {
+            SignalCancel signals([&tuner]() { tuner.cancel(); });
+            result = tuner.run([](const TuneCandidate& candidate) {
+                std::cout << candidate.freqKHz / 1000 << " MHz: " << (candidate.stable ? "stable" : candidate.reason) << std::endl;
+            });
+            interrupted = signals.interrupted();
+        }
+        if (interrupted) {
+            std::cerr << _("Interrupted; the governor and clock limits were restored.") << std::endl;
+            return 130;
+        }
+        if (!result.found) {
+            std::cerr << _("No stable clock was found.") << std::endl;
+            return 2;
+        }
+        std::cout << "arm_freq=" << result.freqKHz / 1000 << std::endl << Benchmark::format(result.best);
+        return 0;
+    }
+    
+    // A/B comparison of profiles on a workload from the command line:
+    // --compare high,moderate [--trials N] [--seed N] -- program [args ...]
+    // The workload's arguments are passed as given, without a shell; use
+    // "-- sh -c '...'" for pipelines or &&.
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) != "--compare" || i + 1 >= argc) continue;
+        
+        if (geteuid() != 0) {
+            std::cerr << _("Error: Run with: sudo ") << argv[0] << std::endl;
+            return 1;
+        }
+        CompareConfig config;
+        std::stringstream list(argv[i + 1]);
+        std::string profile;
+        while (std::getline(list, profile, ',')) {
+            if (!profile.empty()) config.profiles.push_back(profile);
+        }
+        for (int j = 1; j < argc; j++) {
+            std::string arg = argv[j];
+            if (arg == "--") {
+                config.command.assign(argv + j + 1, argv + argc);
+                break;
+            }
+            if (j + 1 >= argc) break;
+            if (arg == "--trials") config.trials = atoi(argv[j + 1]);
+            else if (arg == "--cooldown-margin") config.cooldownMarginMilliC = static_cast<long>(strtod(argv[j + 1], nullptr) * 1000);
+            else if (arg == "--cooldown-max") config.cooldownMaxSeconds = strtod(argv[j + 1], nullptr);
+            else if (arg == "--seed") config.seed = static_cast<unsigned>(strtoul(argv[j + 1], nullptr, 10));
+        }
+        
+        ProfileStore store;
+        store.load();
+        for (const auto& error : store.errors()) std::cerr << error << std::endl;
+        ProfileComparison comparison(store.profiles(), config);
+        std::vector<CompareTrial> trials;
+        std::string error;
+        bool ok;
+        bool interrupted;
+        {
+            SignalCancel signals([&comparison]() { comparison.cancel(); });
+            ok = comparison.run(trials, error, [](const CompareTrial& trial) {
+                char line[160];
+                snprintf(line, sizeof(line), "round %d %-10s %8.2f s %5ld MHz %5.1f °C peak, exit %d\n",
+                         trial.round + 1, trial.profileId.c_str(), trial.wallSeconds,
+                         trial.meanClockKHz / 1000, trial.peakTempMilliC / 1000.0, trial.exitStatus);
+                std::cout << line << std::flush;
+            });
+            interrupted = signals.interrupted();
+        }
+        if (!ok) {
+            std::cerr << _("Comparison failed: ") << error << std::endl;
+            return 1;
+        }
+        std::cout << std::endl << comparison.report(trials);
+        if (interrupted) {
+            std::cerr << _("Interrupted; the report covers the finished trials only.") << std::endl;
+            return 130;
+        }
+        for (const auto& trial : trials) {
+            if (!trial.ok) return 2;
+        }
+        return 0;
+    }
+    
     // Check superuser permissions
     if (geteuid() != 0) {
         std::cerr << _("Error: Run with: sudo ") << argv[0] << std::endl;
         return 1;
     }
     
-    auto app = Gtk::Application::create(argc, argv, "org.rpi.overclock");
-    PiOverclockApp window;
+    // Consume our own options; the rest is left to GTK
+    AppOptions options;
+    DaemonOptions daemonOptions;
+    bool headless = false;
+    std::vector<char*> gtkArgs;
+    gtkArgs.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            options.metricsPort = atoi(argv[++i]);
+            daemonOptions.metricsPort = options.metricsPort;
+        } else if (arg == "--fleet-port" && i + 1 < argc) {
+            daemonOptions.fleetPort = atoi(argv[++i]);
+        } else if (arg == "--auto") {
+            options.autoProfile = true;
+            daemonOptions.autoProfile = true;
+        } else if (arg == "--auto-jobs" && i + 1 < argc) {
+            options.workload.setJobNames(argv[++i]);
+            daemonOptions.workload = options.workload;
+        } else if (arg == "--daemon") {
+            headless = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            daemonOptions.socketPath = argv[++i];
+        } else {
+            gtkArgs.push_back(argv[i]);
+        }
+    }
+    
+    // Headless mode never touches GTK or the display
+    if (headless) {
+        daemonOptions.recordPath = options.recordPath;
+        OverpiDaemon service(daemonOptions);
+        return service.run();
+    }
+    
+    int gtkArgc = static_cast<int>(gtkArgs.size());
+    gtkArgs.push_back(nullptr);
+    char** gtkArgv = gtkArgs.data();
+    
+    auto app = Gtk::Application::create(gtkArgc, gtkArgv, "org.rpi.overclock");
+    PiOverclockApp window(options);
     return app->run(window);
 }
\ No newline at end of file
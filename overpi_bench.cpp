@@ -0,0 +1,289 @@
+// Microbenchmarks for the sampling, parsing, apply and config paths.
+// Runs on any Linux box: the sysfs tree, config.txt and vcgencmd are fakes
+// generated in a temporary directory. Reports ns/op and heap allocations/op.
+//
+//   overpi-bench [seconds per case] [name filter]
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "config_txt.h"
+#include "cpufreq_backend.h"
+#include "file_tree.h"
+#include "history_buffer.h"
+#include "overpi_core.h"
+#include "residency_tracker.h"
+#include "sensor_sampler.h"
+#include "snapshot_collector.h"
+
+namespace {
+std::atomic<uint64_t> g_allocations(0);
+}
+
+// Count every heap allocation in the process
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+const int kCpus = 4;
+
+// The fake board is a Pi 400
+const std::set<std::string> kBoardFilters = {"pi4", "pi400"};
+
+const char* const kConfigTxt =
+    "# For more options and information see\n"
+    "# http://rptl.io/configtxt\n"
+    "dtparam=audio=on\n"
+    "camera_auto_detect=1\n"
+    "display_auto_detect=1\n"
+    "auto_initramfs=1\n"
+    "dtoverlay=vc4-kms-v3d\n"
+    "max_framebuffers=2\n"
+    "disable_fw_kms_setup=1\n"
+    "arm_64bit=1\n"
+    "disable_overscan=1\n"
+    "arm_boost=1\n"
+    "\n"
+    "[cm4]\n"
+    "otg_mode=1\n"
+    "\n"
+    "[pi4]\n"
+    "arm_freq=1800\n"
+    "\n"
+    "[all]\n"
+    "over_voltage=2\n";
+
+const char* const kVcgencmdBatch =
+    "clock arm frequency(48)=1800404352\n"
+    "clock core frequency(1)=500000992\n"
+    "clock v3d frequency(46)=500000992\n"
+    "clock h264 frequency(28)=0\n"
+    "clock isp frequency(45)=0\n"
+    "clock emmc frequency(50)=250000000\n"
+    "clock sdram error=2 error_msg=\"Invalid arguments\"\n"
+    "throttled throttled=0x50000\n"
+    "volts core volt=0.8500V\n"
+    "volts sdram_c volt=1.1000V\n"
+    "volts sdram_i volt=1.1000V\n"
+    "volts sdram_p volt=1.1000V\n";
+
+bool writeFile(const std::string& path, const std::string& content, mode_t mode = 0644) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fputs(content.c_str(), f);
+    fclose(f);
+    return chmod(path.c_str(), mode) == 0;
+}
+
+// A Pi 4 shaped sysfs tree, a config.txt and a vcgencmd on PATH
+bool makeFakeSystem(const std::string& root) {
+    makeDirs(root + "/sys/class/thermal/thermal_zone0");
+    if (!writeFile(root + "/sys/class/thermal/thermal_zone0/temp", "52095\n")) return false;
+
+    const char* opps = "600000 700000 800000 900000 1000000 1100000 1200000 1300000 1400000 1500000 1600000 1700000 1800000\n";
+    std::string policy = root + "/sys/devices/system/cpu/cpufreq/policy0";
+    makeDirs(policy + "/stats");
+    writeFile(policy + "/scaling_available_frequencies", opps);
+    writeFile(policy + "/scaling_governor", "ondemand\n");
+    writeFile(policy + "/scaling_min_freq", "600000\n");
+    writeFile(policy + "/scaling_max_freq", "1800000\n");
+    writeFile(policy + "/cpuinfo_min_freq", "600000\n");
+    writeFile(policy + "/cpuinfo_max_freq", "1800000\n");
+    writeFile(policy + "/stats/time_in_state", "600000 81234\n1000000 2311\n1500000 912\n1800000 15440\n");
+
+    for (int cpu = 0; cpu < kCpus; cpu++) {
+        std::string dir = root + "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq";
+        makeDirs(dir);
+        writeFile(dir + "/scaling_cur_freq", "1500000\n");
+        writeFile(dir + "/scaling_min_freq", "600000\n");
+        writeFile(dir + "/scaling_max_freq", "1800000\n");
+        writeFile(dir + "/scaling_governor", "ondemand\n");
+    }
+
+    makeDirs(root + "/boot");
+    writeFile(root + "/boot/config.txt", kConfigTxt);
+
+    // Same output format as the firmware tool
+    makeDirs(root + "/bin");
+    return writeFile(root + "/bin/vcgencmd",
+                     "#!/bin/sh\n"
+                     "case \"$1\" in\n"
+                     "measure_clock) echo \"frequency(46)=500000992\" ;;\n"
+                     "get_throttled) echo \"throttled=0x50000\" ;;\n"
+                     "measure_volts) echo \"volt=0.8500V\" ;;\n"
+                     "*) exit 1 ;;\n"
+                     "esac\n", 0755);
+}
+
+struct BenchCase {
+    const char* name;
+    std::function<void()> op;
+};
+
+// Run op for about seconds, doubling the batch until it is long enough to time
+void runCase(const BenchCase& bench, double seconds) {
+    bench.op();   // warm up caches and lazily opened descriptors
+
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) bench.op();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+
+        if (elapsed >= seconds || iterations >= (1ULL << 30)) {
+            printf("%-28s %10llu %14.1f %12.2f\n", bench.name, static_cast<unsigned long long>(iterations),
+                   elapsed * 1e9 / iterations, static_cast<double>(allocations) / iterations);
+            return;
+        }
+        // Aim straight for the target once the batch is measurable
+        uint64_t next = elapsed > 0.01 ? static_cast<uint64_t>(iterations * seconds / elapsed * 1.1) : iterations * 10;
+        iterations = std::max(next, iterations + 1);
+    }
+}
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? strtod(argv[1], nullptr) : 0.5;
+    if (seconds <= 0) seconds = 0.5;
+    const char* filter = argc > 2 ? argv[2] : "";
+
+    char rootTemplate[] = "/tmp/overpi-bench.XXXXXX";
+    if (!mkdtemp(rootTemplate)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string root = rootTemplate;
+    if (!makeFakeSystem(root)) {
+        fprintf(stderr, "could not create the fake system under %s\n", root.c_str());
+        removeTree(root);
+        return 1;
+    }
+    std::string path = root + "/bin:" + (getenv("PATH") ? getenv("PATH") : "/usr/bin:/bin");
+    setenv("PATH", path.c_str(), 1);
+
+    std::string sysfs = root + "/sys";
+    std::string configPath = root + "/boot/config.txt";
+    std::string backupPath = root + "/boot/config.txt.bak";
+
+    SensorSampler sampler(sysfs);
+    SnapshotCollector collector(sysfs, root + "/no-vcio");
+    CpufreqBackend cpufreq(sysfs);
+    ResidencyTracker residency(sysfs);
+    HistoryBuffer history(kCpus);
+    ProfileMap profiles = builtinProfiles();
+    const ProfileConfig& normal = *findProfile(profiles, "normal");
+    const ProfileConfig& high = *findProfile(profiles, "high");
+
+    SystemSnapshot snapshot;
+    collector.collect(snapshot);
+    int64_t fakeNs = snapshot.monotonicNs;
+    bool flip = false;
+    volatile size_t sink = 0;
+
+    std::vector<BenchCase> cases = {
+        {"sensor/temperature", [&]() {
+            long milliC;
+            sampler.readTemperature(milliC);
+        }},
+        {"sensor/all_cpu_freq", [&]() {
+            long kHz;
+            for (int cpu = 0; cpu < sampler.cpuCount(); cpu++) sampler.readCurFreq(cpu, kHz);
+        }},
+        {"sensor/governor", [&]() {
+            std::string governor;
+            sampler.readGovernor(0, governor);
+        }},
+        {"collect/vcgencmd_stub", [&]() {
+            collector.collect(snapshot);
+        }},
+        {"parse/decode_throttling", [&]() {
+            sink += decodeThrottling(0x50005).size();
+        }},
+        {"parse/vcgencmd_batch", [&]() {
+            // One tick of the batched fallback's output
+            VcReading reading;
+            SnapshotCollector::parseVcgencmd(kVcgencmdBatch, reading);
+            sink += reading.clockHz[VC_DOMAIN_V3D];
+        }},
+        {"parse/config_txt", [&]() {
+            ConfigTxt config(kBoardFilters);
+            config.parse(kConfigTxt);
+            config.set("arm_freq", flip ? "2000" : "1800");
+            sink += config.serialize().size();
+            flip = !flip;
+        }},
+        {"history/append", [&]() {
+            fakeNs += 2000000000LL;
+            snapshot.monotonicNs = fakeNs;
+            history.append(snapshot);
+        }},
+        {"residency/update", [&]() {
+            fakeNs += 2000000000LL;
+            snapshot.monotonicNs = fakeNs;
+            residency.update(snapshot);
+        }},
+        {"apply/hot", [&]() {
+            std::string error;
+            applyProfileHot(cpufreq, flip ? high : normal, error);
+            flip = !flip;
+        }},
+        {"apply/permanent_unchanged", [&]() {
+            bool changed;
+            std::string error;
+            applyProfilePermanent(normal, kBoardFilters, changed, error, configPath, backupPath);
+        }},
+        {"apply/permanent_write", [&]() {
+            bool changed;
+            std::string error;
+            applyProfilePermanent(flip ? high : normal, kBoardFilters, changed, error, configPath, backupPath);
+            flip = !flip;
+        }},
+    };
+
+    printf("%-28s %10s %14s %12s\n", "case", "iterations", "ns/op", "allocs/op");
+    for (const auto& bench : cases) {
+        if (strstr(bench.name, filter) == nullptr) continue;
+        runCase(bench, seconds);
+    }
+
+    std::string error;
+    if (!removeTree(root, &error)) fprintf(stderr, "could not remove %s\n", error.c_str());
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "overpi_core.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+#include <vector>
+#include <libintl.h>
+
+#include "config_txt.h"
+#include "latency_stats.h"
+
+#define _(string) gettext(string)
+
+const char* const kBootConfigPath = "/boot/firmware/config.txt";
+const char* const kBootConfigBackupPath = "/boot/firmware/config.txt.bak";
+
+ProfileMap builtinProfiles() {
+    ProfileMap profiles;
+
+    // Minimum Profile
+    ProfileConfig minimum;
+    minimum.id = "minimum";
+    minimum.name = _("Minimum");
+    minimum.order = 0;
+    minimum.armFreqMHz = 600;
+    minimum.gpuFreqMHz = 500;
+    minimum.overVoltage = 0;
+    minimum.forceTurbo = false;
+    minimum.tempLimitMilliC = 80000;
+    minimum.desc = _("Minimum operation configuration\n- CPU: 600 MHz\n- GPU: 500 MHz\n- Overvoltage: 0\n- Force Turbo: 0");
+    minimum.color = "#27ae60";
+    profiles[minimum.id] = minimum;
+    
+    // Normal Profile
+    ProfileConfig normal;
+    normal.id = "normal";
+    normal.name = _("Normal");
+    normal.order = 1;
+    normal.armFreqMHz = 1800;
+    normal.gpuFreqMHz = 500;
+    normal.overVoltage = 0;
+    normal.forceTurbo = false;
+    normal.tempLimitMilliC = 80000;
+    normal.desc = _("Factory default configuration\n- CPU: 1800 MHz\n- GPU: 500 MHz\n- Overvoltage: 0\n- Force Turbo: 0");
+    normal.color = "#27ae60";
+    profiles[normal.id] = normal;
+    
+    // Moderate Profile
+    ProfileConfig moderate;
+    moderate.id = "moderate";
+    moderate.name = _("Moderate");
+    moderate.order = 2;
+    moderate.armFreqMHz = 1900;
+    moderate.gpuFreqMHz = 550;
+    moderate.overVoltage = 2;
+    moderate.forceTurbo = false;
+    moderate.tempLimitMilliC = 75000;
+    moderate.desc = _("Slight performance increase\n- CPU: 1900 MHz\n- GPU: 550 MHz\n- Overvoltage: 2\n- Force Turbo: 0");
+    moderate.color = "#3498db";
+    profiles[moderate.id] = moderate;
+    
+    // High Profile
+    ProfileConfig high;
+    high.id = "high";
+    high.name = _("High");
+    high.order = 3;
+    high.armFreqMHz = 2000;
+    high.gpuFreqMHz = 600;
+    high.overVoltage = 4;
+    high.forceTurbo = false;
+    high.tempLimitMilliC = 70000;
+    high.desc = _("Improved performance\n- CPU: 2000 MHz\n- GPU: 600 MHz\n- Overvoltage: 4\n- Force Turbo: 0");
+    high.color = "#f39c12";
+    profiles[high.id] = high;
+    
+    // Extreme Profile
+    ProfileConfig extreme;
+    extreme.id = "extreme";
+    extreme.name = _("Extreme");
+    extreme.order = 4;
+    extreme.armFreqMHz = 2200;
+    extreme.gpuFreqMHz = 750;
+    extreme.overVoltage = 8;
+    extreme.forceTurbo = false;
+    extreme.tempLimitMilliC = 65000;
+    extreme.desc = _("Maximum performance (dangerous)\n- CPU: 2200 MHz\n- GPU: 750 MHz\n- Overvoltage: 8\n- Force Turbo: 0\n\n⚠️ REQUIRES GOOD COOLING");
+    extreme.color = "#e74c3c";
+    profiles[extreme.id] = extreme;
+
+    return profiles;
+}
+
+const ProfileConfig* findProfile(const ProfileMap& profiles, const std::string& key, std::string* id) {
+    auto it = profiles.find(key);
+    if (it == profiles.end()) {
+        it = std::find_if(profiles.begin(), profiles.end(), [&key](const ProfileMap::value_type& entry) {
+            return entry.second.name == key;
+        });
+    }
+    if (it == profiles.end()) return nullptr;
+    if (id) *id = it->first;
+    return &it->second;
+}
+
+std::vector<const ProfileConfig*> sortedProfiles(const ProfileMap& profiles) {
+    std::vector<const ProfileConfig*> sorted;
+    for (const auto& entry : profiles) sorted.push_back(&entry.second);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const ProfileConfig* a, const ProfileConfig* b) {
+        return a->order < b->order;
+    });
+    return sorted;
+}
+
+std::string decodeThrottling(unsigned long throttledCode) {
+    ScopedLatency latency(PROBE_DECODE_THROTTLING);
+    std::vector<std::string> messages;
+    
+    // Current bits
+    if (throttledCode & 0x1) messages.push_back(_("Under-voltage now"));
+    if (throttledCode & 0x2) messages.push_back(_("Frequency capped now"));
+    if (throttledCode & 0x4) messages.push_back(_("Throttling now"));
+    if (throttledCode & 0x8) messages.push_back(_("Temperature limit now"));
+    
+    // Historical bits
+    if (throttledCode & 0x10000) messages.push_back(_("Under-voltage occurred"));
+    if (throttledCode & 0x20000) messages.push_back(_("Frequency capped occurred"));
+    if (throttledCode & 0x40000) messages.push_back(_("Throttling occurred"));
+    if (throttledCode & 0x80000) messages.push_back(_("Temperature limit occurred"));
+    
+    if (messages.empty()) {
+        return _("No throttling");
+    }
+    
+    std::string result;
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (i > 0) result += ", ";
+        result += messages[i];
+    }
+    return result;
+}
+
+bool applyProfileHot(CpufreqBackend& cpufreq, const ProfileConfig& profile, std::string& error) {
+    if (cpufreq.policyCount() == 0) {
+        error = _("No cpufreq policies found in sysfs.\nMake sure the kernel exposes CPU frequency scaling.");
+        return false;
+    }
+    
+    // Change governor to performance on every policy
+    std::vector<CpufreqStep> steps;
+    bool ok;
+    {
+        ScopedLatency step(PROBE_APPLY_GOVERNOR);
+        ok = cpufreq.setGovernor("performance", &steps);
+    }
+    if (!ok) {
+        error = std::string(_("Could not change governor to performance.\nMake sure you have root permissions.\n\n")) + CpufreqBackend::describeErrors(steps);
+        return false;
+    }
+
+    // Pin minimum and maximum frequencies
+    long freqKHz = profile.armFreqMHz * 1000;
+    steps.clear();
+    {
+        ScopedLatency step(PROBE_APPLY_LIMITS);
+        ok = cpufreq.setLimits(freqKHz, freqKHz, &steps);
+    }
+    if (!ok) {
+        error = std::string(_("Could not adjust CPU frequency.\nMake sure you have root permissions.\n\n")) + CpufreqBackend::describeErrors(steps);
+        return false;
+    }
+    return true;
+}
+
+std::set<std::string> detectBoardFilters(const std::string& modelPath) {
+    std::string model;
+    std::ifstream file(modelPath.c_str());
+    std::getline(file, model, '\0');
+
+    // "Raspberry Pi 400 Rev 1.0", "Raspberry Pi Compute Module 4 Rev 1.1", ...
+    const std::string prefix = "Raspberry Pi ";
+    std::set<std::string> filters;
+    if (model.compare(0, prefix.size(), prefix) == 0) {
+        std::string rest = model.substr(prefix.size());
+        bool compute = rest.compare(0, 15, "Compute Module ") == 0;
+        if (compute) rest = rest.substr(15);
+        bool zero = rest.compare(0, 5, "Zero ") == 0;
+        if (zero) rest = rest.substr(5);
+
+        std::string number;
+        for (char c : rest) {
+            if (c < '0' || c > '9') break;
+            number += c;
+        }
+        if (zero) {
+            filters.insert("pi0");
+            if (number == "2") filters.insert("pi02");
+        } else if (!number.empty()) {
+            // Keyboard models run the SoC of the plain board
+            filters.insert("pi" + number.substr(0, 1));
+            if (number.size() > 1) filters.insert("pi" + number);
+            if (compute) filters.insert("cm" + number);
+        }
+    }
+
+    // Unknown boards are taken for the one overpi was written for
+    if (filters.empty()) filters = {"pi4", "pi400"};
+    return filters;
+}
+
+bool applyProfilePermanent(const ProfileConfig& profile, const std::set<std::string>& boardFilters,
+                           bool& changed, std::string& error,
+                           const std::string& configPath, const std::string& backupPath) {
+    changed = false;
+
+    ConfigTxt config(boardFilters);
+    std::string detail;
+    bool ok;
+    {
+        ScopedLatency step(PROBE_CONFIG_LOAD);
+        ok = config.load(configPath, &detail);
+    }
+    if (!ok) {
+        error = std::string(_("Could not read config.txt: ")) + detail;
+        return false;
+    }
+
+    config.set("arm_freq", std::to_string(profile.armFreqMHz));
+    config.set("gpu_freq", std::to_string(profile.gpuFreqMHz));
+    config.set("over_voltage", std::to_string(profile.overVoltage));
+    config.set("force_turbo", profile.forceTurbo ? "1" : "0");
+    if (!config.modified()) return true;
+
+    // Keep the file as it was before overpi first touched it
+    struct stat st;
+    if (stat(backupPath.c_str(), &st) != 0) {
+        ScopedLatency step(PROBE_CONFIG_BACKUP);
+        ok = ConfigTxt::writeFileAtomic(backupPath, config.original(), &detail);
+    }
+    if (!ok) {
+        error = std::string(_("Could not create the config.txt backup: ")) + detail;
+        return false;
+    }
+
+    {
+        ScopedLatency step(PROBE_CONFIG_SAVE);
+        ok = config.save(configPath, &changed, &detail);
+    }
+    if (!ok) {
+        error = std::string(_("Could not modify config.txt: ")) + detail;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef OVERPI_CORE_H
+#define OVERPI_CORE_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "cpufreq_backend.h"
+
+// Structure to store profile configuration
+struct ProfileConfig {
+    std::string id;              // stable, locale independent key
+    std::string name;            // display name, translated for the built-in profiles
+    int order;                   // position in lists; built-in profiles first
+    long armFreqMHz;
+    long gpuFreqMHz;
+    int overVoltage;             // 25 mV steps above the default core voltage
+    bool forceTurbo;
+    long tempLimitMilliC;
+    std::set<std::string> models; // config.txt filters (pi4, pi400, ...); empty for any board
+    std::string desc;
+    std::string color;
+    BenchmarkResult benchmark;   // last benchmark run under this profile
+
+    ProfileConfig()
+    : order(0), armFreqMHz(0), gpuFreqMHz(0), overVoltage(0), forceTurbo(false), tempLimitMilliC(0) {}
+};
+
+// Profiles keyed by id
+typedef std::map<std::string, ProfileConfig> ProfileMap;
+
+// The five built-in profiles, Minimum to Extreme
+ProfileMap builtinProfiles();
+
+// Look up a profile by id or display name; the id is stored in id when
+// given. Returns nullptr if there is no such profile.
+const ProfileConfig* findProfile(const ProfileMap& profiles, const std::string& key, std::string* id = nullptr);
+
+// The profiles in display order
+std::vector<const ProfileConfig*> sortedProfiles(const ProfileMap& profiles);
+
+// Human readable list of the get_throttled bits that are set
+std::string decodeThrottling(unsigned long throttledCode);
+
+// Switch every policy to the performance governor and pin the clock to the
+// profile's armFreqMHz. On failure error holds a translated message.
+bool applyProfileHot(CpufreqBackend& cpufreq, const ProfileConfig& profile, std::string& error);
+
+// config.txt filters of the board named in the device tree, e.g. pi4 and
+// pi400 on a Raspberry Pi 400. Profile models and config.txt editing both
+// go by these, so they agree on which board this is.
+std::set<std::string> detectBoardFilters(const std::string& modelPath = "/proc/device-tree/model");
+
+// Firmware config.txt and the pristine copy taken before the first change
+extern const char* const kBootConfigPath;
+extern const char* const kBootConfigBackupPath;
+
+// Write the profile's clocks and voltage into config.txt, changing only
+// those keys in the section that applies to the board with the given
+// config.txt filters. changed is false when the file already held them and
+// was left untouched. On failure error holds a translated message.
+bool applyProfilePermanent(const ProfileConfig& profile, const std::set<std::string>& boardFilters,
+                           bool& changed, std::string& error,
+                           const std::string& configPath = kBootConfigPath,
+                           const std::string& backupPath = kBootConfigBackupPath);
+
+#endif
@@ -0,0 +1,371 @@
+#include "overpi_daemon.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <libintl.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "latency_stats.h"
+
+#define _(string) gettext(string)
+
+OverpiDaemon::OverpiDaemon(const DaemonOptions& options)
+: m_options(options),
+  m_server(m_loop, [this](const std::string& request) { return handleRequest(request); }),
+  m_metrics(m_loop),
+  m_fleet(m_loop),
+  m_pipeline(schedulerConfig(options)),
+  m_workload(options.workload),
+  m_autoProfile(options.autoProfile),
+  m_signalFd(-1) {
+    m_pipeline.setMetrics(&m_metrics);
+    m_pipeline.setFleet(&m_fleet);
+}
+
+OverpiDaemon::~OverpiDaemon() {
+    m_server.close();
+    m_metrics.close();
+    m_fleet.close();
+    if (m_signalFd >= 0) close(m_signalFd);
+}
+
+SchedulerConfig OverpiDaemon::schedulerConfig(const DaemonOptions& options) {
+    SchedulerConfig config;
+    if (options.intervalMs > 0) {
+        config.normalMs = options.intervalMs;
+        config.slowMs = std::max(config.slowMs, options.intervalMs);
+        config.fastMs = std::min(config.fastMs, options.intervalMs);
+    }
+    return config;
+}
+
+int OverpiDaemon::run() {
+    if (!m_loop.isValid()) {
+        std::cerr << _("Error: Could not create the event loop") << std::endl;
+        return 1;
+    }
+
+    // Shut down cleanly on SIGINT/SIGTERM so the socket is removed
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    m_signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    m_loop.add(m_signalFd, EPOLLIN, [this](uint32_t) {
+        struct signalfd_siginfo info;
+        while (read(m_signalFd, &info, sizeof(info)) > 0) {}
+        m_loop.stop();
+    });
+
+    if (!m_options.recordPath.empty() && !m_pipeline.recorder().open(m_options.recordPath, m_pipeline.collector().cpuCount())) {
+        std::cerr << _("Error: Could not open telemetry log: ") << m_options.recordPath << std::endl;
+    }
+
+    // Profile files are optional; a bad entry is reported and skipped
+    m_profiles.load();
+    for (const auto& error : m_profiles.errors()) std::cerr << error << std::endl;
+    if (!m_profiles.watch() ||
+        !m_loop.add(m_profiles.fd(), EPOLLIN, [this](uint32_t) { reloadProfiles(); })) {
+        std::cerr << _("Error: Could not watch the profile files") << std::endl;
+    }
+
+    if (!m_server.listen(m_options.socketPath)) {
+        std::cerr << _("Error: Could not listen on ") << m_options.socketPath << std::endl;
+        return 1;
+    }
+
+    if (m_options.metricsPort > 0 && !m_metrics.listen(m_options.metricsPort)) {
+        std::cerr << _("Error: Could not serve metrics on port ") << m_options.metricsPort << std::endl;
+        return 1;
+    }
+
+    if (m_options.fleetPort > 0) {
+        char hostname[256] = "";
+        gethostname(hostname, sizeof(hostname) - 1);
+        const ProfileConfig* profile = findProfile(m_profiles.profiles(), m_currentProfile);
+        m_fleet.setInfo(hostname, profile ? profile->id : "");
+        if (!m_fleet.listen(m_options.fleetPort)) {
+            std::cerr << _("Error: Could not serve the fleet stream on port ") << m_options.fleetPort << std::endl;
+            return 1;
+        }
+    }
+
+    // The scheduler's timer and thermal events share one descriptor
+    if (!m_loop.add(m_pipeline.scheduler().fd(), EPOLLIN, [this](uint32_t) {
+            if (m_pipeline.scheduler().consume() != SampleScheduler::WAKE_NONE) sample();
+        })) {
+        std::cerr << _("Error: Could not start the sampling timer") << std::endl;
+        return 1;
+    }
+
+    sample();
+    m_loop.run();
+
+    m_pipeline.recorder().close();
+    return 0;
+}
+
+void OverpiDaemon::sample() {
+    int intervalMs = m_pipeline.sample(m_snapshot);
+
+    // Follow the load; a failed switch is retried on the next change
+    std::string profileId;
+    if (m_autoProfile && m_workload.update(m_snapshot.monotonicNs, profileId)) {
+        std::string reply = activateProfile(profileId);
+        if (reply.compare(0, 2, "OK") != 0) std::cerr << profileId << ": " << reply << std::endl;
+    }
+
+    m_pipeline.scheduler().arm(intervalMs);
+}
+
+std::string OverpiDaemon::handleRequest(const std::string& request) {
+    size_t space = request.find(' ');
+    std::string command = request.substr(0, space);
+    std::string argument = space == std::string::npos ? "" : request.substr(space + 1);
+
+    if (command == "PING") return "OK pong";
+    if (command == "SNAPSHOT") return formatSnapshot();
+    if (command == "PROFILES") {
+        std::string reply = "OK";
+        for (const ProfileConfig* profile : sortedProfiles(m_profiles.profiles())) reply += " " + profile->id;
+        return reply;
+    }
+    if (command == "PROFILE") {
+        const ProfileConfig* profile = findProfile(m_profiles.profiles(), m_currentProfile);
+        return std::string("OK ") + (profile ? profile->id : "none");
+    }
+    if (command == "THROTTLING") {
+        if (!m_snapshot.firmwareValid || !m_snapshot.firmware.throttledValid) return "ERR throttling unavailable";
+        char hex[16];
+        snprintf(hex, sizeof(hex), "0x%x", m_snapshot.firmware.throttled);
+        return std::string("OK ") + hex + " " + decodeThrottling(m_snapshot.firmware.throttled);
+    }
+    if (command == "RESIDENCY") return formatResidency(argument.empty() ? m_pipeline.residency().profile() : argument);
+    if (command == "APPLY") return applyProfile(argument);
+    if (command == "PERSIST") return persistProfile(argument);
+    if (command == "GOVERNOR") {
+        if (argument == "ON") return setGovernor(true);
+        if (argument == "OFF") return setGovernor(false);
+        return "ERR expected ON or OFF";
+    }
+    if (command == "AUTO") return setAutoProfile(argument);
+    if (command == "EVENTS") return formatEvents(argument);
+    if (command == "LATENCY") {
+        if (argument == "RESET") resetLatency();
+        return formatLatencyLine();
+    }
+    return "ERR unknown command";
+}
+
+std::string OverpiDaemon::formatSnapshot() const {
+    const SystemSnapshot& s = m_snapshot;
+    char buf[128];
+    std::string reply = "OK";
+
+    snprintf(buf, sizeof(buf), " seq=%llu", static_cast<unsigned long long>(s.sequence));
+    reply += buf;
+    if (s.temperatureValid) {
+        snprintf(buf, sizeof(buf), " temp_mc=%ld", s.temperatureMilliC);
+        reply += buf;
+    }
+    reply += " cpu_khz=";
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        if (cpu > 0) reply += ",";
+        reply += s.cpuFreqValid[cpu] ? std::to_string(s.cpuFreqKHz[cpu]) : "-";
+    }
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        reply += cpu == 0 ? " eff_khz=" : ",";
+        reply += s.perf[cpu].clockValid ? std::to_string(s.perf[cpu].effectiveKHz) : "-";
+    }
+    for (int cpu = 0; cpu < s.cpuCount; cpu++) {
+        reply += cpu == 0 ? " ipc_milli=" : ",";
+        reply += s.perf[cpu].ipcValid ? std::to_string(s.perf[cpu].ipcMilli) : "-";
+    }
+    if (s.limitsValid) {
+        snprintf(buf, sizeof(buf), " min_khz=%ld max_khz=%ld", s.minFreqKHz, s.maxFreqKHz);
+        reply += buf;
+    }
+    if (s.governorValid) {
+        reply += " governor=";
+        reply += s.governor;
+    }
+    if (s.firmwareValid && s.firmware.clockValid[VC_DOMAIN_V3D]) {
+        snprintf(buf, sizeof(buf), " v3d_hz=%lu", static_cast<unsigned long>(s.firmware.clockHz[VC_DOMAIN_V3D]));
+        reply += buf;
+    }
+    if (s.firmwareValid && s.firmware.voltsValid[VC_RAIL_CORE]) {
+        snprintf(buf, sizeof(buf), " core_uv=%lu", static_cast<unsigned long>(s.firmware.microVolts[VC_RAIL_CORE]));
+        reply += buf;
+    }
+    if (s.firmwareValid) {
+        std::string clocks;
+        for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+            if (!s.firmware.clockValid[domain]) continue;
+            snprintf(buf, sizeof(buf), "%s%s:%lu", clocks.empty() ? "" : ",", vcDomainName(domain),
+                     static_cast<unsigned long>(s.firmware.clockHz[domain]));
+            clocks += buf;
+        }
+        if (!clocks.empty()) reply += " clocks_hz=" + clocks;
+
+        std::string rails;
+        for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+            if (!s.firmware.voltsValid[rail]) continue;
+            snprintf(buf, sizeof(buf), "%s%s:%lu", rails.empty() ? "" : ",", vcRailName(rail),
+                     static_cast<unsigned long>(s.firmware.microVolts[rail]));
+            rails += buf;
+        }
+        if (!rails.empty()) reply += " rails_uv=" + rails;
+    }
+    if (s.firmwareValid && s.firmware.throttledValid) {
+        snprintf(buf, sizeof(buf), " throttled=0x%x", s.firmware.throttled);
+        reply += buf;
+    }
+    if (s.governorEngaged) {
+        snprintf(buf, sizeof(buf), " ceiling_khz=%ld", s.governorCeilingKHz);
+        reply += buf;
+    }
+    return reply;
+}
+
+std::string OverpiDaemon::formatResidency(const std::string& profileId) const {
+    auto it = m_pipeline.residency().stats().find(profileId);
+    if (it == m_pipeline.residency().stats().end()) return "ERR no residency for this profile";
+
+    const ResidencyStats& stats = it->second;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "OK profile=%s observed_ms=%llu throttled_pct=%.2f", profileId.c_str(),
+             static_cast<unsigned long long>(stats.observedMs), stats.anyThrottlePercent());
+    std::string reply = buf;
+    for (const auto& entry : stats.frequencyMs) {
+        snprintf(buf, sizeof(buf), " khz_%ld=%.2f", entry.first, stats.frequencyPercent(entry.first));
+        reply += buf;
+    }
+    return reply;
+}
+
+std::string OverpiDaemon::formatEvents(const std::string& since) const {
+    // A page at a time; clients continue from next
+    const size_t kMaxEvents = 64;
+    std::vector<ThrottleEvent> events;
+    m_pipeline.throttle().query(strtoull(since.c_str(), nullptr, 10), ~0u, kMaxEvents, events);
+
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    int64_t wallOffsetMs = static_cast<int64_t>(real.tv_sec) * 1000 + real.tv_nsec / 1000000 - monotonicNowNs() / 1000000;
+
+    char buf[160];
+    uint64_t next = events.empty() ? m_pipeline.throttle().nextSeq() : events.back().seq + 1;
+    snprintf(buf, sizeof(buf), "OK next=%llu", static_cast<unsigned long long>(next));
+    std::string reply = buf;
+    for (const auto& event : events) {
+        snprintf(buf, sizeof(buf), " %llu:%lld:%s:%s:%s:%s",
+                 static_cast<unsigned long long>(event.seq),
+                 static_cast<long long>(event.monotonicNs / 1000000 + wallOffsetMs),
+                 ThrottleTracker::flagName(event.flag), ThrottleTracker::kindName(event.kind),
+                 event.tempMilliC == kHistoryInvalid ? "-" : std::to_string(event.tempMilliC).c_str(),
+                 event.cpuKHz == kHistoryInvalid ? "-" : std::to_string(event.cpuKHz).c_str());
+        reply += buf;
+    }
+    return reply;
+}
+
+std::string OverpiDaemon::applyProfile(const std::string& key) {
+    // A manual choice overrides the workload scheduler
+    m_autoProfile = false;
+
+    std::string reply = activateProfile(key);
+    if (reply.compare(0, 2, "OK") == 0) sample();
+    return reply;
+}
+
+std::string OverpiDaemon::activateProfile(const std::string& key) {
+    std::string id;
+    const ProfileConfig* profile = findProfile(m_profiles.profiles(), key, &id);
+    if (!profile) return "ERR unknown profile";
+
+    std::string error;
+    if (!m_pipeline.applyProfile(*profile, error)) {
+        // Keep the reply on one line
+        for (auto& c : error) {
+            if (c == '\n') c = ' ';
+        }
+        return "ERR " + error;
+    }
+    m_currentProfile = id;
+    return "OK " + profile->id;
+}
+
+void OverpiDaemon::reloadProfiles() {
+    const ProfileConfig* before = findProfile(m_profiles.profiles(), m_currentProfile);
+    ProfileConfig previous = before ? *before : ProfileConfig();
+    if (!m_profiles.consume()) return;
+    for (const auto& error : m_profiles.errors()) std::cerr << error << std::endl;
+
+    // A deployed change to the active profile takes effect right away; a
+    // removed one leaves the clocks as they are
+    const ProfileConfig* profile = findProfile(m_profiles.profiles(), m_currentProfile);
+    if (!profile || (profile->armFreqMHz == previous.armFreqMHz && profile->tempLimitMilliC == previous.tempLimitMilliC)) {
+        return;
+    }
+    std::string reply = activateProfile(m_currentProfile);
+    if (reply.compare(0, 2, "OK") != 0) std::cerr << m_currentProfile << ": " << reply << std::endl;
+}
+
+std::string OverpiDaemon::persistProfile(const std::string& key) {
+    const ProfileConfig* profile = findProfile(m_profiles.profiles(), key);
+    if (!profile) return "ERR unknown profile";
+
+    bool changed = false;
+    std::string error;
+    if (!applyProfilePermanent(*profile, m_profiles.boardFilters(), changed, error)) {
+        for (auto& c : error) {
+            if (c == '\n') c = ' ';
+        }
+        return "ERR " + error;
+    }
+    return "OK " + profile->id + (changed ? " written" : " unchanged");
+}
+
+std::string OverpiDaemon::setAutoProfile(const std::string& argument) {
+    if (argument == "ON") {
+        if (!m_autoProfile) {
+            m_autoProfile = true;
+            m_workload.reset();
+            sample();
+        }
+    } else if (argument == "OFF") {
+        m_autoProfile = false;
+    } else if (!argument.empty()) {
+        return "ERR expected ON or OFF";
+    }
+
+    char buf[160];
+    WorkloadScheduler::Level level = m_workload.level();
+    snprintf(buf, sizeof(buf), "OK %s level=%s profile=%s cpu_pct=%d load_pct=%d job=%s",
+             m_autoProfile ? "on" : "off", WorkloadScheduler::levelName(level),
+             m_workload.profileFor(level).c_str(), m_workload.busyPercent(), m_workload.loadPercent(),
+             m_workload.job().empty() ? "-" : m_workload.job().c_str());
+    return buf;
+}
+
+std::string OverpiDaemon::setGovernor(bool on) {
+    if (!on) {
+        m_pipeline.releaseGovernor();
+        return "OK off";
+    }
+
+    const ProfileConfig* profile = findProfile(m_profiles.profiles(), m_currentProfile);
+    if (!profile) profile = findProfile(m_profiles.profiles(), "normal");
+    // Both can be gone after a profile file reload
+    if (!profile) return "ERR no profile";
+
+    if (!m_pipeline.engageGovernor(*profile)) return "ERR could not engage the governor";
+    return "OK on";
+}
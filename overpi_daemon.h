@@ -0,0 +1,87 @@
+#ifndef OVERPI_DAEMON_H
+#define OVERPI_DAEMON_H
+
+#include <string>
+
+#include "control_server.h"
+#include "event_loop.h"
+#include "fleet_publisher.h"
+#include "metrics_exporter.h"
+#include "overpi_core.h"
+#include "profile_store.h"
+#include "sample_pipeline.h"
+#include "system_snapshot.h"
+#include "workload_scheduler.h"
+
+// Command line options of overpi --daemon
+struct DaemonOptions {
+    std::string socketPath;
+    std::string recordPath;
+    int intervalMs;    // interval when cool but busy
+    int metricsPort;   // 0 disables the /metrics endpoint
+    int fleetPort;     // 0 disables streaming to overpi-fleet
+    bool autoProfile;  // start with the workload scheduler on
+    WorkloadConfig workload;
+
+    DaemonOptions() : socketPath("/run/overpi.sock"), intervalMs(2000), metricsPort(0), fleetPort(0), autoProfile(false) {}
+};
+
+// Headless service: samples on an adaptive timer and answers requests on a Unix
+// socket, without GTK or a display. Everything runs on one thread.
+//
+// Protocol, one line per request and per reply. Replies start with "OK"
+// or "ERR <reason>"; values are space separated key=value pairs.
+//   PING                 OK pong
+//   SNAPSHOT             OK seq=.. temp_mc=.. cpu_khz=a,b,.. eff_khz=a,b,.. ...
+//                        clocks_hz=arm:..,core:..,.. rails_uv=core:..,sdram_c:..,..
+//   THROTTLING           OK 0x50000 <decoded text>
+//   PROFILES             OK <id> <id> ...  (built-in and profile file entries)
+//   PROFILE              OK <id of the active profile>
+//   RESIDENCY [id]       OK profile=.. observed_ms=.. throttled_pct=.. khz_<f>=<pct> ...
+//   APPLY <id>           OK <id>
+//   PERSIST <id>         OK <id> written|unchanged  (config.txt, needs a reboot)
+//   GOVERNOR ON|OFF      OK on|off
+//   EVENTS [since]       OK next=<seq> <seq>:<wall_ms>:<flag>:on|off|transient:<temp_mc>:<cpu_khz> ...
+//   LATENCY [RESET]      OK <step>=calls:p50_us:p99_us:max_us ...
+//   AUTO [ON|OFF]        OK on|off level=.. profile=.. cpu_pct=.. load_pct=.. job=..
+//   QUIT                 closes the connection
+class OverpiDaemon {
+public:
+    explicit OverpiDaemon(const DaemonOptions& options = DaemonOptions());
+    ~OverpiDaemon();
+
+    // Serve until SIGINT or SIGTERM; returns the process exit code
+    int run();
+
+private:
+    OverpiDaemon(const OverpiDaemon&) = delete;
+    OverpiDaemon& operator=(const OverpiDaemon&) = delete;
+
+    static SchedulerConfig schedulerConfig(const DaemonOptions& options);
+    void sample();
+    std::string handleRequest(const std::string& request);
+    std::string formatSnapshot() const;
+    std::string formatResidency(const std::string& profileId) const;
+    std::string formatEvents(const std::string& since) const;
+    std::string applyProfile(const std::string& key);
+    std::string activateProfile(const std::string& key);
+    void reloadProfiles();
+    std::string persistProfile(const std::string& key);
+    std::string setGovernor(bool on);
+    std::string setAutoProfile(const std::string& argument);
+
+    DaemonOptions m_options;
+    EventLoop m_loop;
+    ControlServer m_server;
+    MetricsExporter m_metrics;
+    FleetPublisher m_fleet;
+    SamplePipeline m_pipeline;
+    ProfileStore m_profiles;
+    std::string m_currentProfile;   // id of the applied profile
+    SystemSnapshot m_snapshot;
+    WorkloadScheduler m_workload;
+    bool m_autoProfile;
+    int m_signalFd;
+};
+
+#endif
@@ -0,0 +1,144 @@
+// overpi-fleet: collect telemetry from many `overpi --daemon --fleet-port`
+// agents and print a merged view: hottest boards, boards throttling now,
+// profile distribution. One epoll thread serves every connection.
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+#include "event_loop.h"
+#include "fleet_aggregator.h"
+
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [--file FILE] [--interval SEC] [--top N] [--once SEC] HOST[:PORT[-PORT]] ...\n"
+        "  --file FILE     read agents from FILE, one HOST[:PORT[-PORT]] per line\n"
+        "  --interval SEC  print the view every SEC seconds (default 5)\n"
+        "  --top N         boards listed as hottest and throttled (default 10)\n"
+        "  --once SEC      collect for SEC seconds, print once and exit;\n"
+        "                  the exit code is 1 unless every agent reported\n", argv0);
+}
+
+// HOST, HOST:PORT or HOST:FIRST-LAST for a block of agents on one host
+static bool addAgents(FleetAggregator& fleet, const std::string& spec) {
+    size_t colon = spec.rfind(':');
+    size_t dash = colon == std::string::npos ? std::string::npos : spec.find('-', colon);
+    if (dash == std::string::npos) return fleet.addAgent(spec);
+
+    std::string host = spec.substr(0, colon);
+    long first = strtol(spec.c_str() + colon + 1, nullptr, 10);
+    long last = strtol(spec.c_str() + dash + 1, nullptr, 10);
+    if (first <= 0 || last < first || last > 65535) return false;
+    for (long port = first; port <= last; port++) {
+        if (!fleet.addAgent(host + ":" + std::to_string(port))) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    double intervalSec = 5;
+    double onceSec = 0;
+    size_t top = 10;
+    std::vector<std::string> specs;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            std::ifstream file(argv[++i]);
+            if (!file) {
+                std::fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 2;
+            }
+            std::string line;
+            while (std::getline(file, line)) {
+                line = line.substr(0, line.find('#'));
+                size_t begin = line.find_first_not_of(" \t\r");
+                if (begin == std::string::npos) continue;
+                specs.push_back(line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin));
+            }
+        } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            intervalSec = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--once") == 0 && i + 1 < argc) {
+            onceSec = std::atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            specs.push_back(argv[i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (specs.empty() || intervalSec <= 0 || onceSec < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    EventLoop loop;
+    FleetAggregator fleet(loop);
+    for (const auto& spec : specs) {
+        if (!addAgents(fleet, spec)) {
+            std::fprintf(stderr, "cannot resolve agent %s\n", spec.c_str());
+            return 2;
+        }
+    }
+
+    // One descriptor per agent; the default soft limit stops near a thousand
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop.add(signalFd, EPOLLIN, [&](uint32_t) {
+        struct signalfd_siginfo info;
+        while (read(signalFd, &info, sizeof(info)) > 0) {}
+        loop.stop();
+    });
+
+    // Print on a timer, or once after the collection window
+    double periodSec = onceSec > 0 ? onceSec : intervalSec;
+    int printFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = static_cast<time_t>(periodSec);
+    spec.it_value.tv_nsec = static_cast<long>((periodSec - static_cast<time_t>(periodSec)) * 1e9);
+    if (onceSec <= 0) spec.it_interval = spec.it_value;
+    if (printFd < 0 || timerfd_settime(printFd, 0, &spec, nullptr) != 0 ||
+        !loop.add(printFd, EPOLLIN, [&](uint32_t) {
+            uint64_t expirations;
+            while (read(printFd, &expirations, sizeof(expirations)) > 0) {}
+            std::fputs(fleet.format(top).c_str(), stdout);
+            std::fputs("\n", stdout);
+            std::fflush(stdout);
+            if (onceSec > 0) loop.stop();
+        }) || !fleet.start()) {
+        std::fprintf(stderr, "cannot start the event loop\n");
+        return 1;
+    }
+
+    loop.run();
+
+    size_t reported = 0;
+    for (const auto& board : fleet.boards()) {
+        if (board.haveSample) reported++;
+    }
+    fleet.stop();
+    loop.remove(printFd);
+    loop.remove(signalFd);
+    close(printFd);
+    close(signalFd);
+    return onceSec > 0 && reported < fleet.boards().size() ? 1 : 0;
+}
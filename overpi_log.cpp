@@ -0,0 +1,182 @@
+// overpi-log: dump or summarise telemetry recorded with `overpi --record`
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <vector>
+#include <ctime>
+
+#include "telemetry_log.h"
+#include "history_buffer.h"
+#include "throttle_tracker.h"
+
+static void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [--info] [--summary] [--events] [--from SEC] [--to SEC] FILE\n"
+        "  --info      show file and block index information\n"
+        "  --summary   print min/max/avg per channel instead of samples\n"
+        "  --events    print each throttle flag transition instead of samples\n"
+        "  --from SEC  start offset in seconds from the beginning of the log\n"
+        "  --to SEC    end offset in seconds from the beginning of the log\n", argv0);
+}
+
+// Local time with microseconds, e.g. 2024-05-01T12:00:00.250000
+static void formatStamp(int64_t wallUs, char* out, size_t size) {
+    time_t secs = static_cast<time_t>(wallUs / 1000000);
+    struct tm tmv;
+    localtime_r(&secs, &tmv);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tmv);
+    std::snprintf(out, size, "%s.%06lld", stamp, static_cast<long long>(wallUs % 1000000));
+}
+
+int main(int argc, char* argv[]) {
+    bool info = false;
+    bool summary = false;
+    bool events = false;
+    double fromSec = -1;
+    double toSec = -1;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--info") == 0) {
+            info = true;
+        } else if (std::strcmp(argv[i], "--summary") == 0) {
+            summary = true;
+        } else if (std::strcmp(argv[i], "--events") == 0) {
+            events = true;
+        } else if (std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            fromSec = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            toSec = std::atof(argv[++i]);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    TelemetryReader reader;
+    if (!reader.open(path)) {
+        std::fprintf(stderr, "Error: cannot read telemetry log %s\n", path);
+        return 1;
+    }
+
+    const std::vector<std::string>& names = reader.channelNames();
+    // Offsets are relative to the first recorded sample
+    int64_t start = reader.blocks().empty() ? reader.monoStartUs() : reader.blocks().front().firstUs;
+    int64_t fromUs = fromSec >= 0 ? start + static_cast<int64_t>(fromSec * 1e6) : INT64_MIN;
+    int64_t toUs = toSec >= 0 ? start + static_cast<int64_t>(toSec * 1e6) : INT64_MAX;
+
+    if (info) {
+        uint64_t samples = 0;
+        for (const auto& block : reader.blocks()) samples += block.samples;
+        std::printf("channels: %d\nblocks: %zu\nsamples: %llu\nindex: %s\n",
+                    reader.channels(), reader.blocks().size(),
+                    static_cast<unsigned long long>(samples),
+                    reader.hasFooter() ? "footer" : "rebuilt (log not closed cleanly)");
+        if (!reader.blocks().empty()) {
+            std::printf("span: %.3f s\n", (reader.blocks().back().lastUs - reader.blocks().front().firstUs) / 1e6);
+        }
+        return 0;
+    }
+
+    if (summary) {
+        int n = reader.channels();
+        std::vector<int64_t> sum(n, 0);
+        std::vector<int32_t> lo(n, INT32_MAX), hi(n, INT32_MIN);
+        std::vector<uint64_t> count(n, 0);
+        uint32_t throttleSeen = 0;
+        size_t samples = reader.read(fromUs, toUs, [&](int64_t, const int32_t* values, uint32_t throttle) {
+            throttleSeen |= throttle;
+            for (int ch = 0; ch < n; ch++) {
+                if (values[ch] == kHistoryInvalid) continue;
+                if (values[ch] < lo[ch]) lo[ch] = values[ch];
+                if (values[ch] > hi[ch]) hi[ch] = values[ch];
+                sum[ch] += values[ch];
+                count[ch]++;
+            }
+        });
+
+        std::printf("samples: %zu\nthrottled_bits: 0x%x\n", samples, throttleSeen);
+        std::printf("%-16s %12s %12s %12s\n", "channel", "min", "max", "avg");
+        for (int ch = 0; ch < n; ch++) {
+            if (count[ch] == 0) {
+                std::printf("%-16s %12s %12s %12s\n", names[ch].c_str(), "-", "-", "-");
+            } else {
+                std::printf("%-16s %12d %12d %12lld\n", names[ch].c_str(), lo[ch], hi[ch],
+                            static_cast<long long>(sum[ch] / static_cast<int64_t>(count[ch])));
+            }
+        }
+        return 0;
+    }
+
+    if (events) {
+        // At most one event per flag per sample, so this never overwrites
+        // an event before it is printed
+        ThrottleTracker tracker(4);
+        std::vector<ThrottleEvent> found;
+
+        // Logs written before the firmware domains were recorded have a
+        // shorter layout; map the channels by name
+        int cores = 0;
+        for (const auto& name : names) {
+            if (name.compare(0, 3, "cpu") == 0) cores++;
+        }
+        std::vector<int> source(HISTORY_CPU_FREQ_BASE + cores, -1);
+        for (size_t ch = 0; ch < source.size(); ch++) {
+            auto it = std::find(names.begin(), names.end(), historyChannelName(static_cast<int>(ch)));
+            if (it != names.end()) source[ch] = static_cast<int>(it - names.begin());
+        }
+        std::vector<int32_t> mapped(source.size());
+
+        std::printf("time,offset_s,flag,change,temperature_mc,cpu_khz,gpu_clock_khz,core_uv,throttled\n");
+        reader.read(fromUs, toUs, [&](int64_t us, const int32_t* values, uint32_t throttle) {
+            for (size_t ch = 0; ch < source.size(); ch++) {
+                mapped[ch] = source[ch] < 0 ? kHistoryInvalid : values[source[ch]];
+            }
+            uint64_t seq = tracker.nextSeq();
+            tracker.update(us * 1000, throttle, mapped.data(), static_cast<int>(mapped.size()));
+            found.clear();
+            tracker.query(seq, ~0u, 4, found);
+
+            for (const auto& event : found) {
+                char stamp[40];
+                formatStamp(reader.wallUs(us), stamp, sizeof(stamp));
+                std::printf("%s,%.6f,%s,%s", stamp, (us - start) / 1e6,
+                            ThrottleTracker::flagName(event.flag), ThrottleTracker::kindName(event.kind));
+                const int32_t fields[] = {event.tempMilliC, event.cpuKHz, event.gpuKHz, event.coreMicroVolts};
+                for (int32_t value : fields) {
+                    if (value == kHistoryInvalid) std::printf(",");
+                    else std::printf(",%d", value);
+                }
+                std::printf(",0x%x\n", event.bits);
+            }
+        });
+        return 0;
+    }
+
+    // CSV dump
+    std::printf("time,offset_s,throttled");
+    for (const auto& name : names) std::printf(",%s", name.c_str());
+    std::printf("\n");
+
+    reader.read(fromUs, toUs, [&](int64_t us, const int32_t* values, uint32_t throttle) {
+        char stamp[40];
+        formatStamp(reader.wallUs(us), stamp, sizeof(stamp));
+        std::printf("%s,%.6f,0x%x", stamp, (us - start) / 1e6, throttle);
+        for (size_t ch = 0; ch < names.size(); ch++) {
+            if (values[ch] == kHistoryInvalid) std::printf(",");
+            else std::printf(",%d", values[ch]);
+        }
+        std::printf("\n");
+    });
+    return 0;
+}
@@ -0,0 +1,382 @@
+// overpi-sim: run profiles and the thermal governor against a simulated
+// board in accelerated time. The real apply, cpufreq, governor, collector,
+// residency and throttle event code drives a SimulatedBoard through its own
+// sysfs tree and config.txt, so hours of thermal behaviour take seconds.
+// With --agent the board is served to overpi-fleet instead.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+#include "board_sim.h"
+#include "cpufreq_backend.h"
+#include "event_loop.h"
+#include "file_tree.h"
+#include "fleet_publisher.h"
+#include "overpi_core.h"
+#include "residency_tracker.h"
+#include "snapshot_collector.h"
+#include "thermal_governor.h"
+#include "throttle_tracker.h"
+
+namespace {
+enum LoadPattern {
+    LOAD_FULL,
+    LOAD_BURSTY,   // 10 minutes busy, 5 idle
+    LOAD_IDLE
+};
+
+struct SimOptions {
+    double hours;
+    std::vector<bool> governor;
+    LoadPattern load;
+    SimConfig board;
+    bool check;
+    int agentPort;    // serve the fleet protocol instead of reporting
+    int speed;        // simulated seconds per wall second as an agent
+
+    SimOptions() : hours(2.0), load(LOAD_FULL), check(false), agentPort(0), speed(10) {}
+};
+
+struct RunResult {
+    double peakC;
+    double meanMHz;          // delivered clock, averaged over the run
+    double workGHzHours;     // clock times load, summed over all cores
+    double softPct;
+    double cappedPct;
+    double throttledPct;
+    double underVoltagePct;
+    size_t events;
+
+    RunResult()
+    : peakC(0), meanMHz(0), workGHzHours(0), softPct(0), cappedPct(0),
+      throttledPct(0), underVoltagePct(0), events(0) {}
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+        "Usage: %s [--hours H] [--profile ID[,ID..]] [--governor on|off|both]\n"
+        "          [--load full|bursty|idle] [--ambient C] [--supply-ohms R] [--check]\n"
+        "       %s --agent PORT [--speed X] [--profile ID] [--governor on|off] [--load ..] [--ambient C]\n"
+        "  --hours H        simulated time per run (default 2)\n"
+        "  --profile IDS    profiles to run (default all built-in profiles)\n"
+        "  --governor MODE  run with the thermal governor engaged, without, or both (default)\n"
+        "  --load PATTERN   full load, 10 min busy / 5 min idle, or idle (default full)\n"
+        "  --ambient C      ambient temperature (default 25)\n"
+        "  --supply-ohms R  resistance of the supply cable (default 0.25)\n"
+        "  --check          exit with 1 if any run hit the hard limit or under-voltage\n"
+        "  --agent PORT     serve the first profile to overpi-fleet on 127.0.0.1:PORT\n"
+        "  --speed X        simulated seconds per second as an agent (default 10)\n", argv0, argv0);
+}
+
+double loadAt(LoadPattern pattern, double seconds) {
+    switch (pattern) {
+    case LOAD_BURSTY:
+        return std::fmod(seconds, 900.0) < 600.0 ? 1.0 : 0.05;
+    case LOAD_IDLE:
+        return 0.05;
+    default:
+        return 1.0;
+    }
+}
+
+// A fresh board in a scratch directory with the overpi stack on top: the
+// profile persisted to its config.txt, booted, applied hot, and optionally
+// the thermal governor engaged
+class SimRig {
+public:
+    explicit SimRig(const SimConfig& config) : m_config(config) {}
+
+    ~SimRig() {
+        // The stack holds descriptors into the tree
+        m_collector.reset();
+        m_residency.reset();
+        m_governor.reset();
+        m_cpufreq.reset();
+        m_board.reset();
+        std::string error;
+        if (!m_root.empty() && !removeTree(m_root, &error)) fprintf(stderr, "could not remove %s\n", error.c_str());
+    }
+
+    bool setUp(const ProfileConfig& profile, bool useGovernor, std::string& error) {
+        char rootTemplate[] = "/tmp/overpi-sim.XXXXXX";
+        if (!mkdtemp(rootTemplate)) {
+            error = std::string("mkdtemp: ") + strerror(errno);
+            return false;
+        }
+        m_root = rootTemplate;
+
+        m_board.reset(new SimulatedBoard(m_root, m_config));
+        bool changed;
+        if (!m_board->create()) {
+            error = "could not create the simulated board under " + m_root;
+            return false;
+        }
+        if (!applyProfilePermanent(profile, m_board->boardFilters(), changed, error, m_board->configPath(), m_root + "/boot/config.txt.bak")) {
+            return false;
+        }
+        if (!m_board->boot()) {
+            error = "could not boot the simulated board";
+            return false;
+        }
+
+        // Opened after boot so they see the OPP table config.txt produced
+        std::string sysfs = m_board->sysfsRoot();
+        m_cpufreq.reset(new CpufreqBackend(sysfs));
+        m_governor.reset(new ThermalGovernor(sysfs));
+        m_collector.reset(new SnapshotCollector(sysfs, *m_board));
+        m_residency.reset(new ResidencyTracker(sysfs));
+        m_residency->setProfile(profile.id);
+
+        if (!applyProfileHot(*m_cpufreq, profile, error)) return false;
+        if (useGovernor) {
+            GovernorConfig config;
+            config.tempLimitMilliC = profile.tempLimitMilliC;
+            config.maxFreqKHz = profile.armFreqMHz * 1000;
+            config.minFreqKHz = std::min(config.minFreqKHz, config.maxFreqKHz);
+            if (!m_governor->engage(config)) {
+                error = "could not engage the governor";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One simulated second, sampled at its end like the daemon would
+    void tick(double load, SystemSnapshot& snapshot) {
+        m_board->step(1.0, load);
+        m_collector->collect(snapshot);
+        snapshot.monotonicNs = m_board->nowNs();
+        if (m_governor->isEngaged()) {
+            m_governor->update(snapshot.temperatureMilliC, snapshot.monotonicNs);
+            snapshot.governorEngaged = true;
+            snapshot.governorCeilingKHz = m_governor->ceilingKHz();
+        }
+        m_residency->update(snapshot);
+    }
+
+    const SimulatedBoard& board() const { return *m_board; }
+    const ResidencyTracker& residency() const { return *m_residency; }
+
+private:
+    SimRig(const SimRig&) = delete;
+    SimRig& operator=(const SimRig&) = delete;
+
+    SimConfig m_config;
+    std::string m_root;
+    std::unique_ptr<SimulatedBoard> m_board;
+    std::unique_ptr<CpufreqBackend> m_cpufreq;
+    std::unique_ptr<ThermalGovernor> m_governor;
+    std::unique_ptr<SnapshotCollector> m_collector;
+    std::unique_ptr<ResidencyTracker> m_residency;
+};
+
+// One profile on a fresh board, from ambient, sampled once per simulated second
+bool runProfile(const SimOptions& options, const ProfileConfig& profile, bool useGovernor,
+                RunResult& result, std::string& error) {
+    SimRig rig(options.board);
+    if (!rig.setUp(profile, useGovernor, error)) return false;
+
+    ThrottleTracker events;
+    long seconds = static_cast<long>(options.hours * 3600);
+    double clockSum = 0;
+    double work = 0;
+    SystemSnapshot snapshot;
+    for (long t = 0; t < seconds; t++) {
+        double load = loadAt(options.load, t);
+        rig.tick(load, snapshot);
+        events.update(snapshot);
+
+        result.peakC = std::max(result.peakC, rig.board().temperatureC());
+        clockSum += rig.board().clockKHz();
+        work += rig.board().clockKHz() / 1e6 * load * options.board.cores;
+    }
+
+    if (seconds > 0) {
+        result.meanMHz = clockSum / seconds / 1000.0;
+        result.workGHzHours = work / 3600.0;
+        auto it = rig.residency().stats().find(profile.id);
+        if (it != rig.residency().stats().end()) {
+            result.underVoltagePct = it->second.throttlePercent(THROTTLE_UNDER_VOLTAGE);
+            result.cappedPct = it->second.throttlePercent(THROTTLE_FREQ_CAPPED);
+            result.throttledPct = it->second.throttlePercent(THROTTLE_THROTTLED);
+            result.softPct = it->second.throttlePercent(THROTTLE_SOFT_TEMP);
+        }
+        result.events = events.size();
+    }
+    return true;
+}
+
+// Serve one board on the fleet port in real time, speed simulated seconds
+// per wall second, until SIGINT or SIGTERM. Many of these on loopback stand
+// in for a fleet when testing overpi-fleet.
+int runAgent(const SimOptions& options, const ProfileConfig& profile, bool useGovernor) {
+    SimRig rig(options.board);
+    std::string error;
+    if (!rig.setUp(profile, useGovernor, error)) {
+        fprintf(stderr, "%s: %s\n", profile.id.c_str(), error.c_str());
+        return 1;
+    }
+
+    EventLoop loop;
+    FleetPublisher publisher(loop);
+    publisher.setInfo("sim-" + std::to_string(options.agentPort), profile.id);
+    if (!publisher.listen(options.agentPort, "127.0.0.1")) {
+        fprintf(stderr, "could not listen on port %d\n", options.agentPort);
+        return 1;
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec = 1;
+    spec.it_value.tv_nsec = 1;
+    if (signalFd < 0 || timerFd < 0 || timerfd_settime(timerFd, 0, &spec, nullptr) != 0) {
+        fprintf(stderr, "could not set up the agent timers\n");
+        return 1;
+    }
+
+    long t = 0;
+    SystemSnapshot snapshot;
+    loop.add(signalFd, EPOLLIN, [&](uint32_t) {
+        struct signalfd_siginfo info;
+        while (read(signalFd, &info, sizeof(info)) > 0) {}
+        loop.stop();
+    });
+    loop.add(timerFd, EPOLLIN, [&](uint32_t) {
+        uint64_t expirations;
+        while (read(timerFd, &expirations, sizeof(expirations)) > 0) {}
+        for (int i = 0; i < options.speed; i++, t++) {
+            rig.tick(loadAt(options.load, t), snapshot);
+            publisher.publish(snapshot);
+        }
+    });
+    loop.run();
+
+    publisher.close();
+    loop.remove(timerFd);
+    loop.remove(signalFd);
+    close(timerFd);
+    close(signalFd);
+    return 0;
+}
+}
+
+int main(int argc, char* argv[]) {
+    SimOptions options;
+    std::string profileList;
+    std::string governorMode = "both";
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            options.hours = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profileList = argv[++i];
+        } else if (std::strcmp(argv[i], "--governor") == 0 && i + 1 < argc) {
+            governorMode = argv[++i];
+        } else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            std::string load = argv[++i];
+            if (load == "full") options.load = LOAD_FULL;
+            else if (load == "bursty") options.load = LOAD_BURSTY;
+            else if (load == "idle") options.load = LOAD_IDLE;
+            else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--ambient") == 0 && i + 1 < argc) {
+            options.board.ambientC = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--supply-ohms") == 0 && i + 1 < argc) {
+            options.board.supplyOhms = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--agent") == 0 && i + 1 < argc) {
+            options.agentPort = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            options.speed = std::max(std::atoi(argv[++i]), 1);
+        } else if (std::strcmp(argv[i], "--check") == 0) {
+            options.check = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (governorMode == "on") options.governor = {true};
+    else if (governorMode == "off") options.governor = {false};
+    else if (governorMode == "both") options.governor = {false, true};
+    else {
+        usage(argv[0]);
+        return 2;
+    }
+    if (options.hours <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ProfileMap profiles = builtinProfiles();
+    std::vector<const ProfileConfig*> selected;
+    if (profileList.empty()) {
+        // Minimum to Extreme, by clock
+        for (const auto& entry : profiles) selected.push_back(&entry.second);
+        std::sort(selected.begin(), selected.end(), [](const ProfileConfig* a, const ProfileConfig* b) {
+            return a->armFreqMHz < b->armFreqMHz;
+        });
+    } else {
+        size_t start = 0;
+        while (start <= profileList.size()) {
+            size_t end = profileList.find(',', start);
+            if (end == std::string::npos) end = profileList.size();
+            std::string id = profileList.substr(start, end - start);
+            const ProfileConfig* profile = findProfile(profiles, id);
+            if (!profile) {
+                fprintf(stderr, "unknown profile %s\n", id.c_str());
+                return 2;
+            }
+            selected.push_back(profile);
+            start = end + 1;
+        }
+    }
+
+    if (options.agentPort > 0) return runAgent(options, *selected.front(), options.governor.back());
+
+    printf("%-9s %-4s %7s %8s %10s %6s %7s %6s %6s %6s\n",
+           "profile", "gov", "peak_c", "mean_mhz", "work_ghz_h", "soft%", "capped%", "hard%", "uv%", "events");
+    bool failed = false;
+    auto start = std::chrono::steady_clock::now();
+    for (const ProfileConfig* profile : selected) {
+        for (bool useGovernor : options.governor) {
+            RunResult result;
+            std::string error;
+            if (!runProfile(options, *profile, useGovernor, result, error)) {
+                fprintf(stderr, "%s: %s\n", profile->id.c_str(), error.c_str());
+                return 1;
+            }
+            printf("%-9s %-4s %7.1f %8.0f %10.2f %6.1f %7.1f %6.1f %6.1f %6zu\n",
+                   profile->id.c_str(), useGovernor ? "on" : "off", result.peakC, result.meanMHz,
+                   result.workGHzHours, result.softPct, result.cappedPct, result.throttledPct,
+                   result.underVoltagePct, result.events);
+            if (result.throttledPct > 0 || result.underVoltagePct > 0) failed = true;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double simulated = options.hours * 3600 * selected.size() * options.governor.size();
+    printf("simulated %.1f h in %.1f s (%.0fx real time)\n", simulated / 3600, elapsed,
+           elapsed > 0 ? simulated / elapsed : 0.0);
+
+    return options.check && failed ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+#include "perf_sampler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+// Iterations of the task-clock calibration loop, eight dependent adds each
+const long kCalibrationIterations = 1 << 16;
+
+int perfEventOpen(struct perf_event_attr& attr, pid_t pid, int cpu, int groupFd) {
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, pid, cpu, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+struct perf_event_attr makeAttr(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attr;
+}
+
+// One add per cycle on in-order and out-of-order cores alike, since each
+// add depends on the previous one. The addend is kept in a register so
+// cores that fold immediate adds at rename cannot shortcut the chain.
+// The loop is written in assembly: compiled without -O, plain C++ keeps
+// x on the stack and every add pays a store-to-load round trip.
+unsigned long dependentAdds(long iterations) {
+    unsigned long x = 0;
+    unsigned long one = 1;
+    if (iterations <= 0) return x;
+#if defined(__aarch64__)
+    __asm__ volatile(
+        "1:\n\t"
+        "add %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\t"
+        "add %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\t"
+        "subs %1, %1, #1\n\t"
+        "b.ne 1b"
+        : "+r"(x), "+r"(iterations) : "r"(one) : "cc");
+#elif defined(__arm__)
+    __asm__ volatile(
+        "1:\n\t"
+        "add %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\t"
+        "add %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\tadd %0, %0, %2\n\t"
+        "subs %1, %1, #1\n\t"
+        "bne 1b"
+        : "+r"(x), "+r"(iterations) : "r"(one) : "cc");
+#elif defined(__x86_64__) || defined(__i386__)
+    __asm__ volatile(
+        "1:\n\t"
+        "add %2, %0\n\tadd %2, %0\n\tadd %2, %0\n\tadd %2, %0\n\t"
+        "add %2, %0\n\tadd %2, %0\n\tadd %2, %0\n\tadd %2, %0\n\t"
+        "dec %1\n\t"
+        "jnz 1b"
+        : "+r"(x), "+r"(iterations) : "r"(one) : "cc");
+#else
+    __asm__ volatile("" : "+r"(one));
+    for (long i = 0; i < iterations; i++) {
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+        x += one; __asm__ volatile("" : "+r"(x));
+    }
+#endif
+    return x;
+}
+
+int64_t threadCpuNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+}
+
+PerfSampler::PerfSampler(int cpuCount, const std::string& procRoot)
+: m_mode(MODE_NONE),
+  m_cpuCount(cpuCount),
+  m_statFd(open((procRoot + "/stat").c_str(), O_RDONLY | O_CLOEXEC)),
+  m_taskClockFd(-1),
+  m_ticksPerSecond(sysconf(_SC_CLK_TCK)),
+  m_primed(false),
+  m_buffer(16384) {
+    if (m_cpuCount <= 0) return;
+
+    if (m_statFd >= 0 && m_ticksPerSecond > 0 && openHardware()) {
+        m_mode = MODE_HARDWARE;
+    } else {
+        m_mode = MODE_TASK_CLOCK;
+    }
+}
+
+PerfSampler::~PerfSampler() {
+    closeHardware();
+    if (m_taskClockFd >= 0) close(m_taskClockFd);
+    if (m_statFd >= 0) close(m_statFd);
+}
+
+const char* PerfSampler::modeName(Mode mode) {
+    switch (mode) {
+    case MODE_HARDWARE: return "pmu";
+    case MODE_TASK_CLOCK: return "task-clock";
+    default: return "none";
+    }
+}
+
+bool PerfSampler::openHardware() {
+    for (int cpu = 0; cpu < m_cpuCount; cpu++) {
+        CoreCounters core;
+        core.lastCycles = 0;
+        core.lastInstructions = 0;
+        core.lastBusyTicks = 0;
+
+        struct perf_event_attr cycles = makeAttr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        core.cyclesFd = perfEventOpen(cycles, -1, cpu, -1);
+        if (core.cyclesFd < 0) {
+            closeHardware();
+            return false;
+        }
+
+        // IPC is optional; some PMUs have too few counters for both
+        struct perf_event_attr instructions = makeAttr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        core.instructionsFd = perfEventOpen(instructions, -1, cpu, core.cyclesFd);
+        m_cores.push_back(core);
+    }
+    return true;
+}
+
+void PerfSampler::closeHardware() {
+    for (const auto& core : m_cores) {
+        if (core.instructionsFd >= 0) close(core.instructionsFd);
+        if (core.cyclesFd >= 0) close(core.cyclesFd);
+    }
+    m_cores.clear();
+}
+
+bool PerfSampler::readBusyTicks(std::vector<uint64_t>& ticks) {
+    ssize_t n = pread(m_statFd, m_buffer.data(), m_buffer.size() - 1, 0);
+    if (n <= 0) return false;
+    m_buffer[n] = '\0';
+
+    // "cpuN user nice system idle iowait irq softirq steal ..."
+    ticks.assign(m_cpuCount, 0);
+    for (const char* line = m_buffer.data(); line && *line; line = std::strchr(line, '\n'), line = line ? line + 1 : nullptr) {
+        if (std::strncmp(line, "cpu", 3) != 0 || line[3] < '0' || line[3] > '9') continue;
+
+        char* end;
+        long cpu = strtol(line + 3, &end, 10);
+        if (cpu < 0 || cpu >= m_cpuCount) continue;
+
+        uint64_t fields[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        const char* p = end;
+        for (int i = 0; i < 8; i++) {
+            fields[i] = strtoull(p, &end, 10);
+            if (end == p) break;
+            p = end;
+        }
+        ticks[cpu] = fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7];
+    }
+    return true;
+}
+
+bool PerfSampler::sample(PerfReading* readings, int count) {
+    for (int i = 0; i < count; i++) readings[i] = PerfReading();
+
+    if (m_mode == MODE_TASK_CLOCK) return sampleTaskClock(readings, count);
+    if (m_mode != MODE_HARDWARE || !readBusyTicks(m_ticks)) return false;
+
+    bool any = false;
+    for (int cpu = 0; cpu < m_cpuCount && cpu < count; cpu++) {
+        CoreCounters& core = m_cores[cpu];
+
+        // nr, time_enabled, time_running, cycles, instructions
+        uint64_t data[5] = {0, 0, 0, 0, 0};
+        if (read(core.cyclesFd, data, sizeof(data)) < static_cast<ssize_t>(4 * sizeof(uint64_t))) continue;
+
+        // Scale up if the counters were multiplexed with other users
+        double scale = data[2] > 0 ? static_cast<double>(data[1]) / data[2] : 1.0;
+        uint64_t cyclesTotal = static_cast<uint64_t>(data[3] * scale);
+        uint64_t instructionsTotal = data[0] > 1 ? static_cast<uint64_t>(data[4] * scale) : 0;
+
+        uint64_t cycles = cyclesTotal - core.lastCycles;
+        uint64_t instructions = instructionsTotal - core.lastInstructions;
+        uint64_t busy = m_ticks[cpu] - core.lastBusyTicks;
+        core.lastCycles = cyclesTotal;
+        core.lastInstructions = instructionsTotal;
+        core.lastBusyTicks = m_ticks[cpu];
+
+        if (!m_primed) continue;
+
+        // Below two ticks of busy time the tick rounding dominates
+        if (busy >= 2) {
+            double busySeconds = static_cast<double>(busy) / m_ticksPerSecond;
+            readings[cpu].clockValid = true;
+            readings[cpu].effectiveKHz = static_cast<long>(cycles / busySeconds / 1000.0);
+            any = true;
+        }
+        if (data[0] > 1 && cycles > 0) {
+            readings[cpu].ipcValid = true;
+            readings[cpu].ipcMilli = static_cast<int>(instructions * 1000 / cycles);
+            any = true;
+        }
+    }
+    m_primed = true;
+    return any;
+}
+
+bool PerfSampler::sampleTaskClock(PerfReading* readings, int count) {
+    // The counter follows the thread that opened it, so open it on the
+    // sampling thread rather than in the constructor
+    if (m_taskClockFd < 0 && !m_primed) {
+        struct perf_event_attr attr = makeAttr(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        attr.read_format = 0;
+        m_taskClockFd = perfEventOpen(attr, 0, -1, -1);
+        m_primed = true;
+    }
+
+    int cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= count) return false;
+
+    uint64_t before = 0;
+    uint64_t after = 0;
+    int64_t beforeNs = threadCpuNs();
+    bool counter = m_taskClockFd >= 0 && read(m_taskClockFd, &before, sizeof(before)) == sizeof(before);
+    dependentAdds(kCalibrationIterations);
+    counter = counter && read(m_taskClockFd, &after, sizeof(after)) == sizeof(after);
+    int64_t ns = counter ? static_cast<int64_t>(after - before) : threadCpuNs() - beforeNs;
+
+    // Migrated or preempted mid-loop: skip rather than report nonsense
+    if (ns <= 0 || sched_getcpu() != cpu) return false;
+
+    readings[cpu].clockValid = true;
+    readings[cpu].effectiveKHz = static_cast<long>(kCalibrationIterations * 8 * 1000000LL / ns);
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef OVERPI_PERF_SAMPLER_H
+#define OVERPI_PERF_SAMPLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Delivered clock and IPC of one core over the last interval
+struct PerfReading {
+    bool clockValid;
+    long effectiveKHz;     // cycles per busy second
+    bool ipcValid;
+    int ipcMilli;          // instructions per cycle x 1000
+
+    PerfReading() : clockValid(false), effectiveKHz(0), ipcValid(false), ipcMilli(0) {}
+};
+
+// Measures the clock the cores actually run at, which scaling_cur_freq
+// does not show when the firmware caps it.
+//
+// With a PMU, each core gets a cycles+instructions group counted
+// system-wide through perf_event_open; the delivered clock is cycles over
+// the core's busy time from /proc/stat, and IPC is instructions over
+// cycles. Without one, a fixed chain of dependent adds is timed with the
+// thread's task-clock on whichever core runs the sampler, which gives an
+// estimate of that core's clock and no IPC.
+class PerfSampler {
+public:
+    enum Mode {
+        MODE_NONE = 0,        // neither counters nor task-clock usable
+        MODE_HARDWARE = 1,    // per-core cycles and instructions
+        MODE_TASK_CLOCK = 2   // calibrated loop on the sampling core
+    };
+
+    explicit PerfSampler(int cpuCount, const std::string& procRoot = "/proc");
+    ~PerfSampler();
+
+    Mode mode() const { return m_mode; }
+    static const char* modeName(Mode mode);
+
+    // Fill one reading per core; false when nothing could be measured
+    bool sample(PerfReading* readings, int count);
+
+private:
+    PerfSampler(const PerfSampler&) = delete;
+    PerfSampler& operator=(const PerfSampler&) = delete;
+
+    struct CoreCounters {
+        int cyclesFd;          // group leader
+        int instructionsFd;
+        uint64_t lastCycles;
+        uint64_t lastInstructions;
+        uint64_t lastBusyTicks;
+    };
+
+    bool openHardware();
+    void closeHardware();
+    bool readBusyTicks(std::vector<uint64_t>& ticks);
+    bool sampleTaskClock(PerfReading* readings, int count);
+
+    Mode m_mode;
+    int m_cpuCount;
+    int m_statFd;
+    int m_taskClockFd;
+    long m_ticksPerSecond;
+    bool m_primed;
+    std::vector<CoreCounters> m_cores;
+    std::vector<uint64_t> m_ticks;
+    std::vector<char> m_buffer;
+};
+
+#endif
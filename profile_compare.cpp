@@ -0,0 +1,477 @@
+#include "profile_compare.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "cpufreq_backend.h"
+
+namespace {
+// Live get_throttled bits that count as throttle time
+const uint32_t kLiveThrottleBits = 0xf;
+
+// Largest n for the exact Mann-Whitney distribution
+const size_t kExactMaxSamples = 20;
+
+double medianOf(std::vector<double> values) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+// P(X <= k) for X ~ Binomial(n, 1/2)
+double binomialHalfCdf(size_t n, size_t k) {
+    double term = std::pow(0.5, static_cast<double>(n));
+    double sum = 0;
+    for (size_t i = 0; i <= k && i <= n; i++) {
+        sum += term;
+        term = term * (n - i) / (i + 1);
+    }
+    return sum;
+}
+
+// Average ranks, 1-based, of a and b pooled; also the tie correction term sum(t^3 - t)
+void poolRanks(const std::vector<double>& a, const std::vector<double>& b,
+               double& rankSumA, double& tieTerm, bool& ties) {
+    std::vector<std::pair<double, int>> pooled;
+    for (double v : a) pooled.push_back(std::make_pair(v, 0));
+    for (double v : b) pooled.push_back(std::make_pair(v, 1));
+    std::sort(pooled.begin(), pooled.end());
+
+    rankSumA = 0;
+    tieTerm = 0;
+    ties = false;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) j++;
+        double rank = (i + 1 + j) / 2.0;
+        double t = static_cast<double>(j - i);
+        if (t > 1) {
+            ties = true;
+            tieTerm += t * t * t - t;
+        }
+        for (size_t k = i; k < j; k++) {
+            if (pooled[k].second == 0) rankSumA += rank;
+        }
+        i = j;
+    }
+}
+
+// Number of orderings of n1 + n2 untied values with each U statistic
+std::vector<double> exactUCounts(size_t n1, size_t n2) {
+    // counts[i][j][u]: built up one sample at a time
+    size_t maxU = n1 * n2;
+    std::vector<std::vector<std::vector<double>>> counts(
+        n1 + 1, std::vector<std::vector<double>>(n2 + 1, std::vector<double>(maxU + 1, 0)));
+    for (size_t i = 0; i <= n1; i++) {
+        for (size_t j = 0; j <= n2; j++) {
+            if (i == 0 || j == 0) {
+                counts[i][j][0] = 1;
+                continue;
+            }
+            for (size_t u = 0; u <= i * j; u++) {
+                // The largest value comes from a (beats all j of b) or from b
+                double fromA = u >= j ? counts[i - 1][j][u - j] : 0;
+                double fromB = counts[i][j - 1][u];
+                counts[i][j][u] = fromA + fromB;
+            }
+        }
+    }
+    return counts[n1][n2];
+}
+
+// Holm step-down adjustment, in the order of p
+std::vector<double> holm(const std::vector<double>& p) {
+    std::vector<size_t> order(p.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return p[a] < p[b]; });
+
+    std::vector<double> adjusted(p.size());
+    double running = 0;
+    for (size_t rank = 0; rank < order.size(); rank++) {
+        double value = std::min(1.0, (order.size() - rank) * p[order[rank]]);
+        running = std::max(running, value);
+        adjusted[order[rank]] = running;
+    }
+    return adjusted;
+}
+
+std::string formatSummary(const MetricSummary& s, const char* format) {
+    char buf[112];
+    char median[32], low[32], high[32];
+    snprintf(median, sizeof(median), format, s.median);
+    snprintf(low, sizeof(low), format, s.low);
+    snprintf(high, sizeof(high), format, s.high);
+    snprintf(buf, sizeof(buf), "%s [%s, %s]%s", median, low, high, s.exact ? "" : "*");
+    return buf;
+}
+}
+
+MetricSummary MetricSummary::of(std::vector<double> values, double alpha) {
+    MetricSummary summary;
+    summary.n = values.size();
+    if (values.empty()) return summary;
+
+    std::sort(values.begin(), values.end());
+    summary.median = medianOf(values);
+    summary.low = values.front();
+    summary.high = values.back();
+
+    // The interval [x(k), x(n+1-k)] covers the median with probability
+    // 1 - 2 P(B <= k-1), B ~ Binomial(n, 1/2); take the narrowest that is
+    // still wide enough
+    size_t n = values.size();
+    for (size_t k = n / 2; k >= 1; k--) {
+        if (2 * binomialHalfCdf(n, k - 1) <= alpha) {
+            summary.low = values[k - 1];
+            summary.high = values[n - k];
+            summary.exact = true;
+            break;
+        }
+    }
+    return summary;
+}
+
+double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.empty() || b.empty()) return 1.0;
+
+    double n1 = static_cast<double>(a.size());
+    double n2 = static_cast<double>(b.size());
+    double rankSumA, tieTerm;
+    bool ties;
+    poolRanks(a, b, rankSumA, tieTerm, ties);
+    double u = rankSumA - n1 * (n1 + 1) / 2;
+
+    if (!ties && a.size() <= kExactMaxSamples && b.size() <= kExactMaxSamples) {
+        std::vector<double> counts = exactUCounts(a.size(), b.size());
+        double total = 0;
+        for (double c : counts) total += c;
+        size_t observed = static_cast<size_t>(std::lround(u));
+        double lower = 0;
+        double upper = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (i <= observed) lower += counts[i];
+            if (i >= observed) upper += counts[i];
+        }
+        return std::min(1.0, 2 * std::min(lower, upper) / total);
+    }
+
+    double n = n1 + n2;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+    double z = (std::fabs(u - n1 * n2 / 2) - 0.5) / std::sqrt(variance);
+    return std::min(1.0, std::erfc(std::max(z, 0.0) / std::sqrt(2.0)));
+}
+
+double hodgesLehmann(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<double> differences;
+    differences.reserve(a.size() * b.size());
+    for (double x : a) {
+        for (double y : b) differences.push_back(y - x);
+    }
+    return medianOf(differences);
+}
+
+ProfileComparison::ProfileComparison(const ProfileMap& profiles, const CompareConfig& config)
+: m_profiles(profiles),
+  m_config(config),
+  m_cancel(false),
+  m_child(0) {
+}
+
+void ProfileComparison::cancel() {
+    m_cancel = true;
+    pid_t child = m_child;
+    if (child > 0) kill(-child, SIGTERM);
+}
+
+bool ProfileComparison::run(std::vector<CompareTrial>& trials, std::string& error,
+                            const ProgressCallback& progress) {
+    trials.clear();
+    m_cancel = false;
+
+    std::vector<const ProfileConfig*> profiles;
+    for (const auto& key : m_config.profiles) {
+        const ProfileConfig* profile = findProfile(m_profiles, key);
+        if (!profile) {
+            error = "unknown profile " + key;
+            return false;
+        }
+        profiles.push_back(profile);
+    }
+    if (profiles.size() < 2) {
+        error = "at least two profiles are needed";
+        return false;
+    }
+    if (m_config.command.empty() || m_config.trials < 1) {
+        error = "no workload command";
+        return false;
+    }
+
+    CpufreqBackend cpufreq(m_config.sysfsRoot);
+    if (cpufreq.policyCount() == 0) {
+        error = "no cpufreq policies";
+        return false;
+    }
+    std::string savedGovernor;
+    long savedMin = 0;
+    long savedMax = 0;
+    bool saved = cpufreq.readGovernor(0, savedGovernor) && cpufreq.readLimits(0, savedMin, savedMax);
+
+    // The idle temperature under the settings the board had before
+    SnapshotCollector collector(m_config.sysfsRoot, m_config.mailboxPath);
+    SystemSnapshot snapshot;
+    collector.collect(snapshot);
+    long baseline = snapshot.temperatureValid ? snapshot.temperatureMilliC : 0;
+
+    std::mt19937 random(m_config.seed);
+    std::vector<size_t> order(profiles.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+
+    bool ok = true;
+    for (int round = 0; ok && round < m_config.trials && !m_cancel; round++) {
+        std::shuffle(order.begin(), order.end(), random);
+        for (size_t index : order) {
+            if (m_cancel) break;
+
+            CompareTrial trial;
+            trial.profileId = profiles[index]->id;
+            trial.round = round;
+            if (!coolDown(collector, baseline, trial.startTempMilliC)) break;
+            if (!applyProfileHot(cpufreq, *profiles[index], error)) {
+                ok = false;
+                break;
+            }
+            if (!runTrial(collector, trial, error)) {
+                ok = error.empty();
+                break;
+            }
+            trials.push_back(trial);
+            if (progress) progress(trial);
+        }
+    }
+
+    if (saved) {
+        cpufreq.setLimits(savedMin, savedMax);
+        cpufreq.setGovernor(savedGovernor);
+    }
+    return ok;
+}
+
+bool ProfileComparison::coolDown(SnapshotCollector& collector, long baselineMilliC, long& startMilliC) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(static_cast<long>(m_config.cooldownMaxSeconds * 1000));
+    SystemSnapshot snapshot;
+    for (;;) {
+        collector.collect(snapshot);
+        startMilliC = snapshot.temperatureMilliC;
+        if (!snapshot.temperatureValid || snapshot.temperatureMilliC <= baselineMilliC + m_config.cooldownMarginMilliC ||
+            std::chrono::steady_clock::now() >= deadline) {
+            return !m_cancel;
+        }
+        for (int i = 0; i < 10 && !m_cancel; i++) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (m_cancel) return false;
+    }
+}
+
+bool ProfileComparison::runTrial(SnapshotCollector& collector, CompareTrial& trial, std::string& error) {
+    SystemSnapshot snapshot;
+    collector.collect(snapshot);   // delivered clock counts from here
+
+    // Built before fork(), the child only execs
+    std::vector<char*> argv;
+    for (const auto& arg : m_config.command) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork: ") + std::strerror(errno);
+        return false;
+    }
+    if (pid == 0) {
+        // Own process group, so cancel() reaches everything the command starts
+        setpgid(0, 0);
+
+        // The caller may block SIGINT and SIGTERM; the workload must not inherit that
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    setpgid(pid, pid);
+    m_child = pid;
+    if (m_cancel) kill(-pid, SIGTERM);   // cancel() ran before m_child was set
+
+    double clockSum = 0;
+    double tempSum = 0;
+    double weight = 0;
+    long peak = snapshot.temperatureMilliC;
+    auto lastSample = start;
+    int status = 0;
+    bool exited = false;
+
+    auto sample = [&]() {
+        auto now = std::chrono::steady_clock::now();
+        double dt = std::chrono::duration<double>(now - lastSample).count();
+        lastSample = now;
+        collector.collect(snapshot);
+
+        // Delivered clock from the counters, the requested one without them
+        double sum = 0;
+        int cores = 0;
+        for (int cpu = 0; cpu < snapshot.cpuCount && cpu < kSnapshotMaxCpus; cpu++) {
+            if (snapshot.perf[cpu].clockValid) {
+                sum += snapshot.perf[cpu].effectiveKHz;
+                cores++;
+            }
+        }
+        if (cores == 0) {
+            for (int cpu = 0; cpu < snapshot.cpuCount && cpu < kSnapshotMaxCpus; cpu++) {
+                if (snapshot.cpuFreqValid[cpu]) {
+                    sum += snapshot.cpuFreqKHz[cpu];
+                    cores++;
+                }
+            }
+        }
+        if (cores > 0) clockSum += sum / cores * dt;
+        if (snapshot.temperatureValid) {
+            tempSum += snapshot.temperatureMilliC * dt;
+            peak = std::max(peak, snapshot.temperatureMilliC);
+        }
+        weight += dt;
+
+        if (snapshot.firmwareValid && snapshot.firmware.throttledValid) {
+            trial.throttleBits |= snapshot.firmware.throttled;
+            if (snapshot.firmware.throttled & kLiveThrottleBits) trial.throttleSeconds += dt;
+        }
+    };
+
+    // Reap promptly for an accurate wall time; sample on the telemetry interval
+    while (!exited) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid || (done < 0 && errno != EINTR)) {
+            exited = true;
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSample >= std::chrono::milliseconds(m_config.sampleMs)) sample();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    trial.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_child = 0;
+    sample();
+
+    trial.meanClockKHz = weight > 0 ? static_cast<long>(clockSum / weight) : 0;
+    trial.meanTempMilliC = weight > 0 ? static_cast<long>(tempSum / weight) : snapshot.temperatureMilliC;
+    trial.peakTempMilliC = peak;
+    if (WIFEXITED(status)) trial.exitStatus = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status)) trial.exitStatus = 128 + WTERMSIG(status);
+    trial.ok = trial.exitStatus == 0;
+    return !m_cancel;
+}
+
+std::string ProfileComparison::report(const std::vector<CompareTrial>& trials) const {
+    struct Samples {
+        std::vector<double> wall, clock, peak, mean, throttle;
+        size_t failed;
+
+        Samples() : failed(0) {}
+    };
+
+    // Profiles in the configured order; failed trials are left out of the statistics
+    std::vector<std::string> ids;
+    for (const auto& key : m_config.profiles) {
+        const ProfileConfig* profile = findProfile(m_profiles, key);
+        if (profile) ids.push_back(profile->id);
+    }
+    std::map<std::string, Samples> samples;
+    for (const auto& trial : trials) {
+        Samples& s = samples[trial.profileId];
+        if (!trial.ok) {
+            s.failed++;
+            continue;
+        }
+        s.wall.push_back(trial.wallSeconds);
+        s.clock.push_back(trial.meanClockKHz / 1000.0);
+        s.peak.push_back(trial.peakTempMilliC / 1000.0);
+        s.mean.push_back(trial.meanTempMilliC / 1000.0);
+        s.throttle.push_back(trial.throttleSeconds);
+    }
+
+    std::string text;
+    char line[256];
+    double alpha = m_config.alpha;
+    snprintf(line, sizeof(line), "medians with %.0f%% confidence intervals (* fewer trials than the level needs)\n",
+             (1 - alpha) * 100);
+    text += line;
+    snprintf(line, sizeof(line), "%-9s %6s  %-26s %-26s %-23s %-23s %s\n",
+             "profile", "trials", "wall s", "clock MHz", "peak C", "mean C", "throttled s");
+    text += line;
+    for (const auto& id : ids) {
+        Samples& s = samples[id];
+        snprintf(line, sizeof(line), "%-9s %2zu/%-3zu  %-26s %-26s %-23s %-23s %s\n", id.c_str(),
+                 s.wall.size(), s.wall.size() + s.failed,
+                 formatSummary(MetricSummary::of(s.wall, alpha), "%.2f").c_str(),
+                 formatSummary(MetricSummary::of(s.clock, alpha), "%.0f").c_str(),
+                 formatSummary(MetricSummary::of(s.peak, alpha), "%.1f").c_str(),
+                 formatSummary(MetricSummary::of(s.mean, alpha), "%.1f").c_str(),
+                 formatSummary(MetricSummary::of(s.throttle, alpha), "%.1f").c_str());
+        text += line;
+    }
+    if (ids.size() < 2) return text;
+
+    // Each profile against the baseline, Holm-adjusted per metric
+    const Samples& base = samples[ids[0]];
+    std::vector<double> pWall, pClock, pPeak;
+    for (size_t i = 1; i < ids.size(); i++) {
+        const Samples& s = samples[ids[i]];
+        pWall.push_back(mannWhitneyP(base.wall, s.wall));
+        pClock.push_back(mannWhitneyP(base.clock, s.clock));
+        pPeak.push_back(mannWhitneyP(base.peak, s.peak));
+    }
+    pWall = holm(pWall);
+    pClock = holm(pClock);
+    pPeak = holm(pPeak);
+
+    snprintf(line, sizeof(line), "\nagainst %s (Mann-Whitney U, Holm-adjusted, alpha %.2f):\n", ids[0].c_str(), alpha);
+    text += line;
+    for (size_t i = 1; i < ids.size(); i++) {
+        const Samples& s = samples[ids[i]];
+        double baseWall = medianOf(base.wall);
+        double shift = hodgesLehmann(base.wall, s.wall);
+        snprintf(line, sizeof(line),
+                 "%-9s wall %+.2f s (%+.1f%%) p=%.3g %s; clock %+.0f MHz p=%.3g %s; peak %+.1f C p=%.3g %s\n",
+                 ids[i].c_str(), shift, baseWall > 0 ? shift / baseWall * 100 : 0.0, pWall[i - 1],
+                 pWall[i - 1] < alpha ? "significant" : "not significant",
+                 hodgesLehmann(base.clock, s.clock), pClock[i - 1],
+                 pClock[i - 1] < alpha ? "significant" : "not significant",
+                 hodgesLehmann(base.peak, s.peak), pPeak[i - 1],
+                 pPeak[i - 1] < alpha ? "significant" : "not significant");
+        text += line;
+    }
+
+    // The smallest two-sided p that n1 and n2 trials can give is 2 / C(n1 + n2, n1)
+    for (size_t i = 1; i < ids.size(); i++) {
+        size_t n1 = base.wall.size();
+        size_t n2 = samples[ids[i]].wall.size();
+        double orderings = 1;
+        for (size_t k = 1; k <= n1; k++) orderings = orderings * (n2 + k) / k;
+        if (2 / orderings >= alpha) {
+            text += "too few successful trials for any difference to be significant; add more with --trials\n";
+            break;
+        }
+    }
+    return text;
+}
@@ -0,0 +1,108 @@
+#ifndef OVERPI_PROFILE_COMPARE_H
+#define OVERPI_PROFILE_COMPARE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "overpi_core.h"
+#include "snapshot_collector.h"
+
+// What to compare and how often
+struct CompareConfig {
+    std::vector<std::string> profiles;   // ids or names; the first is the baseline
+    std::vector<std::string> command;    // workload argv, run with execvp; no shell
+    int trials;                          // per profile; 6 is the fewest with a 95% median interval
+    long cooldownMarginMilliC;           // start a trial within this of the idle temperature
+    double cooldownMaxSeconds;           // but never wait longer than this
+    int sampleMs;                        // telemetry interval during a trial
+    double alpha;                        // significance level
+    unsigned seed;                       // trial order shuffle
+    std::string sysfsRoot;
+    std::string mailboxPath;
+
+    CompareConfig()
+    : trials(6), cooldownMarginMilliC(2000), cooldownMaxSeconds(300), sampleMs(250),
+      alpha(0.05), seed(1), sysfsRoot("/sys"), mailboxPath("/dev/vcio") {}
+};
+
+// One run of the workload under one profile
+struct CompareTrial {
+    std::string profileId;
+    int round;                 // 0-based; every profile runs once per round
+    bool ok;                   // the command exited with status 0
+    int exitStatus;            // exit code, or 128 + signal
+    double wallSeconds;
+    long meanClockKHz;         // delivered clock when perf counters work, else scaling_cur_freq
+    long startTempMilliC;
+    long meanTempMilliC;
+    long peakTempMilliC;
+    double throttleSeconds;    // time with any live throttle bit (0xf) set
+    uint32_t throttleBits;     // OR of get_throttled over the trial
+
+    CompareTrial()
+    : round(0), ok(false), exitStatus(-1), wallSeconds(0), meanClockKHz(0),
+      startTempMilliC(0), meanTempMilliC(0), peakTempMilliC(0),
+      throttleSeconds(0), throttleBits(0) {}
+};
+
+// Median with a distribution-free confidence interval from order statistics
+struct MetricSummary {
+    size_t n;
+    double median;
+    double low;
+    double high;
+    bool exact;        // false when n is too small for the requested level
+
+    MetricSummary() : n(0), median(0), low(0), high(0), exact(false) {}
+
+    static MetricSummary of(std::vector<double> values, double alpha);
+};
+
+// Two-sided Mann-Whitney U test; exact when there are no ties and both
+// samples are small, normal approximation with tie correction otherwise
+double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b);
+
+// Hodges-Lehmann shift: median of all pairwise differences b - a
+double hodgesLehmann(const std::vector<double>& a, const std::vector<double>& b);
+
+// Runs the workload repeatedly under each profile. Every round runs each
+// profile once, in a shuffled order, so slow drift of the board (dust,
+// ambient, a warming case) spreads over all profiles instead of biasing the
+// ones that happen to run last. Before each trial the board idles until it
+// is back near the temperature it had at the start, so no trial inherits
+// the heat of the one before. The governor and limits are restored at the end.
+class ProfileComparison {
+public:
+    typedef std::function<void(const CompareTrial&)> ProgressCallback;
+
+    ProfileComparison(const ProfileMap& profiles, const CompareConfig& config = CompareConfig());
+
+    // Blocks for every trial; progress is called after each one
+    bool run(std::vector<CompareTrial>& trials, std::string& error,
+             const ProgressCallback& progress = ProgressCallback());
+
+    // Stop the running workload and the remaining trials; safe from any thread
+    void cancel();
+
+    // Medians, intervals and the significance of each profile against the baseline
+    std::string report(const std::vector<CompareTrial>& trials) const;
+
+private:
+    ProfileComparison(const ProfileComparison&) = delete;
+    ProfileComparison& operator=(const ProfileComparison&) = delete;
+
+    bool coolDown(SnapshotCollector& collector, long baselineMilliC, long& startMilliC);
+    // False when cancelled, or with error set when the workload could not start
+    bool runTrial(SnapshotCollector& collector, CompareTrial& trial, std::string& error);
+
+    ProfileMap m_profiles;
+    CompareConfig m_config;
+    std::atomic<bool> m_cancel;
+    std::atomic<pid_t> m_child;
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "profile_store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+// Events on the directory holding a profile file that may change it
+const uint32_t kFileEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// A missing file reads as empty
+bool readFile(const std::string& path, std::string& content, std::string& error) {
+    content.clear();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return true;
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) content.append(buf, n);
+    int readErrno = errno;
+    close(fd);
+    if (n < 0) {
+        error = path + ": " + std::strerror(readErrno);
+        return false;
+    }
+    return true;
+}
+
+// Whole-string integer in [low, high]
+bool parseInt(const std::string& text, long low, long high, long& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < low || parsed > high) return false;
+    value = parsed;
+    return true;
+}
+
+bool isToken(const std::string& text, size_t maxLength) {
+    if (text.empty() || text.size() > maxLength) return false;
+    for (char c : text) {
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '_')) return false;
+    }
+    return true;
+}
+
+bool isColor(const std::string& text) {
+    if (text.size() != 7 || text[0] != '#') return false;
+    for (size_t i = 1; i < text.size(); i++) {
+        if (!isxdigit(static_cast<unsigned char>(text[i]))) return false;
+    }
+    return true;
+}
+
+std::string unescape(const std::string& text) {
+    std::string result;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == 'n') {
+            result += '\n';
+            i++;
+        } else {
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+bool matchesBoard(const ProfileConfig& profile, const std::set<std::string>& boardFilters) {
+    if (profile.models.empty()) return true;
+    for (const auto& model : profile.models) {
+        if (model == "all" || boardFilters.count(model)) return true;
+    }
+    return false;
+}
+
+}
+
+ProfileStore::ProfileStore(const std::vector<std::string>& paths, const std::set<std::string>& boardFilters)
+: m_paths(paths),
+  m_boardFilters(boardFilters),
+  m_profiles(builtinProfiles()),
+  m_inotifyFd(-1) {
+}
+
+ProfileStore::~ProfileStore() {
+    unwatch();
+}
+
+std::vector<std::string> ProfileStore::defaultPaths() {
+    std::vector<std::string> paths;
+    paths.push_back("/etc/overpi/profiles.conf");
+    const char* config = getenv("XDG_CONFIG_HOME");
+    const char* home = getenv("HOME");
+    if (config && *config) {
+        paths.push_back(std::string(config) + "/overpi/profiles.conf");
+    } else if (home && *home) {
+        paths.push_back(std::string(home) + "/.config/overpi/profiles.conf");
+    }
+    return paths;
+}
+
+bool ProfileStore::parse(const std::string& text, const std::string& source,
+                         ProfileMap& profiles, int& nextOrder, std::vector<std::string>& errors) {
+    size_t errorsBefore = errors.size();
+
+    ProfileConfig current;
+    bool inSection = false;
+    bool sectionOk = true;
+    bool hasArm = false;
+    bool hasGpu = false;
+    bool hasLimit = false;
+    int sectionLine = 0;
+
+    auto finish = [&]() {
+        if (!inSection) return;
+        std::string where = source + ":" + std::to_string(sectionLine) + ": ";
+        if (sectionOk && !(hasArm && hasGpu && hasLimit)) {
+            errors.push_back(where + "new profile " + current.id + " needs arm_freq, gpu_freq and temp_limit");
+            sectionOk = false;
+        }
+        if (sectionOk) {
+            if (current.name.empty()) current.name = current.id;
+            profiles[current.id] = current;
+        } else {
+            errors.push_back(where + "profile " + current.id + " skipped");
+        }
+        inSection = false;
+    };
+
+    std::istringstream lines(text);
+    std::string raw;
+    int lineNumber = 0;
+    while (std::getline(lines, raw)) {
+        lineNumber++;
+        std::string line = trim(raw);
+        if (line.empty() || line[0] == '#') continue;
+        std::string where = source + ":" + std::to_string(lineNumber) + ": ";
+
+        if (line[0] == '[') {
+            finish();
+            if (line[line.size() - 1] != ']') {
+                errors.push_back(where + "unterminated section header");
+                continue;
+            }
+            std::string id = trim(line.substr(1, line.size() - 2));
+            inSection = true;
+            sectionOk = isToken(id, 32);
+            sectionLine = lineNumber;
+            if (!sectionOk) {
+                errors.push_back(where + "profile id '" + id + "' must be 1-32 of a-z, 0-9, - and _");
+                current = ProfileConfig();
+                current.id = id;
+                continue;
+            }
+
+            // A known profile is amended, a new one starts empty
+            auto known = profiles.find(id);
+            bool exists = known != profiles.end();
+            current = exists ? known->second : ProfileConfig();
+            current.id = id;
+            if (!exists) current.order = nextOrder++;
+            hasArm = hasGpu = hasLimit = exists;
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            errors.push_back(where + "expected key = value");
+            if (inSection) sectionOk = false;
+            continue;
+        }
+        if (!inSection) {
+            errors.push_back(where + "setting outside a [profile] section");
+            continue;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        long number = 0;
+        bool valid = true;
+        std::string range;
+        if (key == "name") {
+            valid = !value.empty();
+            current.name = value;
+        } else if (key == "description") {
+            current.desc = unescape(value);
+        } else if (key == "color") {
+            valid = isColor(value);
+            range = "#rrggbb";
+            current.color = value;
+        } else if (key == "arm_freq") {
+            valid = parseInt(value, 600, 3000, number);
+            range = "600-3000 MHz";
+            current.armFreqMHz = number;
+            hasArm = true;
+        } else if (key == "gpu_freq") {
+            valid = parseInt(value, 250, 1100, number);
+            range = "250-1100 MHz";
+            current.gpuFreqMHz = number;
+            hasGpu = true;
+        } else if (key == "over_voltage") {
+            valid = parseInt(value, -16, 8, number);
+            range = "-16 to 8 steps";
+            current.overVoltage = static_cast<int>(number);
+        } else if (key == "force_turbo") {
+            valid = parseInt(value, 0, 1, number);
+            range = "0 or 1";
+            current.forceTurbo = number != 0;
+        } else if (key == "temp_limit") {
+            valid = parseInt(value, 40, 85, number);
+            range = "40-85 °C";
+            current.tempLimitMilliC = number * 1000;
+            hasLimit = true;
+        } else if (key == "models") {
+            current.models.clear();
+            std::istringstream words(value);
+            std::string word;
+            while (words >> word) {
+                if (!isToken(word, 16)) valid = false;
+                current.models.insert(word);
+            }
+            range = "config.txt filters such as pi4 pi400";
+        } else {
+            errors.push_back(where + "unknown key " + key);
+            sectionOk = false;
+            continue;
+        }
+
+        if (!valid) {
+            errors.push_back(where + key + " = " + value + " is invalid (" + (range.empty() ? "empty" : range) + ")");
+            sectionOk = false;
+        }
+    }
+    finish();
+
+    return errors.size() == errorsBefore;
+}
+
+bool ProfileStore::load() {
+    ProfileMap profiles = builtinProfiles();
+    std::vector<std::string> errors;
+    int nextOrder = 0;
+    for (const auto& entry : profiles) nextOrder = std::max(nextOrder, entry.second.order + 1);
+
+    for (const auto& path : m_paths) {
+        std::string text;
+        std::string error;
+        if (!readFile(path, text, error)) {
+            errors.push_back(error);
+            continue;
+        }
+        parse(text, path, profiles, nextOrder, errors);
+    }
+
+    // Profiles meant for other boards are not offered at all
+    for (auto it = profiles.begin(); it != profiles.end();) {
+        if (matchesBoard(it->second, m_boardFilters)) {
+            ++it;
+        } else {
+            it = profiles.erase(it);
+        }
+    }
+
+    m_profiles.swap(profiles);
+    m_errors.swap(errors);
+    return m_errors.empty();
+}
+
+bool ProfileStore::watch() {
+    unwatch();
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) return false;
+    addWatches();
+    return true;
+}
+
+void ProfileStore::addWatches() {
+    auto split = [](const std::string& path, std::string& dir, std::string& name) {
+        size_t slash = path.rfind('/');
+        dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+    };
+
+    // Two paths may share a directory; IN_MASK_ADD keeps both masks
+    std::vector<Watch> watches;
+    for (const auto& path : m_paths) {
+        Watch watch;
+        watch.waiting = false;
+        std::string dir;
+        split(path, dir, watch.name);
+        for (;;) {
+            uint32_t mask = watch.waiting ? IN_CREATE | IN_MOVED_TO : kFileEvents;
+            watch.wd = inotify_add_watch(m_inotifyFd, dir.c_str(), mask | IN_MASK_ADD);
+            if (watch.wd >= 0 || errno != ENOENT || dir == "/" || dir == ".") break;
+            std::string parent = dir;
+            split(parent, dir, watch.name);
+            watch.waiting = true;
+        }
+        if (watch.wd >= 0) watches.push_back(watch);
+    }
+
+    // Ancestors no longer waited on
+    for (const auto& old : m_watches) {
+        bool kept = false;
+        for (const auto& watch : watches) kept = kept || watch.wd == old.wd;
+        if (!kept) inotify_rm_watch(m_inotifyFd, old.wd);
+    }
+    m_watches.swap(watches);
+}
+
+void ProfileStore::unwatch() {
+    if (m_inotifyFd >= 0) {
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+    m_watches.clear();
+}
+
+bool ProfileStore::consume() {
+    if (m_inotifyFd < 0) return false;
+
+    bool changed = false;
+    bool rewatch = false;
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = read(m_inotifyFd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+            for (const auto& watch : m_watches) {
+                if (watch.wd != event->wd) continue;
+                if (event->mask & IN_IGNORED) {
+                    // The watched directory itself went away
+                    rewatch = true;
+                } else if (event->len > 0 && watch.name == event->name) {
+                    if (watch.waiting && (event->mask & (IN_CREATE | IN_MOVED_TO))) rewatch = true;
+                    else if (!watch.waiting && (event->mask & kFileEvents)) changed = true;
+                }
+            }
+        }
+    }
+
+    // The file may already be in a directory that just appeared
+    if (rewatch) {
+        addWatches();
+        changed = true;
+    }
+
+    // Several events from one save collapse into one reload
+    if (changed) load();
+    return changed;
+}
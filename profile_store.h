@@ -0,0 +1,89 @@
+#ifndef OVERPI_PROFILE_STORE_H
+#define OVERPI_PROFILE_STORE_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "overpi_core.h"
+
+// Profiles from the built-in set overlaid with profile files, in order:
+// the system file, then the user's. A file holds one section per profile:
+//
+//   [cluster]
+//   name = Cluster
+//   arm_freq = 2100
+//   gpu_freq = 600
+//   over_voltage = 6
+//   force_turbo = 0
+//   temp_limit = 72
+//   models = pi4 pi400
+//   color = #8e44ad
+//   description = Tuned for the build cluster\nKeep the fans on
+//
+// Clocks are in MHz, over_voltage in 25 mV steps and temp_limit in °C.
+// models is optional: config.txt filters, one of which the board must match.
+// Lines starting with # are comments.
+//
+// A section named after a known profile changes only the keys it sets; a
+// new one needs at least arm_freq, gpu_freq and temp_limit. Values are range checked
+// and a section with any bad value is skipped as a whole. Profiles whose
+// models do not match this board are left out.
+//
+// watch() puts inotify watches on the directories holding the files, so
+// editors that write a new file and rename it over the old are seen too.
+// While a directory does not exist, its nearest existing ancestor is
+// watched instead, so creating ~/.config/overpi later is picked up.
+class ProfileStore {
+public:
+    // /etc/overpi/profiles.conf and $XDG_CONFIG_HOME/overpi/profiles.conf
+    static std::vector<std::string> defaultPaths();
+
+    explicit ProfileStore(const std::vector<std::string>& paths = defaultPaths(),
+                          const std::set<std::string>& boardFilters = detectBoardFilters());
+    ~ProfileStore();
+
+    // Rebuild the profiles from the built-in set and the files. Returns false
+    // when a file could not be read or had invalid sections; errors says
+    // where. The profiles that were valid are loaded either way.
+    bool load();
+
+    // Parse one file's text into profiles; source prefixes the errors and
+    // new profiles are numbered from nextOrder
+    static bool parse(const std::string& text, const std::string& source,
+                      ProfileMap& profiles, int& nextOrder, std::vector<std::string>& errors);
+
+    const ProfileMap& profiles() const { return m_profiles; }
+    const std::set<std::string>& boardFilters() const { return m_boardFilters; }
+    const std::vector<std::string>& errors() const { return m_errors; }
+
+    bool watch();
+    void unwatch();
+    int fd() const { return m_inotifyFd; }
+
+    // Drain pending events; reloads and returns true when a file changed
+    bool consume();
+
+private:
+    ProfileStore(const ProfileStore&) = delete;
+    ProfileStore& operator=(const ProfileStore&) = delete;
+
+    // One per path: the directory holding the file, or while that is
+    // missing, the nearest existing ancestor and the component awaited there
+    struct Watch {
+        int wd;
+        std::string name;
+        bool waiting;
+    };
+
+    void addWatches();
+
+    std::vector<std::string> m_paths;
+    std::set<std::string> m_boardFilters;
+    ProfileMap m_profiles;
+    std::vector<std::string> m_errors;
+    int m_inotifyFd;
+    std::vector<Watch> m_watches;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "residency_tracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+double ResidencyStats::frequencyPercent(long kHz) const {
+    auto it = frequencyMs.find(kHz);
+    if (it == frequencyMs.end() || frequencyTotalMs == 0) return 0;
+    return 100.0 * it->second / frequencyTotalMs;
+}
+
+double ResidencyStats::throttlePercent(int flag) const {
+    return observedMs ? 100.0 * throttleMs[flag] / observedMs : 0;
+}
+
+double ResidencyStats::anyThrottlePercent() const {
+    return observedMs ? 100.0 * anyThrottleMs / observedMs : 0;
+}
+
+ResidencyTracker::ResidencyTracker(const std::string& sysfsRoot)
+: m_profile("boot"),
+  m_buffer(8192),
+  m_lastNs(0),
+  m_lastThrottle(0),
+  m_lastThrottleValid(false),
+  m_lastCpuCount(0) {
+    std::string dir = sysfsRoot + "/devices/system/cpu/cpufreq";
+    DIR* d = opendir(dir.c_str());
+    if (d) {
+        while (struct dirent* entry = readdir(d)) {
+            if (std::strncmp(entry->d_name, "policy", 6) != 0) continue;
+            std::string path = dir + "/" + entry->d_name + "/stats/time_in_state";
+            Policy policy;
+            policy.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (policy.fd < 0) {
+                // Partial coverage would skew the averages
+                for (const auto& p : m_policies) close(p.fd);
+                m_policies.clear();
+                break;
+            }
+            m_policies.push_back(policy);
+        }
+        closedir(d);
+    }
+
+    // Baseline so that only time from now on is counted
+    std::map<long, uint64_t> ignored;
+    for (auto& policy : m_policies) readTimeInState(policy, ignored);
+    for (int i = 0; i < kSnapshotMaxCpus; i++) m_lastCpuKHz[i] = 0;
+}
+
+ResidencyTracker::~ResidencyTracker() {
+    for (const auto& policy : m_policies) close(policy.fd);
+}
+
+bool ResidencyTracker::readTimeInState(Policy& policy, std::map<long, uint64_t>& deltaMs) {
+    ssize_t n = pread(policy.fd, m_buffer.data(), m_buffer.size() - 1, 0);
+    if (n <= 0) return false;
+    m_buffer[n] = '\0';
+
+    // "<kHz> <time in 10 ms units>" per line
+    const char* p = m_buffer.data();
+    while (*p) {
+        char* end;
+        long kHz = strtol(p, &end, 10);
+        if (end == p) break;
+        p = end;
+        uint64_t ms = strtoull(p, &end, 10) * 10;
+        if (end == p) break;
+        p = end;
+
+        uint64_t& last = policy.lastMs[kHz];
+        if (ms > last) deltaMs[kHz] += ms - last;
+        last = ms;
+    }
+    return true;
+}
+
+void ResidencyTracker::takeTimeInState(ResidencyStats& stats) {
+    std::map<long, uint64_t> deltaMs;
+    for (auto& policy : m_policies) readTimeInState(policy, deltaMs);
+
+    size_t count = m_policies.size();
+    for (const auto& entry : deltaMs) {
+        uint64_t ms = entry.second / count;
+        stats.frequencyMs[entry.first] += ms;
+        stats.frequencyTotalMs += ms;
+    }
+}
+
+void ResidencyTracker::setProfile(const std::string& profileId) {
+    if (!m_policies.empty()) takeTimeInState(m_stats[m_profile]);
+    m_profile = profileId;
+    m_stats[m_profile];
+}
+
+void ResidencyTracker::update(const SystemSnapshot& snapshot) {
+    ResidencyStats& stats = m_stats[m_profile];
+    int64_t now = snapshot.monotonicNs;
+    uint64_t elapsedMs = m_lastNs != 0 && now > m_lastNs ? static_cast<uint64_t>((now - m_lastNs) / 1000000) : 0;
+
+    if (!m_policies.empty()) {
+        takeTimeInState(stats);
+    } else if (elapsedMs > 0 && m_lastCpuCount > 0) {
+        // Hold each core's previous clock for the elapsed time
+        uint64_t share = elapsedMs / m_lastCpuCount;
+        for (int cpu = 0; cpu < m_lastCpuCount; cpu++) {
+            if (m_lastCpuKHz[cpu] <= 0) continue;
+            stats.frequencyMs[m_lastCpuKHz[cpu]] += share;
+            stats.frequencyTotalMs += share;
+        }
+    }
+
+    if (elapsedMs > 0 && m_lastThrottleValid) {
+        stats.observedMs += elapsedMs;
+        for (int flag = 0; flag < THROTTLE_FLAG_COUNT; flag++) {
+            if (m_lastThrottle & (1u << flag)) stats.throttleMs[flag] += elapsedMs;
+        }
+        if (m_lastThrottle & 0xF) stats.anyThrottleMs += elapsedMs;
+    }
+
+    m_lastNs = now;
+    m_lastThrottleValid = snapshot.firmwareValid && snapshot.firmware.throttledValid;
+    m_lastThrottle = m_lastThrottleValid ? snapshot.firmware.throttled : 0;
+    m_lastCpuCount = std::min(snapshot.cpuCount, kSnapshotMaxCpus);
+    for (int cpu = 0; cpu < m_lastCpuCount; cpu++) {
+        m_lastCpuKHz[cpu] = snapshot.cpuFreqValid[cpu] ? snapshot.cpuFreqKHz[cpu] : 0;
+    }
+}
+
+std::string ResidencyTracker::format(const std::string& profileId, const ResidencyStats& stats) {
+    std::string text = profileId + ":\n";
+    char line[96];
+
+    for (auto it = stats.frequencyMs.rbegin(); it != stats.frequencyMs.rend(); ++it) {
+        if (it->second == 0) continue;
+        snprintf(line, sizeof(line), "  %5ld MHz  %5.1f %%\n", it->first / 1000, stats.frequencyPercent(it->first));
+        text += line;
+    }
+
+    static const char* const names[THROTTLE_FLAG_COUNT] = {
+        "under-voltage", "frequency capped", "throttled", "soft temperature limit"
+    };
+    snprintf(line, sizeof(line), "  any throttling  %5.1f %% of %.0f s\n", stats.anyThrottlePercent(), stats.observedMs / 1000.0);
+    text += line;
+    for (int flag = 0; flag < THROTTLE_FLAG_COUNT; flag++) {
+        if (stats.throttleMs[flag] == 0) continue;
+        snprintf(line, sizeof(line), "    %s  %5.1f %%\n", names[flag], stats.throttlePercent(flag));
+        text += line;
+    }
+    return text;
+}
@@ -0,0 +1,90 @@
+#ifndef OVERPI_RESIDENCY_TRACKER_H
+#define OVERPI_RESIDENCY_TRACKER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "system_snapshot.h"
+
+// get_throttled bits whose time is accounted
+enum ThrottleFlagIndex {
+    THROTTLE_UNDER_VOLTAGE = 0,   // 0x1
+    THROTTLE_FREQ_CAPPED = 1,     // 0x2
+    THROTTLE_THROTTLED = 2,       // 0x4
+    THROTTLE_SOFT_TEMP = 3,       // 0x8
+    THROTTLE_FLAG_COUNT = 4
+};
+
+// Where the time went while one profile was active
+struct ResidencyStats {
+    std::map<long, uint64_t> frequencyMs;     // kHz -> time, averaged over policies
+    uint64_t frequencyTotalMs;
+    uint64_t observedMs;                      // time covered by throttle sampling
+    uint64_t throttleMs[THROTTLE_FLAG_COUNT];
+    uint64_t anyThrottleMs;                   // any of the four bits set
+
+    ResidencyStats() : frequencyTotalMs(0), observedMs(0), anyThrottleMs(0) {
+        for (int i = 0; i < THROTTLE_FLAG_COUNT; i++) throttleMs[i] = 0;
+    }
+
+    double frequencyPercent(long kHz) const;
+    double throttlePercent(int flag) const;
+    double anyThrottlePercent() const;
+};
+
+// Accumulates frequency residency and time spent with throttle bits set,
+// per applied profile. Residency comes from cpufreq/stats/time_in_state of
+// every policy; where the kernel lacks cpufreq stats, the sampled clock of
+// each core is held until the next snapshot instead. Throttle bits are
+// likewise held from one get_throttled reading to the next.
+// Not thread-safe.
+class ResidencyTracker {
+public:
+    explicit ResidencyTracker(const std::string& sysfsRoot = "/sys");
+    ~ResidencyTracker();
+
+    // Time from now on is charged to this profile. Clock residency up to now
+    // is settled from time_in_state first, so it stays with the previous
+    // profile; held values (no cpufreq stats, throttle bits) switch at the
+    // next update.
+    void setProfile(const std::string& profileId);
+    const std::string& profile() const { return m_profile; }
+
+    void update(const SystemSnapshot& snapshot);
+
+    // True when time_in_state is available for every policy
+    bool kernelStats() const { return !m_policies.empty(); }
+
+    const std::map<std::string, ResidencyStats>& stats() const { return m_stats; }
+
+    // Multi-line summary: time at each clock and time throttled
+    static std::string format(const std::string& profileId, const ResidencyStats& stats);
+
+private:
+    ResidencyTracker(const ResidencyTracker&) = delete;
+    ResidencyTracker& operator=(const ResidencyTracker&) = delete;
+
+    struct Policy {
+        int fd;
+        std::map<long, uint64_t> lastMs;   // cumulative time_in_state
+    };
+
+    bool readTimeInState(Policy& policy, std::map<long, uint64_t>& deltaMs);
+    void takeTimeInState(ResidencyStats& stats);
+
+    std::vector<Policy> m_policies;
+    std::map<std::string, ResidencyStats> m_stats;
+    std::string m_profile;
+    std::vector<char> m_buffer;
+
+    // Previous snapshot, for the sample-and-hold accounting
+    int64_t m_lastNs;
+    uint32_t m_lastThrottle;
+    bool m_lastThrottleValid;
+    int m_lastCpuCount;
+    long m_lastCpuKHz[kSnapshotMaxCpus];
+};
+
+#endif
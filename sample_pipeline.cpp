@@ -0,0 +1,72 @@
+#include "sample_pipeline.h"
+
+#include <algorithm>
+
+SamplePipeline::SamplePipeline(const SchedulerConfig& schedulerConfig)
+: m_scheduler(schedulerConfig),
+  m_history(nullptr),
+  m_metrics(nullptr),
+  m_fleet(nullptr) {
+}
+
+GovernorConfig SamplePipeline::governorConfig(const ProfileConfig& profile) {
+    GovernorConfig config;
+    config.tempLimitMilliC = profile.tempLimitMilliC;
+    config.maxFreqKHz = profile.armFreqMHz * 1000;
+    config.minFreqKHz = std::min(config.minFreqKHz, config.maxFreqKHz);
+    return config;
+}
+
+int SamplePipeline::sample(SystemSnapshot& snapshot) {
+    // Blocking I/O, done before taking the lock
+    m_collector.collect(snapshot);
+
+    int intervalMs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_governor.isEngaged() && snapshot.temperatureValid) {
+            m_governor.update(snapshot.temperatureMilliC, snapshot.monotonicNs);
+        }
+        snapshot.governorEngaged = m_governor.isEngaged();
+        snapshot.governorCeilingKHz = m_governor.ceilingKHz();
+        if (m_history) m_history->append(snapshot);
+        m_residency.update(snapshot);
+        m_throttle.update(snapshot);
+
+        // Sleep longer when cool and idle, shorter near the limit
+        intervalMs = m_scheduler.nextIntervalMs(snapshot);
+    }
+
+    m_recorder.append(snapshot);
+    if (m_metrics) m_metrics->update(snapshot);
+    if (m_fleet) m_fleet->publish(snapshot);
+    return intervalMs;
+}
+
+bool SamplePipeline::applyProfile(const ProfileConfig& profile, std::string& error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!applyProfileHot(m_cpufreq, profile, error)) return false;
+
+    m_residency.setProfile(profile.id);
+    m_scheduler.setTempLimit(profile.tempLimitMilliC);
+    if (m_metrics) m_metrics->setProfile(profile.id);
+    if (m_fleet) m_fleet->setProfile(profile.id);
+
+    // The hot profile pins the floor; hand the ceiling back to the governor,
+    // which restores this profile's limits when released
+    if (m_governor.isEngaged()) {
+        m_governor.adoptCurrentLimits();
+        m_governor.engage(governorConfig(profile));
+    }
+    return true;
+}
+
+bool SamplePipeline::engageGovernor(const ProfileConfig& profile) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_governor.engage(governorConfig(profile));
+}
+
+void SamplePipeline::releaseGovernor() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_governor.release();
+}
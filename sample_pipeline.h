@@ -0,0 +1,81 @@
+#ifndef OVERPI_SAMPLE_PIPELINE_H
+#define OVERPI_SAMPLE_PIPELINE_H
+
+#include <mutex>
+#include <string>
+
+#include "cpufreq_backend.h"
+#include "fleet_publisher.h"
+#include "history_buffer.h"
+#include "metrics_exporter.h"
+#include "overpi_core.h"
+#include "residency_tracker.h"
+#include "sample_scheduler.h"
+#include "snapshot_collector.h"
+#include "system_snapshot.h"
+#include "telemetry_log.h"
+#include "thermal_governor.h"
+#include "throttle_tracker.h"
+
+// The sampling pass shared by the GUI and the daemon: collect a snapshot,
+// let the governor regulate, then feed the residency and throttle
+// trackers, the recorder and the consumers the frontend attached.
+//
+// sample() runs on one thread; hot applies and governor changes may come
+// from another. Both serialize on mutex(), which also guards the trackers
+// and the history for readers on other threads. Holding it across every
+// cpufreq write keeps the governor's ceiling writes from landing between
+// the ordered min/max writes of a hot apply.
+class SamplePipeline {
+public:
+    explicit SamplePipeline(const SchedulerConfig& schedulerConfig = SchedulerConfig());
+
+    // Optional consumers owned by the frontend; attach before sampling
+    void setHistory(HistoryBuffer* history) { m_history = history; }
+    void setMetrics(MetricsExporter* metrics) { m_metrics = metrics; }
+    void setFleet(FleetPublisher* fleet) { m_fleet = fleet; }
+
+    // Collect and distribute one snapshot; returns the interval to wait
+    // before the next one
+    int sample(SystemSnapshot& snapshot);
+
+    // Pin the profile's clock and charge time to it from now on. An engaged
+    // governor carries on from this profile. On failure error holds a
+    // translated message.
+    bool applyProfile(const ProfileConfig& profile, std::string& error);
+
+    // Regulate below the profile's temp_limit, up to its arm_freq
+    bool engageGovernor(const ProfileConfig& profile);
+    void releaseGovernor();
+
+    std::mutex& mutex() { return m_mutex; }
+    SnapshotCollector& collector() { return m_collector; }
+    SampleScheduler& scheduler() { return m_scheduler; }
+    TelemetryWriter& recorder() { return m_recorder; }
+
+    // Hold mutex() to use these off the sampling thread
+    ResidencyTracker& residency() { return m_residency; }
+    const ResidencyTracker& residency() const { return m_residency; }
+    ThrottleTracker& throttle() { return m_throttle; }
+    const ThrottleTracker& throttle() const { return m_throttle; }
+
+private:
+    SamplePipeline(const SamplePipeline&) = delete;
+    SamplePipeline& operator=(const SamplePipeline&) = delete;
+
+    static GovernorConfig governorConfig(const ProfileConfig& profile);
+
+    std::mutex m_mutex;
+    SnapshotCollector m_collector;
+    CpufreqBackend m_cpufreq;
+    ThermalGovernor m_governor;
+    ResidencyTracker m_residency;
+    ThrottleTracker m_throttle;
+    TelemetryWriter m_recorder;
+    SampleScheduler m_scheduler;
+    HistoryBuffer* m_history;
+    MetricsExporter* m_metrics;
+    FleetPublisher* m_fleet;
+};
+
+#endif
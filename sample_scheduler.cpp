@@ -0,0 +1,145 @@
+#include "sample_scheduler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+SampleScheduler::SampleScheduler(const SchedulerConfig& config, const std::string& procRoot)
+: m_config(config),
+  m_tempLimitMilliC(80000),
+  m_epollFd(epoll_create1(EPOLL_CLOEXEC)),
+  m_timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+  m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+  m_ueventFd(socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT)),
+  m_busy(procRoot),
+  m_lastThrottle(0),
+  m_lastTempMilliC(0),
+  m_lastNs(0),
+  m_fastUntilNs(0) {
+    // Kernel uevents; without them trip points are only seen by sampling
+    if (m_ueventFd >= 0) {
+        struct sockaddr_nl addr = {};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = 1;
+        if (bind(m_ueventFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(m_ueventFd);
+            m_ueventFd = -1;
+        }
+    }
+
+    int fds[] = {m_timerFd, m_wakeFd, m_ueventFd};
+    for (int fd : fds) {
+        if (fd < 0 || m_epollFd < 0) continue;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+SampleScheduler::~SampleScheduler() {
+    int fds[] = {m_epollFd, m_timerFd, m_wakeFd, m_ueventFd};
+    for (int fd : fds) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+int SampleScheduler::nextIntervalMs(const SystemSnapshot& snapshot) {
+    int64_t now = snapshot.monotonicNs;
+    int busy = 100;
+    bool loadKnown = m_busy.read(busy);
+
+    // A change in any throttle bit keeps sampling fast for a while
+    if (snapshot.firmwareValid && snapshot.firmware.throttledValid) {
+        uint32_t throttle = snapshot.firmware.throttled;
+        if (m_lastNs != 0 && throttle != m_lastThrottle) {
+            m_fastUntilNs = now + static_cast<int64_t>(m_config.holdFastMs) * 1000000;
+        }
+        m_lastThrottle = throttle;
+    }
+
+    double risingCPerSec = 0;
+    if (snapshot.temperatureValid) {
+        if (m_lastNs != 0 && now > m_lastNs) {
+            risingCPerSec = (snapshot.temperatureMilliC - m_lastTempMilliC) / 1000.0 / ((now - m_lastNs) / 1e9);
+        }
+        m_lastTempMilliC = snapshot.temperatureMilliC;
+    }
+    m_lastNs = now;
+
+    if (now < m_fastUntilNs) return m_config.fastMs;
+    if (!snapshot.temperatureValid) return m_config.normalMs;
+
+    int interval;
+    long headroom = m_tempLimitMilliC - snapshot.temperatureMilliC;
+    if (headroom <= m_config.hotMarginMilliC) {
+        interval = m_config.fastMs;
+    } else if (headroom < m_config.warmMarginMilliC) {
+        double t = static_cast<double>(headroom - m_config.hotMarginMilliC) / (m_config.warmMarginMilliC - m_config.hotMarginMilliC);
+        interval = m_config.fastMs + static_cast<int>(t * (m_config.normalMs - m_config.fastMs));
+    } else if (loadKnown && busy < m_config.idlePercent) {
+        interval = m_config.slowMs;
+    } else {
+        interval = m_config.normalMs;
+    }
+
+    if (risingCPerSec >= m_config.risingCPerSec) interval = std::min(interval, 500);
+    return interval;
+}
+
+void SampleScheduler::arm(int intervalMs) {
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = intervalMs / 1000;
+    spec.it_value.tv_nsec = (intervalMs % 1000) * 1000000L;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+    timerfd_settime(m_timerFd, 0, &spec, nullptr);
+}
+
+int SampleScheduler::wait() {
+    for (;;) {
+        struct epoll_event ev;
+        int n = epoll_wait(m_epollFd, &ev, 1, -1);
+        if (n < 0 && errno != EINTR) return WAKE_NONE;
+        int reason = consume();
+        if (reason != WAKE_NONE) return reason;
+    }
+}
+
+int SampleScheduler::consume() {
+    int reason = WAKE_NONE;
+    uint64_t count;
+
+    if (read(m_timerFd, &count, sizeof(count)) == sizeof(count)) reason |= WAKE_TIMER;
+    if (read(m_wakeFd, &count, sizeof(count)) == sizeof(count)) reason |= WAKE_REQUEST;
+
+    if (m_ueventFd >= 0) {
+        // "change@/devices/virtual/thermal/thermal_zone0\0ACTION=change\0SUBSYSTEM=thermal\0..."
+        char buf[2048];
+        ssize_t n;
+        while ((n = recv(m_ueventFd, buf, sizeof(buf) - 1, 0)) > 0) {
+            buf[n] = '\0';
+            for (char* p = buf; p < buf + n; p += strlen(p) + 1) {
+                if (strcmp(p, "SUBSYSTEM=thermal") == 0) {
+                    reason |= WAKE_THERMAL;
+                    break;
+                }
+            }
+        }
+    }
+    return reason;
+}
+
+void SampleScheduler::wake() {
+    uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+        // Counter overflow only; a wake is already pending
+    }
+}
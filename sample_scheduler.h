@@ -0,0 +1,90 @@
+#ifndef OVERPI_SAMPLE_SCHEDULER_H
+#define OVERPI_SAMPLE_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "cpu_busy.h"
+#include "system_snapshot.h"
+
+// Sampling intervals and the thresholds that select them
+struct SchedulerConfig {
+    int slowMs;              // cool and idle
+    int normalMs;            // cool but busy
+    int fastMs;              // close to the limit or throttling
+    long hotMarginMilliC;    // within this of the limit: fastMs
+    long warmMarginMilliC;   // from here to hot the interval shrinks linearly
+    int idlePercent;         // CPU busy below this counts as idle
+    int holdFastMs;          // stay fast this long after the throttle bits change
+    double risingCPerSec;    // faster warming caps the interval at 500 ms
+
+    SchedulerConfig()
+    : slowMs(5000), normalMs(2000), fastMs(100),
+      hotMarginMilliC(5000), warmMarginMilliC(15000),
+      idlePercent(10), holdFastMs(5000), risingCPerSec(1.0) {}
+};
+
+// Adaptive timer for the collector. After each snapshot nextIntervalMs()
+// picks how long to sleep from the temperature headroom to the profile's
+// temp_limit, the temperature trend, throttle bit changes and CPU load.
+// The wait ends early on wake() or on a thermal uevent from the kernel,
+// so trip points are seen without polling for them.
+//
+// Everything waits on one epoll descriptor (timerfd, eventfd and the
+// uevent socket); wait() blocks on it for a worker thread, and an event
+// loop can watch fd() and call consume() instead.
+class SampleScheduler {
+public:
+    enum WakeReason {
+        WAKE_NONE = 0,
+        WAKE_TIMER = 1,
+        WAKE_REQUEST = 2,
+        WAKE_THERMAL = 4
+    };
+
+    explicit SampleScheduler(const SchedulerConfig& config = SchedulerConfig(),
+                             const std::string& procRoot = "/proc");
+    ~SampleScheduler();
+
+    // Thread-safe; the profile limit the headroom is measured against
+    void setTempLimit(long milliC) { m_tempLimitMilliC = milliC; }
+
+    // Interval to use after this snapshot
+    int nextIntervalMs(const SystemSnapshot& snapshot);
+
+    // Start a one-shot timer
+    void arm(int intervalMs);
+
+    // Block until the timer, wake() or a thermal event; returns WakeReason bits
+    int wait();
+
+    // Drain pending events without blocking
+    int consume();
+
+    // Thread-safe; ends the current wait
+    void wake();
+
+    int fd() const { return m_epollFd; }
+    bool thermalEvents() const { return m_ueventFd >= 0; }
+
+private:
+    SampleScheduler(const SampleScheduler&) = delete;
+    SampleScheduler& operator=(const SampleScheduler&) = delete;
+
+    SchedulerConfig m_config;
+    std::atomic<long> m_tempLimitMilliC;
+    int m_epollFd;
+    int m_timerFd;
+    int m_wakeFd;
+    int m_ueventFd;
+    CpuBusyReader m_busy;
+
+    // State carried between snapshots
+    uint32_t m_lastThrottle;
+    long m_lastTempMilliC;
+    int64_t m_lastNs;
+    int64_t m_fastUntilNs;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "sensor_sampler.h"
+
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool parseSysfsInt(const char* buf, size_t len, long& value) {
+    size_t i = 0;
+    while (i < len && (buf[i] == ' ' || buf[i] == '\t')) i++;
+
+    bool negative = false;
+    if (i < len && (buf[i] == '-' || buf[i] == '+')) {
+        negative = (buf[i] == '-');
+        i++;
+    }
+
+    size_t digits = 0;
+    unsigned long result = 0;
+    const unsigned long limit = negative ? static_cast<unsigned long>(LONG_MAX) + 1 : LONG_MAX;
+    while (i < len && buf[i] >= '0' && buf[i] <= '9') {
+        unsigned long digit = static_cast<unsigned long>(buf[i] - '0');
+        if (result > (limit - digit) / 10) return false;
+        result = result * 10 + digit;
+        i++;
+        digits++;
+    }
+    if (digits == 0) return false;
+
+    // Only whitespace may follow the number
+    while (i < len) {
+        if (buf[i] != '\n' && buf[i] != ' ' && buf[i] != '\t' && buf[i] != '\r' && buf[i] != '\0') return false;
+        i++;
+    }
+
+    value = negative ? static_cast<long>(0 - result) : static_cast<long>(result);
+    return true;
+}
+
+SensorSampler::SensorSampler(const std::string& sysfsRoot)
+: m_root(sysfsRoot),
+  m_tempFd(-1) {
+    m_tempFd = openNode("/class/thermal/thermal_zone0/temp");
+
+    // Enumerate cores until the first missing cpuN directory
+    for (int cpu = 0; cpu < kMaxCpus; cpu++) {
+        std::string cpuDir = "/devices/system/cpu/cpu" + std::to_string(cpu);
+        if (access((m_root + cpuDir).c_str(), F_OK) != 0) break;
+
+        CpuNodes nodes;
+        nodes.curFd = openNode(cpuDir + "/cpufreq/scaling_cur_freq");
+        nodes.minFd = openNode(cpuDir + "/cpufreq/scaling_min_freq");
+        nodes.maxFd = openNode(cpuDir + "/cpufreq/scaling_max_freq");
+        nodes.govFd = openNode(cpuDir + "/cpufreq/scaling_governor");
+        m_cpus.push_back(nodes);
+    }
+}
+
+SensorSampler::~SensorSampler() {
+    if (m_tempFd >= 0) close(m_tempFd);
+    for (const auto& nodes : m_cpus) {
+        if (nodes.curFd >= 0) close(nodes.curFd);
+        if (nodes.minFd >= 0) close(nodes.minFd);
+        if (nodes.maxFd >= 0) close(nodes.maxFd);
+        if (nodes.govFd >= 0) close(nodes.govFd);
+    }
+}
+
+int SensorSampler::openNode(const std::string& relPath) {
+    return open((m_root + relPath).c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+bool SensorSampler::readRaw(int fd, size_t& len) {
+    if (fd < 0) return false;
+
+    ssize_t n = pread(fd, m_buffer, sizeof(m_buffer) - 1, 0);
+    if (n <= 0) return false;
+
+    len = static_cast<size_t>(n);
+    m_buffer[len] = '\0';
+    return true;
+}
+
+bool SensorSampler::readInt(int fd, long& value) {
+    size_t len = 0;
+    if (!readRaw(fd, len)) return false;
+    return parseSysfsInt(m_buffer, len, value);
+}
+
+const SensorSampler::CpuNodes* SensorSampler::cpuNodes(int cpu) const {
+    if (cpu < 0 || cpu >= cpuCount()) return nullptr;
+    return &m_cpus[cpu];
+}
+
+bool SensorSampler::readTemperature(long& milliCelsius) {
+    return readInt(m_tempFd, milliCelsius);
+}
+
+bool SensorSampler::readCurFreq(int cpu, long& kHz) {
+    const CpuNodes* nodes = cpuNodes(cpu);
+    return nodes && readInt(nodes->curFd, kHz);
+}
+
+bool SensorSampler::readMinFreq(int cpu, long& kHz) {
+    const CpuNodes* nodes = cpuNodes(cpu);
+    return nodes && readInt(nodes->minFd, kHz);
+}
+
+bool SensorSampler::readMaxFreq(int cpu, long& kHz) {
+    const CpuNodes* nodes = cpuNodes(cpu);
+    return nodes && readInt(nodes->maxFd, kHz);
+}
+
+bool SensorSampler::readGovernor(int cpu, std::string& governor) {
+    const CpuNodes* nodes = cpuNodes(cpu);
+    size_t len = 0;
+    if (!nodes || !readRaw(nodes->govFd, len)) return false;
+
+    while (len > 0 && (m_buffer[len - 1] == '\n' || m_buffer[len - 1] == ' ')) len--;
+    governor.assign(m_buffer, len);
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef OVERPI_SENSOR_SAMPLER_H
+#define OVERPI_SENSOR_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Parse a decimal integer from a sysfs buffer without throwing.
+// Leading blanks and trailing whitespace/newline are accepted.
+bool parseSysfsInt(const char* buf, size_t len, long& value);
+
+// Sysfs sensor reader that opens every node once and re-reads it
+// with pread() at offset 0 into a fixed buffer on each sample.
+class SensorSampler {
+public:
+    static const int kMaxCpus = 16;
+
+    explicit SensorSampler(const std::string& sysfsRoot = "/sys");
+    ~SensorSampler();
+
+    // Temperature of thermal_zone0 in millidegrees Celsius
+    bool readTemperature(long& milliCelsius);
+
+    // Current, minimum and maximum scaling frequency of a core in kHz
+    bool readCurFreq(int cpu, long& kHz);
+    bool readMinFreq(int cpu, long& kHz);
+    bool readMaxFreq(int cpu, long& kHz);
+
+    // Scaling governor of a core
+    bool readGovernor(int cpu, std::string& governor);
+
+    int cpuCount() const { return static_cast<int>(m_cpus.size()); }
+    const std::string& sysfsRoot() const { return m_root; }
+
+private:
+    struct CpuNodes {
+        int curFd;
+        int minFd;
+        int maxFd;
+        int govFd;
+    };
+
+    SensorSampler(const SensorSampler&) = delete;
+    SensorSampler& operator=(const SensorSampler&) = delete;
+
+    int openNode(const std::string& relPath);
+    bool readRaw(int fd, size_t& len);
+    bool readInt(int fd, long& value);
+    const CpuNodes* cpuNodes(int cpu) const;
+
+    std::string m_root;
+    int m_tempFd;
+    std::vector<CpuNodes> m_cpus;
+    char m_buffer[64];
+};
+
+#endif
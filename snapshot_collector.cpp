@@ -0,0 +1,158 @@
+#include "snapshot_collector.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <time.h>
+
+#include "latency_stats.h"
+
+int64_t monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+SnapshotCollector::SnapshotCollector(const std::string& sysfsRoot, const std::string& mailboxPath)
+: m_sampler(sysfsRoot),
+  m_mailbox(mailboxPath),
+  m_firmware(&m_mailbox),
+  m_perf(m_sampler.cpuCount()),
+  m_sequence(0) {
+}
+
+SnapshotCollector::SnapshotCollector(const std::string& sysfsRoot, FirmwareSource& firmware)
+: m_sampler(sysfsRoot),
+  m_mailbox(""),
+  m_firmware(&firmware),
+  m_perf(0),
+  m_sequence(0) {
+}
+
+void SnapshotCollector::collect(SystemSnapshot& snapshot) {
+    ScopedLatency latency(PROBE_COLLECT);
+    snapshot.sequence = ++m_sequence;
+    snapshot.monotonicNs = monotonicNowNs();
+
+    {
+        ScopedLatency step(PROBE_READ_TEMPERATURE);
+        snapshot.temperatureValid = m_sampler.readTemperature(snapshot.temperatureMilliC);
+    }
+
+    snapshot.cpuCount = m_sampler.cpuCount();
+    for (int cpu = 0; cpu < snapshot.cpuCount; cpu++) {
+        ScopedLatency step(PROBE_READ_FREQUENCY);
+        snapshot.cpuFreqValid[cpu] = m_sampler.readCurFreq(cpu, snapshot.cpuFreqKHz[cpu]);
+    }
+
+    {
+        ScopedLatency step(PROBE_READ_LIMITS);
+        snapshot.limitsValid = m_sampler.readMinFreq(0, snapshot.minFreqKHz) &&
+                               m_sampler.readMaxFreq(0, snapshot.maxFreqKHz);
+    }
+
+    std::string governor;
+    {
+        ScopedLatency step(PROBE_READ_GOVERNOR);
+        snapshot.governorValid = m_sampler.readGovernor(0, governor);
+    }
+    std::strncpy(snapshot.governor, governor.c_str(), sizeof(snapshot.governor) - 1);
+    snapshot.governor[sizeof(snapshot.governor) - 1] = '\0';
+
+    snapshot.firmwareValid = readFirmwareState(snapshot.firmware);
+
+    snapshot.perfMode = m_perf.mode();
+    ScopedLatency step(PROBE_PERF);
+    m_perf.sample(snapshot.perf, kSnapshotMaxCpus);
+}
+
+bool SnapshotCollector::readFirmwareState(VcReading& reading) {
+    {
+        ScopedLatency step(PROBE_MAILBOX);
+        if (m_firmware->query(reading)) {
+            return true;
+        }
+    }
+    if (m_firmware != &m_mailbox) return false;
+
+    // Fall back to vcgencmd where the mailbox device is not available.
+    // vcgencmd answers one request per run, so the requests are batched
+    // into one shell per tick; each answer is tagged with what it is.
+    if (m_fallbackCommand.empty()) {
+        std::string cmd = "{ for c in";
+        for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) cmd += std::string(" ") + vcDomainName(domain);
+        cmd += "; do printf 'clock %s ' $c; vcgencmd measure_clock $c; done; printf 'throttled '; vcgencmd get_throttled; for r in";
+        for (int rail = 0; rail < VC_RAIL_COUNT; rail++) cmd += std::string(" ") + vcRailName(rail);
+        cmd += "; do printf 'volts %s ' $r; vcgencmd measure_volts $r; done; } 2>/dev/null";
+        m_fallbackCommand = cmd;
+    }
+    return parseVcgencmd(execCommand(m_fallbackCommand), reading);
+}
+
+bool SnapshotCollector::parseVcgencmd(const std::string& output, VcReading& reading) {
+    reading = VcReading();
+    bool any = false;
+
+    // "clock arm frequency(48)=1800404352", "throttled throttled=0x50000",
+    // "volts core volt=0.8500V"; a failed request leaves "error=..."
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) end = output.size();
+        std::string line = output.substr(start, end - start);
+        start = end + 1;
+
+        size_t space = line.find(' ');
+        size_t eq = line.find('=');
+        if (space == std::string::npos || eq == std::string::npos || line.find("error=") != std::string::npos) continue;
+        std::string kind = line.substr(0, space);
+        size_t nameEnd = line.find(' ', space + 1);
+        std::string name = line.substr(space + 1, nameEnd == std::string::npos ? std::string::npos : nameEnd - space - 1);
+        const char* value = line.c_str() + eq + 1;
+        char* parsedEnd = nullptr;
+
+        if (kind == "clock") {
+            unsigned long hz = strtoul(value, &parsedEnd, 10);
+            for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+                if (parsedEnd == value || name != vcDomainName(domain)) continue;
+                reading.clockValid[domain] = true;
+                reading.clockHz[domain] = hz;
+                any = true;
+            }
+        } else if (kind == "throttled") {
+            unsigned long code = strtoul(value, &parsedEnd, 16);
+            if (parsedEnd != value) {
+                reading.throttledValid = true;
+                reading.throttled = code;
+                any = true;
+            }
+        } else if (kind == "volts") {
+            double v = strtod(value, &parsedEnd);
+            for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+                if (parsedEnd == value || name != vcRailName(rail)) continue;
+                reading.voltsValid[rail] = true;
+                reading.microVolts[rail] = static_cast<uint32_t>(v * 1000000.0 + 0.5);
+                any = true;
+            }
+        }
+    }
+    return any;
+}
+
+std::string SnapshotCollector::execCommand(const std::string& cmd) {
+    ScopedLatency latency(PROBE_EXEC_COMMAND);
+    char buffer[128];
+    std::string result;
+
+    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
+    if (!pipe) {
+        return "";
+    }
+
+    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
+        result += buffer;
+    }
+
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef OVERPI_SNAPSHOT_COLLECTOR_H
+#define OVERPI_SNAPSHOT_COLLECTOR_H
+
+#include <string>
+
+#include "perf_sampler.h"
+#include "sensor_sampler.h"
+#include "vc_mailbox.h"
+#include "system_snapshot.h"
+
+// Collects a complete SystemSnapshot from sysfs and the firmware.
+// Performs blocking I/O, so it must only be driven from a worker thread.
+class SnapshotCollector {
+public:
+    explicit SnapshotCollector(const std::string& sysfsRoot = "/sys",
+                               const std::string& mailboxPath = "/dev/vcio");
+
+    // Collect from another board, e.g. a simulated one: sysfs under
+    // sysfsRoot and the firmware state from firmware. The delivered-clock
+    // counters would measure this machine, so they are not sampled.
+    SnapshotCollector(const std::string& sysfsRoot, FirmwareSource& firmware);
+
+    void collect(SystemSnapshot& snapshot);
+    int cpuCount() const { return m_sampler.cpuCount(); }
+
+    // Parse the tagged output of the batched vcgencmd fallback
+    static bool parseVcgencmd(const std::string& output, VcReading& reading);
+
+private:
+    bool readFirmwareState(VcReading& reading);
+    static std::string execCommand(const std::string& cmd);
+
+    SensorSampler m_sampler;
+    VcMailbox m_mailbox;
+    FirmwareSource* m_firmware;
+    PerfSampler m_perf;
+    uint64_t m_sequence;
+    std::string m_fallbackCommand;
+};
+
+// Monotonic clock in nanoseconds
+int64_t monotonicNowNs();
+
+#endif
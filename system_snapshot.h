@@ -0,0 +1,61 @@
+#ifndef OVERPI_SYSTEM_SNAPSHOT_H
+#define OVERPI_SYSTEM_SNAPSHOT_H
+
+#include <cstdint>
+
+#include "perf_sampler.h"
+#include "sensor_sampler.h"
+#include "vc_mailbox.h"
+
+const int kSnapshotMaxCpus = SensorSampler::kMaxCpus;
+
+// Immutable set of readings taken in one collection pass.
+// Plain data only, so it can be copied between threads without allocation.
+struct SystemSnapshot {
+    uint64_t sequence;
+    int64_t monotonicNs;
+
+    bool temperatureValid;
+    long temperatureMilliC;
+
+    int cpuCount;
+    bool cpuFreqValid[kSnapshotMaxCpus];
+    long cpuFreqKHz[kSnapshotMaxCpus];
+
+    // Scaling limits of cpu0
+    bool limitsValid;
+    long minFreqKHz;
+    long maxFreqKHz;
+
+    bool governorValid;
+    char governor[32];
+
+    bool firmwareValid;
+    VcReading firmware;
+
+    // Clock the cores delivered since the previous snapshot
+    int perfMode;                          // PerfSampler::Mode
+    PerfReading perf[kSnapshotMaxCpus];
+
+    // Thermal governor state at collection time
+    bool governorEngaged;
+    long governorCeilingKHz;
+
+    SystemSnapshot()
+    : sequence(0), monotonicNs(0),
+      temperatureValid(false), temperatureMilliC(0),
+      cpuCount(0),
+      limitsValid(false), minFreqKHz(0), maxFreqKHz(0),
+      governorValid(false),
+      firmwareValid(false),
+      perfMode(0),
+      governorEngaged(false), governorCeilingKHz(0) {
+        for (int i = 0; i < kSnapshotMaxCpus; i++) {
+            cpuFreqValid[i] = false;
+            cpuFreqKHz[i] = 0;
+        }
+        governor[0] = '\0';
+    }
+};
+
+#endif
@@ -0,0 +1,403 @@
+#include "telemetry_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "history_buffer.h"
+
+namespace {
+const char kFileMagic[8] = {'O', 'V', 'P', 'L', 'O', 'G', '1', '\0'};
+const uint32_t kFileVersion = 1;
+const uint32_t kBlockMagic = 0x314B4256;    // "VBK1"
+const uint32_t kFooterMagic = 0x31584956;   // "VIX1"
+const size_t kBlockHeaderBytes = 32;
+const size_t kIndexEntryBytes = 32;
+const size_t kTrailerBytes = 16;
+
+void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+void putU64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t getU32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+uint64_t getU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return false;
+        uint8_t byte = *p++;
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+int64_t clockUs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000LL + ts.tv_nsec / 1000;
+}
+}
+
+TelemetryWriter::TelemetryWriter()
+: m_fd(-1),
+  m_channels(0),
+  m_offset(0),
+  m_prevThrottle(0),
+  m_prevUs(0),
+  m_blockFirstUs(0),
+  m_blockSamples(0) {
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    close();
+}
+
+bool TelemetryWriter::open(const std::string& path, int cores) {
+    close();
+
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) return false;
+
+    m_channels = HISTORY_CPU_FREQ_BASE + cores;
+    m_offset = 0;
+    m_index.clear();
+    m_prevValues.assign(m_channels, 0);
+    m_scratch.assign(m_channels, 0);
+    m_block.reserve(kBlockBytes + 256);
+    resetBlock();
+
+    std::vector<uint8_t> header(32);
+    std::memcpy(header.data(), kFileMagic, sizeof(kFileMagic));
+    putU32(&header[8], kFileVersion);
+    putU32(&header[12], static_cast<uint32_t>(m_channels));
+    putU64(&header[16], static_cast<uint64_t>(clockUs(CLOCK_REALTIME)));
+    putU64(&header[24], static_cast<uint64_t>(clockUs(CLOCK_MONOTONIC)));
+    for (int ch = 0; ch < m_channels; ch++) {
+        std::string name = historyChannelName(ch);
+        header.push_back(static_cast<uint8_t>(name.size()));
+        header.insert(header.end(), name.begin(), name.end());
+    }
+
+    if (!writeAll(header.data(), header.size())) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TelemetryWriter::close() {
+    if (m_fd < 0) return;
+
+    flush();
+
+    // Index footer so readers can seek without scanning
+    std::vector<uint8_t> footer(m_index.size() * kIndexEntryBytes + kTrailerBytes, 0);
+    uint8_t* p = footer.data();
+    for (const auto& entry : m_index) {
+        putU64(p, entry.offset);
+        putU64(p + 8, static_cast<uint64_t>(entry.firstUs));
+        putU64(p + 16, static_cast<uint64_t>(entry.lastUs));
+        putU32(p + 24, entry.samples);
+        p += kIndexEntryBytes;
+    }
+    putU32(p, kFooterMagic);
+    putU32(p + 4, static_cast<uint32_t>(m_index.size()));
+    putU64(p + 8, m_offset);
+    writeAll(footer.data(), footer.size());
+
+    fdatasync(m_fd);
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+void TelemetryWriter::resetBlock() {
+    m_block.clear();
+    m_blockSamples = 0;
+    m_prevThrottle = 0;
+    std::fill(m_prevValues.begin(), m_prevValues.end(), 0);
+}
+
+void TelemetryWriter::append(const SystemSnapshot& snapshot) {
+    if (m_fd < 0) return;
+
+    uint32_t throttle = 0;
+    snapshotChannels(snapshot, m_channels - HISTORY_CPU_FREQ_BASE, m_scratch.data(), throttle);
+    append(snapshot.monotonicNs, m_scratch.data(), throttle);
+}
+
+void TelemetryWriter::append(int64_t monotonicNs, const int32_t* values, uint32_t throttle) {
+    if (m_fd < 0) return;
+
+    int64_t us = monotonicNs / 1000;
+    if (m_blockSamples == 0) {
+        m_blockFirstUs = us;
+        m_prevUs = us;
+    }
+
+    putVarint(m_block, zigzag(us - m_prevUs));
+    for (int ch = 0; ch < m_channels; ch++) {
+        putVarint(m_block, zigzag(static_cast<int64_t>(values[ch]) - m_prevValues[ch]));
+        m_prevValues[ch] = values[ch];
+    }
+    putVarint(m_block, throttle ^ m_prevThrottle);
+    m_prevThrottle = throttle;
+    m_prevUs = us;
+    m_blockSamples++;
+
+    if (m_block.size() >= kBlockBytes || us - m_blockFirstUs >= kMaxBlockAgeUs) {
+        flush();
+    }
+}
+
+bool TelemetryWriter::flush() {
+    if (m_fd < 0 || m_blockSamples == 0) return true;
+
+    uint8_t header[kBlockHeaderBytes] = {0};
+    putU32(header, kBlockMagic);
+    putU32(header + 4, static_cast<uint32_t>(m_block.size()));
+    putU32(header + 8, m_blockSamples);
+    putU64(header + 16, static_cast<uint64_t>(m_blockFirstUs));
+    putU64(header + 24, static_cast<uint64_t>(m_prevUs));
+
+    TelemetryBlockInfo info;
+    info.offset = m_offset;
+    info.firstUs = m_blockFirstUs;
+    info.lastUs = m_prevUs;
+    info.samples = m_blockSamples;
+
+    // Header and payload go out in a single syscall
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = m_block.data();
+    iov[1].iov_len = m_block.size();
+    size_t total = iov[0].iov_len + iov[1].iov_len;
+
+    ssize_t n = writev(m_fd, iov, 2);
+    bool ok = (n == static_cast<ssize_t>(total));
+    if (!ok && n >= 0) {
+        // Short write: finish the remainder
+        std::vector<uint8_t> rest(header, header + sizeof(header));
+        rest.insert(rest.end(), m_block.begin(), m_block.end());
+        m_offset += n;
+        ok = writeAll(rest.data() + n, rest.size() - n);
+    } else if (ok) {
+        m_offset += total;
+    }
+
+    if (ok) m_index.push_back(info);
+    resetBlock();
+    return ok;
+}
+
+bool TelemetryWriter::writeAll(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(m_fd, data, len);
+        if (n < 0) return false;
+        data += n;
+        len -= n;
+        m_offset += n;
+    }
+    return true;
+}
+
+TelemetryReader::TelemetryReader()
+: m_data(nullptr),
+  m_size(0),
+  m_dataStart(0),
+  m_wallStartUs(0),
+  m_monoStartUs(0),
+  m_hasFooter(false) {
+}
+
+TelemetryReader::~TelemetryReader() {
+    close();
+}
+
+bool TelemetryReader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 32) {
+        ::close(fd);
+        return false;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    m_data = static_cast<const uint8_t*>(map);
+    m_size = st.st_size;
+
+    if (!parseHeader()) {
+        close();
+        return false;
+    }
+
+    m_hasFooter = loadFooter();
+    if (!m_hasFooter) scanBlocks();
+    return true;
+}
+
+void TelemetryReader::close() {
+    if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_channelNames.clear();
+    m_index.clear();
+    m_hasFooter = false;
+}
+
+bool TelemetryReader::parseHeader() {
+    if (std::memcmp(m_data, kFileMagic, sizeof(kFileMagic)) != 0) return false;
+    if (getU32(m_data + 8) != kFileVersion) return false;
+
+    uint32_t channels = getU32(m_data + 12);
+    m_wallStartUs = static_cast<int64_t>(getU64(m_data + 16));
+    m_monoStartUs = static_cast<int64_t>(getU64(m_data + 24));
+
+    size_t pos = 32;
+    for (uint32_t ch = 0; ch < channels; ch++) {
+        if (pos >= m_size) return false;
+        size_t len = m_data[pos++];
+        if (pos + len > m_size) return false;
+        m_channelNames.push_back(std::string(reinterpret_cast<const char*>(m_data + pos), len));
+        pos += len;
+    }
+    m_dataStart = pos;
+    return true;
+}
+
+bool TelemetryReader::loadFooter() {
+    if (m_size < m_dataStart + kTrailerBytes) return false;
+
+    const uint8_t* trailer = m_data + m_size - kTrailerBytes;
+    if (getU32(trailer) != kFooterMagic) return false;
+
+    uint64_t count = getU32(trailer + 4);
+    uint64_t indexOffset = getU64(trailer + 8);
+    if (indexOffset < m_dataStart || indexOffset + count * kIndexEntryBytes + kTrailerBytes != m_size) return false;
+
+    const uint8_t* p = m_data + indexOffset;
+    for (uint64_t i = 0; i < count; i++, p += kIndexEntryBytes) {
+        TelemetryBlockInfo info;
+        info.offset = getU64(p);
+        info.firstUs = static_cast<int64_t>(getU64(p + 8));
+        info.lastUs = static_cast<int64_t>(getU64(p + 16));
+        info.samples = getU32(p + 24);
+        if (info.offset + kBlockHeaderBytes > indexOffset) {
+            m_index.clear();
+            return false;
+        }
+        m_index.push_back(info);
+    }
+    return true;
+}
+
+void TelemetryReader::scanBlocks() {
+    size_t pos = m_dataStart;
+    while (pos + kBlockHeaderBytes <= m_size) {
+        const uint8_t* header = m_data + pos;
+        if (getU32(header) != kBlockMagic) break;
+
+        size_t payload = getU32(header + 4);
+        if (pos + kBlockHeaderBytes + payload > m_size) break;
+
+        TelemetryBlockInfo info;
+        info.offset = pos;
+        info.samples = getU32(header + 8);
+        info.firstUs = static_cast<int64_t>(getU64(header + 16));
+        info.lastUs = static_cast<int64_t>(getU64(header + 24));
+        m_index.push_back(info);
+
+        pos += kBlockHeaderBytes + payload;
+    }
+}
+
+size_t TelemetryReader::read(int64_t fromUs, int64_t toUs, const SampleCallback& callback) const {
+    // First block that may contain samples at or after fromUs
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), fromUs,
+        [](const TelemetryBlockInfo& block, int64_t t) { return block.lastUs < t; });
+
+    size_t visited = 0;
+    for (; it != m_index.end() && it->firstUs < toUs; ++it) {
+        visited += decodeBlock(*it, fromUs, toUs, callback);
+    }
+    return visited;
+}
+
+size_t TelemetryReader::decodeBlock(const TelemetryBlockInfo& block, int64_t fromUs, int64_t toUs, const SampleCallback& callback) const {
+    const uint8_t* header = m_data + block.offset;
+    if (getU32(header) != kBlockMagic) return 0;
+
+    const uint8_t* p = header + kBlockHeaderBytes;
+    const uint8_t* end = p + getU32(header + 4);
+    if (end > m_data + m_size) return 0;
+
+    int n = channels();
+    std::vector<int32_t> values(n, 0);
+    int64_t us = block.firstUs;
+    uint32_t throttle = 0;
+    size_t visited = 0;
+
+    for (uint32_t s = 0; s < block.samples; s++) {
+        uint64_t v = 0;
+        if (!getVarint(p, end, v)) break;
+        us += unzigzag(v);
+
+        bool ok = true;
+        for (int ch = 0; ch < n && ok; ch++) {
+            ok = getVarint(p, end, v);
+            values[ch] = static_cast<int32_t>(values[ch] + unzigzag(v));
+        }
+        if (!ok || !getVarint(p, end, v)) break;
+        throttle ^= static_cast<uint32_t>(v);
+
+        if (us >= toUs) break;
+        if (us >= fromUs) {
+            callback(us, values.data(), throttle);
+            visited++;
+        }
+    }
+    return visited;
+}
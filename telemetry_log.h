@@ -0,0 +1,118 @@
+#ifndef OVERPI_TELEMETRY_LOG_H
+#define OVERPI_TELEMETRY_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "system_snapshot.h"
+
+// On-disk telemetry log (little-endian):
+//
+//   file header   magic "OVPLOG1\0", version, channel count,
+//                 wall/monotonic start time, channel names
+//   blocks        32-byte header + varint payload; timestamps (µs) and
+//                 channel values are delta encoded (zigzag varints) and
+//                 throttle bits are XOR-ed against the previous sample.
+//                 Every block decodes on its own.
+//   index footer  one entry per block + trailer, written on close.
+//
+// A file without footer (writer killed) is still readable: the reader
+// rebuilds the index by hopping over block headers.
+
+struct TelemetryBlockInfo {
+    uint64_t offset;
+    int64_t firstUs;
+    int64_t lastUs;
+    uint32_t samples;
+};
+
+// Append-only writer; samples are batched into blocks so the file sees
+// one write() per block instead of one per sample
+class TelemetryWriter {
+public:
+    TelemetryWriter();
+    ~TelemetryWriter();
+
+    bool open(const std::string& path, int cores);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+
+    void append(const SystemSnapshot& snapshot);
+    void append(int64_t monotonicNs, const int32_t* values, uint32_t throttle);
+
+    // Write the pending block now
+    bool flush();
+
+    uint64_t bytesWritten() const { return m_offset; }
+
+private:
+    static const size_t kBlockBytes = 64 * 1024;
+    static const int64_t kMaxBlockAgeUs = 30 * 1000000LL;
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    bool writeAll(const uint8_t* data, size_t len);
+    void resetBlock();
+
+    int m_fd;
+    int m_channels;
+    uint64_t m_offset;
+
+    std::vector<uint8_t> m_block;
+    std::vector<int32_t> m_prevValues;
+    std::vector<int32_t> m_scratch;
+    uint32_t m_prevThrottle;
+    int64_t m_prevUs;
+    int64_t m_blockFirstUs;
+    uint32_t m_blockSamples;
+
+    std::vector<TelemetryBlockInfo> m_index;
+};
+
+// Reader that maps the whole log and seeks through the block index
+class TelemetryReader {
+public:
+    typedef std::function<void(int64_t monotonicUs, const int32_t* values, uint32_t throttle)> SampleCallback;
+
+    TelemetryReader();
+    ~TelemetryReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    int channels() const { return static_cast<int>(m_channelNames.size()); }
+    const std::vector<std::string>& channelNames() const { return m_channelNames; }
+    const std::vector<TelemetryBlockInfo>& blocks() const { return m_index; }
+    bool hasFooter() const { return m_hasFooter; }
+
+    // Map a monotonic timestamp of the log to wall-clock microseconds
+    int64_t wallUs(int64_t monotonicUs) const { return m_wallStartUs + (monotonicUs - m_monoStartUs); }
+    int64_t monoStartUs() const { return m_monoStartUs; }
+
+    // Decode samples with fromUs <= t < toUs; returns the number visited
+    size_t read(int64_t fromUs, int64_t toUs, const SampleCallback& callback) const;
+
+private:
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    bool parseHeader();
+    bool loadFooter();
+    void scanBlocks();
+    size_t decodeBlock(const TelemetryBlockInfo& block, int64_t fromUs, int64_t toUs, const SampleCallback& callback) const;
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_dataStart;
+    int64_t m_wallStartUs;
+    int64_t m_monoStartUs;
+    bool m_hasFooter;
+    std::vector<std::string> m_channelNames;
+    std::vector<TelemetryBlockInfo> m_index;
+};
+
+#endif
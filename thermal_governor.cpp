@@ -0,0 +1,128 @@
+#include "thermal_governor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+ThermalGovernor::ThermalGovernor(const std::string& sysfsRoot)
+: m_cpufreq(sysfsRoot),
+  m_frequencies(m_cpufreq.frequencies()),
+  m_engaged(false),
+  m_savedMaxKHz(0),
+  m_savedMinKHz(0),
+  m_ceilingKHz(0),
+  m_output(0),
+  m_lastError(0),
+  m_lastNs(0) {
+}
+
+ThermalGovernor::~ThermalGovernor() {
+    release();
+}
+
+long ThermalGovernor::quantize(double kHz) const {
+    long value = static_cast<long>(kHz);
+    if (m_frequencies.empty()) {
+        long step = std::max(1L, m_config.stepKHz);
+        value = (value / step) * step;
+        return std::max(m_config.minFreqKHz, std::min(m_config.maxFreqKHz, value));
+    }
+
+    // Highest operating point not above the value and within the bounds
+    long best = 0;
+    for (long f : m_frequencies) {
+        if (f > value || f > m_config.maxFreqKHz) break;
+        if (f >= m_config.minFreqKHz) best = f;
+    }
+    if (best == 0) {
+        for (long f : m_frequencies) {
+            if (f >= m_config.minFreqKHz) return f;
+        }
+        return m_config.minFreqKHz;
+    }
+    return best;
+}
+
+bool ThermalGovernor::writeCeiling(long kHz) {
+    bool ok = m_cpufreq.setMax(kHz);
+    if (ok) m_ceilingKHz = kHz;
+    return ok;
+}
+
+bool ThermalGovernor::engage(const GovernorConfig& config) {
+    if (m_cpufreq.policyCount() == 0) return false;
+
+    if (!m_engaged) {
+        if (!m_cpufreq.readLimits(0, m_savedMinKHz, m_savedMaxKHz)) return false;
+        m_ceilingKHz = m_savedMaxKHz;
+    }
+
+    m_config = config;
+
+    // Lowering the floor first keeps min <= max at every step
+    if (!m_cpufreq.setMin(m_config.minFreqKHz)) return false;
+    m_engaged = true;
+    m_lastNs = 0;
+    m_lastError = 0;
+
+    long start = quantize(std::min(m_ceilingKHz, m_config.maxFreqKHz));
+    m_output = start;
+    return writeCeiling(start);
+}
+
+bool ThermalGovernor::adoptCurrentLimits() {
+    if (!m_engaged) return true;
+    if (!m_cpufreq.readLimits(0, m_savedMinKHz, m_savedMaxKHz)) return false;
+
+    // The caller moved the ceiling too; start again from there
+    m_ceilingKHz = m_savedMaxKHz;
+    return true;
+}
+
+void ThermalGovernor::release() {
+    if (!m_engaged) return;
+
+    m_engaged = false;
+
+    // Raise the ceiling before restoring the floor
+    writeCeiling(m_savedMaxKHz);
+    m_cpufreq.setMin(m_savedMinKHz);
+}
+
+bool ThermalGovernor::update(long temperatureMilliC, int64_t monotonicNs) {
+    if (!m_engaged) return false;
+
+    long setpoint = m_config.tempLimitMilliC - m_config.marginMilliC;
+    long error = setpoint - temperatureMilliC;
+
+    // Velocity-form PI: the output is the ceiling itself, so clamping it
+    // is all the anti-windup needed
+    if (m_lastNs != 0) {
+        double dt = std::min(5.0, (monotonicNs - m_lastNs) / 1e9);
+        double integral = (std::labs(error) > m_config.deadBandMilliC) ? error * dt : 0.0;
+        m_output += m_config.kp * (error - m_lastError) + m_config.ki * integral;
+    }
+    m_lastNs = monotonicNs;
+    m_lastError = error;
+
+    // At or above the limit back off two steps at once
+    if (temperatureMilliC >= m_config.tempLimitMilliC) {
+        m_output = std::min(m_output, static_cast<double>(m_ceilingKHz - 2 * m_config.stepKHz));
+    }
+    m_output = std::max(static_cast<double>(m_config.minFreqKHz), std::min(static_cast<double>(m_config.maxFreqKHz), m_output));
+
+    long target = quantize(m_output);
+    if (target > m_ceilingKHz) {
+        // Raise by a single operating point per update
+        long next = quantize(m_ceilingKHz + m_config.stepKHz);
+        if (!m_frequencies.empty()) {
+            auto it = std::upper_bound(m_frequencies.begin(), m_frequencies.end(), m_ceilingKHz);
+            if (it != m_frequencies.end()) next = std::min(*it, m_config.maxFreqKHz);
+        }
+        target = std::min(target, next);
+        m_output = std::min(m_output, static_cast<double>(target + m_config.stepKHz));
+    }
+
+    if (target == m_ceilingKHz) return false;
+    return writeCeiling(target);
+}
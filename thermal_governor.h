@@ -0,0 +1,76 @@
+#ifndef OVERPI_THERMAL_GOVERNOR_H
+#define OVERPI_THERMAL_GOVERNOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpufreq_backend.h"
+
+// Tuning of the closed-loop frequency ceiling
+struct GovernorConfig {
+    long tempLimitMilliC;   // hard limit from the profile (temp_limit)
+    long marginMilliC;      // regulate this far below the limit
+    long deadBandMilliC;    // no integral action inside +/- this band
+    long minFreqKHz;        // lowest ceiling the governor may set
+    long maxFreqKHz;        // highest ceiling, usually the profile arm_freq
+    long stepKHz;           // ceiling granularity when no OPP table exists
+    double kp;              // kHz per millidegree of error change
+    double ki;              // kHz per millidegree-second of error
+
+    GovernorConfig()
+    : tempLimitMilliC(80000), marginMilliC(3000), deadBandMilliC(500),
+      minFreqKHz(600000), maxFreqKHz(1800000), stepKHz(50000),
+      kp(20.0), ki(10.0) {}
+};
+
+// PI controller holding the highest CPU clock that keeps the temperature
+// below the profile limit, by writing scaling_max_freq of every cpufreq
+// policy. Lowering is immediate, raising is limited to one step per update
+// so the ceiling backs off quickly and creeps back up. While engaged the
+// floor (scaling_min_freq) is dropped to minFreqKHz so a pinned hot profile
+// does not block the ceiling.
+class ThermalGovernor {
+public:
+    explicit ThermalGovernor(const std::string& sysfsRoot = "/sys");
+    ~ThermalGovernor();
+
+    // Start regulating; remembers the current limits for release()
+    bool engage(const GovernorConfig& config);
+
+    // Take the limits now in sysfs as the ones release() restores. Callers
+    // that hot-apply a profile while engaged call this before engaging
+    // again, so turning the governor off keeps the new profile.
+    bool adoptCurrentLimits();
+
+    // Restore the limits that were active before engage()
+    void release();
+
+    bool isEngaged() const { return m_engaged; }
+
+    // Feed one temperature sample; true if a new ceiling was written
+    bool update(long temperatureMilliC, int64_t monotonicNs);
+
+    long ceilingKHz() const { return m_ceilingKHz; }
+    const GovernorConfig& config() const { return m_config; }
+
+private:
+    ThermalGovernor(const ThermalGovernor&) = delete;
+    ThermalGovernor& operator=(const ThermalGovernor&) = delete;
+
+    long quantize(double kHz) const;
+    bool writeCeiling(long kHz);
+
+    CpufreqBackend m_cpufreq;
+    const std::vector<long>& m_frequencies;
+    GovernorConfig m_config;
+    bool m_engaged;
+    long m_savedMaxKHz;
+    long m_savedMinKHz;
+    long m_ceilingKHz;
+    double m_output;
+    long m_lastError;
+    int64_t m_lastNs;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "throttle_tracker.h"
+
+#include <cstdio>
+
+#include "residency_tracker.h"
+
+namespace {
+const char* const kFlagNames[THROTTLE_FLAG_COUNT] = {
+    "under_voltage",
+    "frequency_capped",
+    "throttled",
+    "soft_temperature_limit"
+};
+
+const char* const kKindNames[] = {"on", "off", "transient"};
+
+const uint32_t kStickyShift = 16;
+}
+
+ThrottleTracker::ThrottleTracker(size_t capacity)
+: m_events(capacity > 0 ? capacity : 1),
+  m_head(0),
+  m_count(0),
+  m_nextSeq(0),
+  m_started(false),
+  m_lastBits(0) {
+}
+
+const char* ThrottleTracker::flagName(int flag) {
+    return flag >= 0 && flag < THROTTLE_FLAG_COUNT ? kFlagNames[flag] : "unknown";
+}
+
+const char* ThrottleTracker::kindName(int kind) {
+    return kind >= 0 && kind <= ThrottleEvent::KIND_TRANSIENT ? kKindNames[kind] : "unknown";
+}
+
+void ThrottleTracker::update(const SystemSnapshot& snapshot) {
+    if (!snapshot.firmwareValid || !snapshot.firmware.throttledValid) return;
+
+    int32_t values[HISTORY_CPU_FREQ_BASE + kSnapshotMaxCpus];
+    uint32_t throttled = 0;
+    snapshotChannels(snapshot, snapshot.cpuCount, values, throttled);
+    update(snapshot.monotonicNs, throttled, values, HISTORY_CPU_FREQ_BASE + snapshot.cpuCount);
+}
+
+void ThrottleTracker::update(int64_t monotonicNs, uint32_t throttled, const int32_t* values, int channels) {
+    if (!m_started) {
+        // Flags already active when tracking starts count as set now;
+        // sticky bits from before cannot be dated
+        m_started = true;
+        m_lastBits = throttled;
+        for (int flag = 0; flag < THROTTLE_FLAG_COUNT; flag++) {
+            if (throttled & (1u << flag)) record(monotonicNs, flag, ThrottleEvent::KIND_ON, throttled, values, channels);
+        }
+        return;
+    }
+
+    for (int flag = 0; flag < THROTTLE_FLAG_COUNT; flag++) {
+        uint32_t live = 1u << flag;
+        uint32_t sticky = live << kStickyShift;
+        bool was = (m_lastBits & live) != 0;
+        bool now = (throttled & live) != 0;
+
+        if (now != was) {
+            record(monotonicNs, flag, now ? ThrottleEvent::KIND_ON : ThrottleEvent::KIND_OFF, throttled, values, channels);
+        } else if (!now && (throttled & sticky) && !(m_lastBits & sticky)) {
+            record(monotonicNs, flag, ThrottleEvent::KIND_TRANSIENT, throttled, values, channels);
+        }
+    }
+    m_lastBits = throttled;
+}
+
+void ThrottleTracker::record(int64_t monotonicNs, int flag, int kind, uint32_t throttled, const int32_t* values, int channels) {
+    ThrottleEvent& event = m_events[m_head];
+    event.seq = m_nextSeq++;
+    event.monotonicNs = monotonicNs;
+    event.flag = flag;
+    event.kind = kind;
+    event.bits = throttled;
+    event.tempMilliC = channels > HISTORY_TEMPERATURE ? values[HISTORY_TEMPERATURE] : kHistoryInvalid;
+    event.gpuKHz = channels > HISTORY_GPU_CLOCK ? values[HISTORY_GPU_CLOCK] : kHistoryInvalid;
+    event.coreMicroVolts = channels > HISTORY_CORE_VOLTAGE ? values[HISTORY_CORE_VOLTAGE] : kHistoryInvalid;
+
+    int64_t sum = 0;
+    int cores = 0;
+    for (int ch = HISTORY_CPU_FREQ_BASE; ch < channels; ch++) {
+        if (values[ch] == kHistoryInvalid) continue;
+        sum += values[ch];
+        cores++;
+    }
+    event.cpuKHz = cores > 0 ? static_cast<int32_t>(sum / cores) : kHistoryInvalid;
+
+    m_head = (m_head + 1) % m_events.size();
+    if (m_count < m_events.size()) m_count++;
+}
+
+void ThrottleTracker::query(uint64_t sinceSeq, unsigned flagMask, size_t limit, std::vector<ThrottleEvent>& out) const {
+    size_t oldest = (m_head + m_events.size() - m_count) % m_events.size();
+    for (size_t i = 0; i < m_count && out.size() < limit; i++) {
+        const ThrottleEvent& event = m_events[(oldest + i) % m_events.size()];
+        if (event.seq < sinceSeq || !(flagMask & (1u << event.flag))) continue;
+        out.push_back(event);
+    }
+}
+
+std::string ThrottleTracker::format(const ThrottleEvent& event) {
+    std::string text = std::string(flagName(event.flag)) + " " + kindName(event.kind);
+    char buf[48];
+    if (event.tempMilliC != kHistoryInvalid) {
+        snprintf(buf, sizeof(buf), " %.1f °C", event.tempMilliC / 1000.0);
+        text += buf;
+    }
+    if (event.cpuKHz != kHistoryInvalid) {
+        snprintf(buf, sizeof(buf), " cpu %d MHz", event.cpuKHz / 1000);
+        text += buf;
+    }
+    if (event.gpuKHz != kHistoryInvalid) {
+        snprintf(buf, sizeof(buf), " gpu %d MHz", event.gpuKHz / 1000);
+        text += buf;
+    }
+    if (event.coreMicroVolts != kHistoryInvalid) {
+        snprintf(buf, sizeof(buf), " %.4f V", event.coreMicroVolts / 1000000.0);
+        text += buf;
+    }
+    snprintf(buf, sizeof(buf), " (0x%x)", event.bits);
+    return text + buf;
+}
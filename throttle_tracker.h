@@ -0,0 +1,70 @@
+#ifndef OVERPI_THROTTLE_TRACKER_H
+#define OVERPI_THROTTLE_TRACKER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "history_buffer.h"
+#include "system_snapshot.h"
+
+// One edge of a get_throttled flag
+struct ThrottleEvent {
+    enum Kind {
+        KIND_ON = 0,           // the flag became active
+        KIND_OFF = 1,          // the flag cleared
+        KIND_TRANSIENT = 2     // set and cleared between two samples; only
+                               // its sticky "occurred" bit shows it
+    };
+
+    uint64_t seq;              // increases by one per event, never reused
+    int64_t monotonicNs;       // sample that saw the edge
+    int flag;                  // ThrottleFlagIndex: 0x1 << flag is the bit
+    int kind;
+    uint32_t bits;             // full get_throttled value at that sample
+    int32_t tempMilliC;        // kHistoryInvalid when unknown
+    int32_t cpuKHz;            // mean over the cores
+    int32_t gpuKHz;
+    int32_t coreMicroVolts;
+};
+
+// Records every transition of the four live get_throttled bits
+// (under-voltage, frequency capped, throttled, soft temperature limit)
+// together with the temperature, clocks and voltage of that sample.
+//
+// Samples come either from live snapshots or from a recorded telemetry
+// log, in the history channel layout. Transitions shorter than the sample
+// interval are caught through the sticky bits 16-19 the first time they
+// set. The most recent capacity events are kept.
+class ThrottleTracker {
+public:
+    explicit ThrottleTracker(size_t capacity = 1024);
+
+    void update(const SystemSnapshot& snapshot);
+    void update(int64_t monotonicNs, uint32_t throttled, const int32_t* values, int channels);
+
+    // Events with seq >= sinceSeq whose flag is in flagMask (bit per
+    // ThrottleFlagIndex), oldest first, at most limit of them
+    void query(uint64_t sinceSeq, unsigned flagMask, size_t limit, std::vector<ThrottleEvent>& out) const;
+
+    size_t size() const { return m_count; }
+    uint64_t nextSeq() const { return m_nextSeq; }
+
+    static const char* flagName(int flag);
+    static const char* kindName(int kind);
+
+    // "under_voltage on 72.3 °C cpu 1500 MHz gpu 500 MHz 0.8500 V"
+    static std::string format(const ThrottleEvent& event);
+
+private:
+    void record(int64_t monotonicNs, int flag, int kind, uint32_t throttled, const int32_t* values, int channels);
+
+    std::vector<ThrottleEvent> m_events;   // ring
+    size_t m_head;                         // next slot to write
+    size_t m_count;
+    uint64_t m_nextSeq;
+    bool m_started;
+    uint32_t m_lastBits;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef OVERPI_TRIPLE_BUFFER_H
+#define OVERPI_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer.
+// The producer fills back() and publishes it; the consumer calls update()
+// and reads front(). Neither side ever blocks, and the consumer always
+// sees the most recently published value.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer()
+    : m_middle(1),
+      m_back(0),
+      m_front(2) {}
+
+    // Producer side
+    T& back() { return m_slots[m_back].value; }
+
+    void publish() {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | kDirty), std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+    }
+
+    // Consumer side: true if a newer value was swapped into front()
+    bool update() {
+        if ((m_middle.load(std::memory_order_relaxed) & kDirty) == 0) return false;
+
+        uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & kIndexMask;
+        return true;
+    }
+
+    const T& front() const { return m_slots[m_front].value; }
+
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kDirty = 0x4;
+
+    // Keep each slot on its own cache line
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    Slot m_slots[3];
+    alignas(64) std::atomic<uint8_t> m_middle;
+    alignas(64) uint8_t m_back;
+    alignas(64) uint8_t m_front;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "vc_mailbox.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// Same request number the firmware tools (vcmailbox, vcgencmd) use
+#define IOCTL_MBOX_PROPERTY _IOWR(100, 0, char *)
+
+namespace {
+const uint32_t kRequestCode = 0x00000000;
+const uint32_t kResponseSuccess = 0x80000000;
+const uint32_t kTagResponse = 0x80000000;
+const uint32_t kTagEnd = 0x00000000;
+
+const uint32_t kTagGetVoltage = 0x00030003;
+const uint32_t kTagGetThrottled = 0x00030046;
+const uint32_t kTagGetClockRateMeasured = 0x00030047;
+
+const VcClockId kDomainClocks[VC_DOMAIN_COUNT] = {
+    VC_CLOCK_ARM, VC_CLOCK_CORE, VC_CLOCK_V3D, VC_CLOCK_H264, VC_CLOCK_ISP, VC_CLOCK_EMMC, VC_CLOCK_SDRAM
+};
+const char* const kDomainNames[VC_DOMAIN_COUNT] = {"arm", "core", "v3d", "h264", "isp", "emmc", "sdram"};
+
+const VcVoltageId kRailVoltages[VC_RAIL_COUNT] = {
+    VC_VOLTAGE_CORE, VC_VOLTAGE_SDRAM_C, VC_VOLTAGE_SDRAM_I, VC_VOLTAGE_SDRAM_P
+};
+const char* const kRailNames[VC_RAIL_COUNT] = {"core", "sdram_c", "sdram_i", "sdram_p"};
+}
+
+VcClockId vcDomainClock(int domain) {
+    return kDomainClocks[domain];
+}
+
+const char* vcDomainName(int domain) {
+    return kDomainNames[domain];
+}
+
+VcVoltageId vcRailVoltage(int rail) {
+    return kRailVoltages[rail];
+}
+
+const char* vcRailName(int rail) {
+    return kRailNames[rail];
+}
+
+VcMailbox::VcMailbox(const std::string& devicePath)
+: m_path(devicePath),
+  m_fd(-1),
+  m_used(0) {
+    m_fd = open(m_path.c_str(), O_RDWR | O_CLOEXEC);
+}
+
+VcMailbox::~VcMailbox() {
+    if (m_fd >= 0) close(m_fd);
+}
+
+void VcMailbox::beginMessage() {
+    std::memset(m_buffer, 0, sizeof(m_buffer));
+    m_buffer[1] = kRequestCode;
+    m_used = 2;
+}
+
+int VcMailbox::addTag(uint32_t tag, uint32_t valueWords, uint32_t param) {
+    if (m_used + 3 + static_cast<int>(valueWords) + 1 > kBufferWords) return -1;
+
+    m_buffer[m_used++] = tag;
+    m_buffer[m_used++] = valueWords * sizeof(uint32_t);
+    m_buffer[m_used++] = 0;
+    int valueIndex = m_used;
+    m_buffer[m_used] = param;
+    m_used += valueWords;
+    return valueIndex;
+}
+
+bool VcMailbox::transact() {
+    if (m_fd < 0) return false;
+
+    m_buffer[m_used++] = kTagEnd;
+    m_buffer[0] = m_used * sizeof(uint32_t);
+
+    if (ioctl(m_fd, IOCTL_MBOX_PROPERTY, m_buffer) < 0) return false;
+    return m_buffer[1] == kResponseSuccess;
+}
+
+bool VcMailbox::tagValid(int index) const {
+    return index > 0 && (m_buffer[index - 1] & kTagResponse) != 0;
+}
+
+bool VcMailbox::query(VcReading& reading) {
+    reading = VcReading();
+    beginMessage();
+
+    int clockIdx[VC_DOMAIN_COUNT];
+    for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+        clockIdx[domain] = addTag(kTagGetClockRateMeasured, 2, kDomainClocks[domain]);
+    }
+    // A zero mask reads the flags without clearing the sticky bits
+    int throttledIdx = addTag(kTagGetThrottled, 1, 0);
+    int voltIdx[VC_RAIL_COUNT];
+    for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+        voltIdx[rail] = addTag(kTagGetVoltage, 2, kRailVoltages[rail]);
+    }
+
+    if (!transact()) return false;
+
+    // The firmware zeroes clocks that are off, e.g. h264 while idle
+    for (int domain = 0; domain < VC_DOMAIN_COUNT; domain++) {
+        if (tagValid(clockIdx[domain])) {
+            reading.clockValid[domain] = true;
+            reading.clockHz[domain] = m_buffer[clockIdx[domain] + 1];
+        }
+    }
+    if (tagValid(throttledIdx)) {
+        reading.throttledValid = true;
+        reading.throttled = m_buffer[throttledIdx];
+    }
+    for (int rail = 0; rail < VC_RAIL_COUNT; rail++) {
+        if (tagValid(voltIdx[rail])) {
+            reading.voltsValid[rail] = true;
+            reading.microVolts[rail] = m_buffer[voltIdx[rail] + 1];
+        }
+    }
+    return true;
+}
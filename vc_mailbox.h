@@ -0,0 +1,118 @@
+#ifndef OVERPI_VC_MAILBOX_H
+#define OVERPI_VC_MAILBOX_H
+
+#include <string>
+#include <cstdint>
+
+// Clock identifiers of the firmware property interface
+enum VcClockId {
+    VC_CLOCK_EMMC = 1,
+    VC_CLOCK_UART = 2,
+    VC_CLOCK_ARM = 3,
+    VC_CLOCK_CORE = 4,
+    VC_CLOCK_V3D = 5,
+    VC_CLOCK_H264 = 6,
+    VC_CLOCK_ISP = 7,
+    VC_CLOCK_SDRAM = 8
+};
+
+// Voltage rail identifiers of the firmware property interface
+enum VcVoltageId {
+    VC_VOLTAGE_CORE = 1,
+    VC_VOLTAGE_SDRAM_C = 2,
+    VC_VOLTAGE_SDRAM_P = 3,
+    VC_VOLTAGE_SDRAM_I = 4
+};
+
+// Clock domains measured on every reading; indexes VcReading::clockHz
+enum VcDomain {
+    VC_DOMAIN_ARM = 0,
+    VC_DOMAIN_CORE = 1,
+    VC_DOMAIN_V3D = 2,
+    VC_DOMAIN_H264 = 3,
+    VC_DOMAIN_ISP = 4,
+    VC_DOMAIN_EMMC = 5,
+    VC_DOMAIN_SDRAM = 6,
+    VC_DOMAIN_COUNT = 7
+};
+
+// Voltage rails read on every reading; indexes VcReading::microVolts
+enum VcRail {
+    VC_RAIL_CORE = 0,
+    VC_RAIL_SDRAM_C = 1,
+    VC_RAIL_SDRAM_I = 2,
+    VC_RAIL_SDRAM_P = 3,
+    VC_RAIL_COUNT = 4
+};
+
+// Firmware id and vcgencmd name ("arm", "v3d", "sdram_c", ...) of each
+VcClockId vcDomainClock(int domain);
+const char* vcDomainName(int domain);
+VcVoltageId vcRailVoltage(int rail);
+const char* vcRailName(int rail);
+
+// Values returned by one batched property transaction
+struct VcReading {
+    bool clockValid[VC_DOMAIN_COUNT];
+    uint32_t clockHz[VC_DOMAIN_COUNT];
+    bool throttledValid;
+    uint32_t throttled;
+    bool voltsValid[VC_RAIL_COUNT];
+    uint32_t microVolts[VC_RAIL_COUNT];
+
+    VcReading()
+    : throttledValid(false), throttled(0) {
+        for (int i = 0; i < VC_DOMAIN_COUNT; i++) {
+            clockValid[i] = false;
+            clockHz[i] = 0;
+        }
+        for (int i = 0; i < VC_RAIL_COUNT; i++) {
+            voltsValid[i] = false;
+            microVolts[i] = 0;
+        }
+    }
+};
+
+// Anything that reports the firmware's clocks, throttled state and
+// voltage: the mailbox on a board, a model in simulation
+class FirmwareSource {
+public:
+    virtual ~FirmwareSource() {}
+
+    // False if nothing could be read
+    virtual bool query(VcReading& reading) = 0;
+};
+
+// Native client for the VideoCore firmware mailbox (/dev/vcio).
+// Every clock domain, the throttled state and every voltage rail are
+// fetched with a single ioctl.
+class VcMailbox : public FirmwareSource {
+public:
+    explicit VcMailbox(const std::string& devicePath = "/dev/vcio");
+    ~VcMailbox();
+
+    bool isOpen() const { return m_fd >= 0; }
+    const std::string& devicePath() const { return m_path; }
+
+    // Run one property transaction; false if the device rejected it
+    bool query(VcReading& reading) override;
+
+private:
+    // Header, 12 tags of up to 5 words each and the end tag
+    static const int kBufferWords = 96;
+
+    VcMailbox(const VcMailbox&) = delete;
+    VcMailbox& operator=(const VcMailbox&) = delete;
+
+    void beginMessage();
+    int addTag(uint32_t tag, uint32_t valueWords, uint32_t param);
+    bool transact();
+    bool tagValid(int index) const;
+
+    std::string m_path;
+    int m_fd;
+    int m_used;
+    alignas(16) uint32_t m_buffer[kBufferWords];
+};
+
+#endif
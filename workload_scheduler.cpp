@@ -0,0 +1,168 @@
+#include "workload_scheduler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+void WorkloadConfig::setJobNames(const std::string& list) {
+    jobNames.clear();
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        // The kernel truncates comm to 15 characters
+        std::string name = list.substr(start, end - start).substr(0, 15);
+        if (!name.empty()) jobNames.push_back(name);
+        start = end + 1;
+    }
+}
+
+WorkloadScheduler::WorkloadScheduler(const WorkloadConfig& config, const std::string& procRoot)
+: m_config(config),
+  m_procRoot(procRoot),
+  m_busy(procRoot),
+  m_loadFd(open((procRoot + "/loadavg").c_str(), O_RDONLY | O_CLOEXEC)),
+  m_cpuCount(static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN))),
+  m_busyPercent(0),
+  m_loadPercent(0),
+  m_lastScanNs(0),
+  m_started(false),
+  m_level(LEVEL_NORMAL),
+  m_aboveSinceNs(0),
+  m_belowSinceNs(0) {
+    if (m_cpuCount < 1) m_cpuCount = 1;
+}
+
+WorkloadScheduler::~WorkloadScheduler() {
+    if (m_loadFd >= 0) close(m_loadFd);
+}
+
+const char* WorkloadScheduler::levelName(Level level) {
+    switch (level) {
+    case LEVEL_IDLE: return "idle";
+    case LEVEL_BUSY: return "busy";
+    default: return "normal";
+    }
+}
+
+const std::string& WorkloadScheduler::profileFor(Level level) const {
+    switch (level) {
+    case LEVEL_IDLE: return m_config.idleProfile;
+    case LEVEL_BUSY: return m_config.busyProfile;
+    default: return m_config.normalProfile;
+    }
+}
+
+void WorkloadScheduler::reset() {
+    // A load delta from before the reset would be stale
+    m_busy.reset();
+    m_lastScanNs = 0;
+    m_started = false;
+    m_aboveSinceNs = 0;
+    m_belowSinceNs = 0;
+}
+
+bool WorkloadScheduler::readLoadPercent(int& percent) {
+    if (m_loadFd < 0) return false;
+
+    // "0.52 0.58 0.59 1/467 12345"
+    char buf[128];
+    ssize_t n = pread(m_loadFd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    char* end;
+    double load = strtod(buf, &end);
+    if (end == buf) return false;
+    percent = static_cast<int>(load * 100 / m_cpuCount);
+    return true;
+}
+
+void WorkloadScheduler::scanJobs() {
+    m_job.clear();
+    DIR* dir = opendir(m_procRoot.c_str());
+    if (!dir) return;
+
+    int dirFd = dirfd(dir);
+    char path[48];
+    char comm[32];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9') continue;
+        snprintf(path, sizeof(path), "%.32s/comm", entry->d_name);
+        int fd = openat(dirFd, path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        ssize_t n = read(fd, comm, sizeof(comm) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        if (comm[n - 1] == '\n') n--;
+        comm[n] = '\0';
+
+        for (const auto& name : m_config.jobNames) {
+            if (name == comm) {
+                m_job = name;
+                closedir(dir);
+                return;
+            }
+        }
+    }
+    closedir(dir);
+}
+
+WorkloadScheduler::Level WorkloadScheduler::classify() const {
+    if (!m_job.empty() || m_busyPercent >= m_config.busyPercent) return LEVEL_BUSY;
+    if (m_busyPercent < m_config.idlePercent && m_loadPercent < m_config.idleLoadPercent) return LEVEL_IDLE;
+    return LEVEL_NORMAL;
+}
+
+bool WorkloadScheduler::update(int64_t monotonicNs, std::string& profileId) {
+    int busy;
+    bool busyKnown = m_busy.read(busy);
+    if (busyKnown) m_busyPercent = busy;
+    int load;
+    if (readLoadPercent(load)) m_loadPercent = load;
+
+    bool hadJob = !m_job.empty();
+    if (!m_config.jobNames.empty() &&
+        (m_lastScanNs == 0 || monotonicNs - m_lastScanNs >= static_cast<int64_t>(m_config.jobScanMs) * 1000000)) {
+        scanJobs();
+        m_lastScanNs = monotonicNs;
+    }
+
+    // The first delta needs two reads of /proc/stat
+    if (!busyKnown && m_job.empty()) return false;
+
+    Level target = classify();
+    if (!m_started) {
+        m_started = true;
+        m_level = target;
+        m_aboveSinceNs = 0;
+        m_belowSinceNs = 0;
+        profileId = profileFor(m_level);
+        return true;
+    }
+
+    if (target > m_level) {
+        m_belowSinceNs = 0;
+        if (m_aboveSinceNs == 0) m_aboveSinceNs = monotonicNs;
+        // A job starting boosts at once; plain load has to last
+        bool jobStarted = !hadJob && !m_job.empty();
+        if (!jobStarted && monotonicNs - m_aboveSinceNs < static_cast<int64_t>(m_config.boostAfterMs) * 1000000) return false;
+    } else if (target < m_level) {
+        m_aboveSinceNs = 0;
+        if (m_belowSinceNs == 0) m_belowSinceNs = monotonicNs;
+        if (monotonicNs - m_belowSinceNs < static_cast<int64_t>(m_config.dropAfterMs) * 1000000) return false;
+    } else {
+        m_aboveSinceNs = 0;
+        m_belowSinceNs = 0;
+        return false;
+    }
+
+    m_level = target;
+    m_aboveSinceNs = 0;
+    m_belowSinceNs = 0;
+    profileId = profileFor(m_level);
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef OVERPI_WORKLOAD_SCHEDULER_H
+#define OVERPI_WORKLOAD_SCHEDULER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_busy.h"
+
+// Profiles for each load level and the thresholds between them
+struct WorkloadConfig {
+    std::string idleProfile;
+    std::string normalProfile;
+    std::string busyProfile;
+    int busyPercent;               // CPU busy at or above this is busy
+    int idlePercent;               // CPU busy below this may be idle
+    int idleLoadPercent;           // 1-minute load per CPU must also be below this
+    int boostAfterMs;              // busy this long before boosting
+    int dropAfterMs;               // quieter this long before stepping down
+    int jobScanMs;                 // how often /proc is scanned for jobs
+    std::vector<std::string> jobNames;   // process names that force busy
+
+    WorkloadConfig()
+    : idleProfile("minimum"), normalProfile("normal"), busyProfile("high"),
+      busyPercent(70), idlePercent(15), idleLoadPercent(25),
+      boostAfterMs(2000), dropAfterMs(30000), jobScanMs(2000) {}
+
+    // "make,cc1plus,ffmpeg" into jobNames
+    void setJobNames(const std::string& list);
+};
+
+// Picks a profile from the machine's load: the busy profile while CPU use
+// is high or one of the named jobs runs, the idle profile when the system
+// is quiet, the normal profile in between.
+//
+// Load comes from one pread each of /proc/stat and /proc/loadavg; jobs are
+// matched against /proc/<pid>/comm at most every jobScanMs. Boosting waits
+// boostAfterMs of sustained load (none when a job starts), stepping down
+// waits dropAfterMs of lower load, so short spikes and gaps between job
+// steps do not flap the clock.
+class WorkloadScheduler {
+public:
+    enum Level {
+        LEVEL_IDLE = 0,
+        LEVEL_NORMAL = 1,
+        LEVEL_BUSY = 2
+    };
+
+    explicit WorkloadScheduler(const WorkloadConfig& config = WorkloadConfig(),
+                               const std::string& procRoot = "/proc");
+    ~WorkloadScheduler();
+
+    // Forget the current level; the next update() decides immediately
+    void reset();
+
+    // Call after each sample. Returns true when the profile should change,
+    // with its id in profileId.
+    bool update(int64_t monotonicNs, std::string& profileId);
+
+    Level level() const { return m_level; }
+    const std::string& profileFor(Level level) const;
+    int busyPercent() const { return m_busyPercent; }
+    int loadPercent() const { return m_loadPercent; }
+    const std::string& job() const { return m_job; }   // empty when none runs
+
+    static const char* levelName(Level level);
+
+private:
+    WorkloadScheduler(const WorkloadScheduler&) = delete;
+    WorkloadScheduler& operator=(const WorkloadScheduler&) = delete;
+
+    bool readLoadPercent(int& percent);
+    void scanJobs();
+    Level classify() const;
+
+    WorkloadConfig m_config;
+    std::string m_procRoot;
+    CpuBusyReader m_busy;
+    int m_loadFd;
+    int m_cpuCount;
+
+    int m_busyPercent;
+    int m_loadPercent;
+    std::string m_job;
+    int64_t m_lastScanNs;
+
+    bool m_started;
+    Level m_level;
+    int64_t m_aboveSinceNs;        // 0 unless the load has stayed above the level
+    int64_t m_belowSinceNs;        // 0 unless the load has stayed below the level
+};
+
+#endif